@@ -0,0 +1,61 @@
+#version 450
+
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+	vec4 camera;
+	vec4 surface;
+} ubo;
+
+// one transform per scene instance, reached through the culled instance list
+#ifdef BINDLESS
+layout(std430, set = 1, binding = 0) readonly buffer Instances {
+	mat4 transforms[];
+} instances[];
+
+// heap slots of this draw's buffers
+layout(push_constant) uniform Resources {
+	uint surface;
+	uint transforms;
+} resources;
+
+mat4 transform(int i) {
+	return instances[resources.transforms].transforms[i];
+}
+#else
+layout(std430, binding = 2) readonly buffer Instances {
+	mat4 transforms[];
+};
+
+mat4 transform(int i) {
+	return transforms[i];
+}
+#endif
+
+// snorm relative to the mesh bounds, the instance transform scales it back
+layout(location = 0) in vec4 inPosition;
+// octahedral, see quantize::pack_octahedral
+layout(location = 1) in vec2 inNormal;
+// per instance, the index of a visible instance written by culling
+layout(location = 2) in uint inInstance;
+
+layout(location = 0) out vec3 fragNormal;
+
+vec3 octahedralDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main() {
+	mat4 model = transform(int(inInstance));
+	gl_Position = ubo.proj * ubo.view * model * vec4(inPosition.xyz, 1.0);
+	fragNormal = mat3(model) * octahedralDecode(inNormal);
+}
@@ -1,8 +1,16 @@
 #version 450
 
-layout(location = 0) in vec3 fragColor;
+layout(location = 0) in vec3 fragNormal;
 layout(location = 0) out vec4 outColor;
 
+const vec3 lightDirection = normalize(vec3(0.3, 0.5, 0.8));
+const vec3 deepColor = vec3(0.0, 0.09, 0.18);
+const vec3 skyColor = vec3(0.55, 0.7, 0.85);
+
 void main() {
-	outColor = vec4(fragColor, 1.0);
-}
\ No newline at end of file
+	vec3 normal = normalize(fragNormal);
+	float diffuse = max(dot(normal, lightDirection), 0.0);
+	float fresnel = pow(1.0 - max(normal.z, 0.0), 3.0);
+	vec3 color = mix(deepColor, skyColor, fresnel) + deepColor * diffuse;
+	outColor = vec4(color, 1.0);
+}
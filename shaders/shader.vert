@@ -1,17 +1,108 @@
 #version 450
 
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
 layout(binding = 0) uniform UniformBufferObject {
 	mat4 model;
 	mat4 view;
 	mat4 proj;
+	vec4 camera;
+	// simulated patch size, simulation resolution, quads per lod patch
+	vec4 surface;
 } ubo;
 
-layout(location = 0) in vec2 inPosition;
-layout(location = 1) in vec3 inColor;
+// simulated grid of position and normal triples, tiled across the quadtree
+#ifdef BINDLESS
+layout(std430, set = 1, binding = 0) readonly buffer Surface {
+	float values[];
+} surfaces[];
+
+// heap slots of this draw's buffers
+layout(push_constant) uniform Resources {
+	uint surface;
+	uint transforms;
+} resources;
+
+float surface(int i) {
+	return surfaces[resources.surface].values[i];
+}
+#else
+layout(std430, binding = 1) readonly buffer Surface {
+	float values[];
+} surfaceBuffer;
+
+float surface(int i) {
+	return surfaceBuffer.values[i];
+}
+#endif
+
+// baked per pipeline, the morph is compiled out when disabled
+layout(constant_id = 0) const bool morphEnabled = true;
+
+// lattice coordinates of the patch corner, quads per patch span it
+layout(location = 0) in uvec2 inLattice;
+layout(location = 1) in vec4 inOffsetSize;
+layout(location = 2) in vec4 inMorph;
+
+layout(location = 0) out vec3 fragNormal;
+
+struct Sample {
+	vec3 displacement;
+	vec3 normal;
+};
 
-layout(location = 0) out vec3 fragColor;
+Sample fetch(ivec2 cell) {
+	int resolution = int(ubo.surface.y);
+	ivec2 wrapped = (cell % resolution + resolution) % resolution;
+	int base = (wrapped.y * resolution + wrapped.x) * 6;
+
+	// rest position of the cell, the simulation spans [-patch/2, patch/2)
+	vec2 rest = (vec2(wrapped) / float(resolution) - 0.5) * ubo.surface.x;
+	vec3 position = vec3(surface(base), surface(base + 1), surface(base + 2));
+
+	Sample s;
+	s.displacement = position - vec3(rest, 0.0);
+	s.normal = vec3(surface(base + 3), surface(base + 4), surface(base + 5));
+	return s;
+}
+
+Sample sampleSurface(vec2 world) {
+	vec2 texel = (world / ubo.surface.x + 0.5) * ubo.surface.y;
+	ivec2 cell = ivec2(floor(texel));
+	vec2 f = fract(texel);
+
+	Sample s00 = fetch(cell);
+	Sample s10 = fetch(cell + ivec2(1, 0));
+	Sample s01 = fetch(cell + ivec2(0, 1));
+	Sample s11 = fetch(cell + ivec2(1, 1));
+
+	Sample s;
+	s.displacement = mix(mix(s00.displacement, s10.displacement, f.x),
+	                     mix(s01.displacement, s11.displacement, f.x), f.y);
+	s.normal = mix(mix(s00.normal, s10.normal, f.x),
+	               mix(s01.normal, s11.normal, f.x), f.y);
+	return s;
+}
 
 void main() {
-	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
-	fragColor = inColor;
+	float size = inOffsetSize.z;
+	float quads = ubo.surface.z;
+	vec2 world = inOffsetSize.xy + vec2(inLattice) / quads * size;
+
+	// odd vertices slide onto their even neighbours as the node approaches
+	// its range so the seam against the coarser parent closes
+	if (morphEnabled) {
+		float distance = length(ubo.camera.xyz - vec3(world, 0.0));
+		float morph = clamp((distance - inMorph.x) / (inMorph.y - inMorph.x),
+		                    0.0, 1.0);
+		vec2 odd = vec2(inLattice & 1u) / quads;
+		world -= odd * size * morph;
+	}
+
+	Sample s = sampleSurface(world);
+	vec4 position = ubo.model * vec4(vec3(world, 0.0) + s.displacement, 1.0);
+	gl_Position = ubo.proj * ubo.view * position;
+	fragNormal = mat3(ubo.model) * normalize(s.normal);
 }
@@ -0,0 +1,22 @@
+#version 450
+
+// one glyph quad per instance, top left corner and size in pixels
+layout(location = 0) in vec4 inRect;
+layout(location = 1) in vec4 inUv;
+layout(location = 2) in vec4 inColor;
+
+layout(push_constant) uniform Screen {
+	vec2 scale;
+} screen;
+
+layout(location = 0) out vec2 fragUv;
+layout(location = 1) out vec4 fragColor;
+
+void main() {
+	// a triangle strip over the corners 0 1 2 3 in z order
+	vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+	vec2 position = inRect.xy + corner * inRect.zw;
+	gl_Position = vec4(position * screen.scale - 1.0, 0.0, 1.0);
+	fragUv = mix(inUv.xy, inUv.zw, corner);
+	fragColor = inColor;
+}
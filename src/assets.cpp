@@ -0,0 +1,539 @@
+module;
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+module assets;
+
+import jobs;
+import meshopt;
+
+namespace wf::assets
+{
+uint32_t mesh::vertex_count() const
+{
+    return static_cast<uint32_t>(vertex_bytes().size() / sizeof(vertex));
+}
+
+uint32_t mesh::index_count() const
+{
+    return static_cast<uint32_t>(index_bytes().size() /
+                                 static_cast<size_t>(indices_type));
+}
+
+std::span<const std::byte> mesh::vertex_bytes() const
+{
+    return cache ? cached_vertices : std::as_bytes(std::span{vertices});
+}
+
+uint32_t mesh::meshlet_count() const
+{
+    return static_cast<uint32_t>(meshlet_bytes().size() /
+                                 sizeof(meshopt::meshlet));
+}
+
+std::span<const std::byte> mesh::index_bytes() const
+{
+    return cache ? cached_indices : std::span<const std::byte>{indices};
+}
+
+std::span<const std::byte> mesh::meshlet_bytes() const
+{
+    return cache ? cached_meshlets : std::as_bytes(std::span{meshlets});
+}
+
+namespace
+{
+// obj indices are one based and negative ones count back from the latest
+// element, those stay chunk relative until every chunk's offset is known
+struct index_ref
+{
+    int64_t value;
+    bool relative;
+};
+
+struct corner
+{
+    index_ref position;
+    std::optional<index_ref> normal;
+};
+
+struct chunk
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<corner> corners;
+};
+
+std::string_view skip_spaces(std::string_view text)
+{
+    auto first = text.find_first_not_of(" \t");
+    return first == std::string_view::npos ? std::string_view{}
+                                           : text.substr(first);
+}
+
+std::string_view next_token(std::string_view& text)
+{
+    text       = skip_spaces(text);
+    auto last  = std::min(text.find_first_of(" \t\r"), text.size());
+    auto token = text.substr(0, last);
+    text.remove_prefix(last);
+    return token;
+}
+
+template <typename T> T parse_value(std::string_view token)
+{
+    T value{};
+    auto [end, error] =
+        std::from_chars(token.data(), token.data() + token.size(), value);
+    if (error != std::errc{})
+    {
+        throw std::runtime_error{std::format("invalid obj value: {}", token)};
+    }
+    return value;
+}
+
+glm::vec3 parse_vec3(std::string_view text)
+{
+    glm::vec3 value;
+    value.x = parse_value<float>(next_token(text));
+    value.y = parse_value<float>(next_token(text));
+    value.z = parse_value<float>(next_token(text));
+    return value;
+}
+
+index_ref make_ref(int64_t raw, size_t local_count)
+{
+    if (raw == 0)
+    {
+        throw std::runtime_error{"obj indices start at one!"};
+    }
+    if (raw > 0)
+    {
+        return {raw - 1, false};
+    }
+    return {static_cast<int64_t>(local_count) + raw, true};
+}
+
+// "p", "p/t", "p/t/n" or "p//n", texture coordinates are not used
+corner parse_corner(std::string_view token, const chunk& c)
+{
+    auto slash = token.find('/');
+    corner result{make_ref(parse_value<int64_t>(token.substr(0, slash)),
+                           c.positions.size()),
+                  std::nullopt};
+    if (slash == std::string_view::npos)
+    {
+        return result;
+    }
+    auto second = token.find('/', slash + 1);
+    if (second != std::string_view::npos and second + 1 < token.size())
+    {
+        result.normal = make_ref(
+            parse_value<int64_t>(token.substr(second + 1)), c.normals.size());
+    }
+    return result;
+}
+
+void parse_chunk(std::string_view text, chunk& c)
+{
+    std::vector<corner> face;
+    while (not text.empty())
+    {
+        auto end  = std::min(text.find('\n'), text.size());
+        auto line = skip_spaces(text.substr(0, end));
+        text.remove_prefix(std::min(end + 1, text.size()));
+
+        auto keyword = next_token(line);
+        if (keyword == "v")
+        {
+            c.positions.push_back(parse_vec3(line));
+        }
+        else if (keyword == "vn")
+        {
+            c.normals.push_back(parse_vec3(line));
+        }
+        else if (keyword == "f")
+        {
+            face.clear();
+            auto token = next_token(line);
+            while (not token.empty())
+            {
+                face.push_back(parse_corner(token, c));
+                token = next_token(line);
+            }
+            // polygons are fanned around their first corner
+            for (size_t i = 1; i + 1 < face.size(); ++i)
+            {
+                c.corners.insert(std::end(c.corners),
+                                 {face[0], face[i], face[i + 1]});
+            }
+        }
+    }
+}
+
+// splits the text into pieces ending on line breaks
+std::vector<std::string_view> split_lines(std::string_view text,
+                                          uint32_t pieces)
+{
+    std::vector<std::string_view> result;
+    auto target = text.size() / pieces + 1;
+    while (not text.empty())
+    {
+        auto end = text.find('\n', std::min(target, text.size() - 1));
+        end      = end == std::string_view::npos ? text.size() : end + 1;
+        result.push_back(text.substr(0, end));
+        text.remove_prefix(end);
+    }
+    return result;
+}
+
+uint32_t resolve(const index_ref& ref, size_t base, size_t count)
+{
+    auto index = ref.relative ? static_cast<int64_t>(base) + ref.value
+                              : ref.value;
+    if (index < 0 or static_cast<size_t>(index) >= count)
+    {
+        throw std::runtime_error{
+            std::format("obj index {} out of range", index + 1)};
+    }
+    return static_cast<uint32_t>(index);
+}
+
+void smooth_normals(std::span<vertex> vertices,
+                    std::span<const uint32_t> indices)
+{
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        auto& a = vertices[indices[i]];
+        auto& b = vertices[indices[i + 1]];
+        auto& c = vertices[indices[i + 2]];
+        auto face =
+            glm::cross(b.position - a.position, c.position - a.position);
+        a.normal += face;
+        b.normal += face;
+        c.normal += face;
+    }
+    // vertices only degenerate triangles or none at all touch keep a zero
+    // normal, normalizing it would give nan
+    for (auto& v : vertices)
+    {
+        auto length = glm::length(v.normal);
+        v.normal    = length > 0.f ? v.normal / length : glm::vec3{0.f};
+    }
+}
+
+void pack_indices(mesh& m, std::span<const uint32_t> indices)
+{
+    if (m.vertices.size() <= std::numeric_limits<uint16_t>::max())
+    {
+        std::vector<uint16_t> narrow(std::begin(indices), std::end(indices));
+        m.indices_type = index_type::uint16;
+        m.indices.resize(narrow.size() * sizeof(uint16_t));
+        std::memcpy(m.indices.data(), narrow.data(), m.indices.size());
+        return;
+    }
+    m.indices_type = index_type::uint32;
+    m.indices.resize(indices.size_bytes());
+    std::memcpy(m.indices.data(), indices.data(), m.indices.size());
+}
+
+std::vector<uint32_t> unpack_indices(const mesh& m)
+{
+    auto bytes = m.index_bytes();
+    if (m.indices_type == index_type::uint32)
+    {
+        std::vector<uint32_t> indices(m.index_count());
+        std::memcpy(indices.data(), bytes.data(), bytes.size());
+        return indices;
+    }
+    std::vector<uint16_t> narrow(m.index_count());
+    std::memcpy(narrow.data(), bytes.data(), bytes.size());
+    return {std::begin(narrow), std::end(narrow)};
+}
+
+int64_t source_time(const std::filesystem::path& source)
+{
+    return std::filesystem::last_write_time(source)
+        .time_since_epoch()
+        .count();
+}
+} // namespace
+
+mesh parse_obj(const std::filesystem::path& path, uint32_t worker_count)
+{
+    worker_count = std::max(worker_count, 1u);
+    mapped_file file{path};
+    auto pieces = split_lines(file.text(), worker_count);
+    if (pieces.empty())
+    {
+        throw std::runtime_error{
+            std::format("mesh {} is empty!", path.string())};
+    }
+    std::vector<chunk> chunks(pieces.size());
+    jobs::parallel_ranges(to<uint32_t>(pieces.size()),
+                          worker_count,
+                          [&](uint32_t first, uint32_t last) {
+                              for (auto i = first; i < last; ++i)
+                              {
+                                  parse_chunk(pieces[i], chunks[i]);
+                              }
+                          });
+
+    size_t position_count = 0;
+    size_t normal_count   = 0;
+    for (const auto& c : chunks)
+    {
+        position_count += c.positions.size();
+        normal_count += c.normals.size();
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    positions.reserve(position_count);
+    normals.reserve(normal_count);
+    for (const auto& c : chunks)
+    {
+        positions.insert(std::end(positions),
+                         std::begin(c.positions),
+                         std::end(c.positions));
+        normals.insert(
+            std::end(normals), std::begin(c.normals), std::end(c.normals));
+    }
+
+    // a vertex is a position and normal pair, each distinct pair is kept once
+    mesh result{.path = path};
+    std::vector<uint32_t> indices;
+    std::unordered_map<uint64_t, uint32_t> unique_vertices;
+    size_t position_base = 0;
+    size_t normal_base   = 0;
+    for (const auto& c : chunks)
+    {
+        indices.reserve(indices.size() + c.corners.size());
+        for (const auto& corner : c.corners)
+        {
+            auto p = resolve(corner.position, position_base, positions.size());
+            auto n = corner.normal
+                         ? resolve(*corner.normal, normal_base, normals.size())
+                         : std::numeric_limits<uint32_t>::max();
+            auto key            = (static_cast<uint64_t>(p) << 32) | n;
+            auto [it, inserted] = unique_vertices.try_emplace(
+                key, to<uint32_t>(result.vertices.size()));
+            if (inserted)
+            {
+                result.vertices.push_back(
+                    {positions[p],
+                     corner.normal ? normals[n] : glm::vec3{0.f}});
+            }
+            indices.push_back(it->second);
+        }
+        position_base += c.positions.size();
+        normal_base += c.normals.size();
+    }
+
+    if (normals.empty())
+    {
+        smooth_normals(result.vertices, indices);
+    }
+    pack_indices(result, indices);
+    return result;
+}
+
+optimization optimize_mesh(mesh& m)
+{
+    if (m.cache)
+    {
+        throw std::runtime_error{"cached meshes are optimized already!"};
+    }
+    auto indices      = unpack_indices(m);
+    auto vertex_count = m.vertex_count();
+    optimization result{
+        .before = meshopt::analyze_vertex_cache(indices, vertex_count)};
+
+    std::vector<glm::vec3> positions(vertex_count);
+    std::ranges::transform(m.vertices,
+                           std::begin(positions),
+                           [](const vertex& v) { return v.position; });
+    meshopt::optimize_vertex_cache(indices, vertex_count);
+    meshopt::optimize_overdraw(indices, positions);
+
+    std::vector<uint32_t> remap(vertex_count);
+    std::vector<vertex> vertices(
+        meshopt::optimize_vertex_fetch(indices, remap));
+    for (uint32_t i = 0; i < vertex_count; ++i)
+    {
+        if (remap[i] != std::numeric_limits<uint32_t>::max())
+        {
+            vertices[remap[i]] = m.vertices[i];
+        }
+    }
+    m.vertices = std::move(vertices);
+    pack_indices(m, indices);
+
+    positions.resize(m.vertices.size());
+    std::ranges::transform(m.vertices,
+                           std::begin(positions),
+                           [](const vertex& v) { return v.position; });
+    m.meshlets = meshopt::build_meshlets(indices, positions);
+
+    result.after = meshopt::analyze_vertex_cache(indices, m.vertex_count());
+    return result;
+}
+
+std::filesystem::path cache_path(const std::filesystem::path& source)
+{
+    auto path = source;
+    path += cache_extension;
+    return path;
+}
+
+void write_cache(const mesh& m, const std::filesystem::path& source)
+{
+    cache_header header{};
+    header.magic         = cache_magic;
+    header.version       = cache_version;
+    header.source_size   = std::filesystem::file_size(source);
+    header.source_time   = source_time(source);
+    header.vertex_count  = m.vertex_count();
+    header.index_count   = m.index_count();
+    header.indices_type  = m.indices_type;
+    header.meshlet_count = m.meshlet_count();
+
+    // written aside and renamed so a reader never sees a partial file
+    auto path      = cache_path(source);
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+        file.write(reinterpret_cast<const char*>(std::addressof(header)),
+                   sizeof(header));
+        auto vertices = m.vertex_bytes();
+        file.write(reinterpret_cast<const char*>(vertices.data()),
+                   to<std::streamsize>(vertices.size()));
+        auto meshlets = m.meshlet_bytes();
+        file.write(reinterpret_cast<const char*>(meshlets.data()),
+                   to<std::streamsize>(meshlets.size()));
+        auto indices = m.index_bytes();
+        file.write(reinterpret_cast<const char*>(indices.data()),
+                   to<std::streamsize>(indices.size()));
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+std::optional<mesh> read_cache(const std::filesystem::path& source)
+{
+    auto path = cache_path(source);
+    if (not std::filesystem::exists(path))
+    {
+        return std::nullopt;
+    }
+
+    mapped_file file{path};
+    auto data = file.bytes();
+    cache_header header;
+    if (data.size() < sizeof(header))
+    {
+        return std::nullopt;
+    }
+    std::memcpy(std::addressof(header), data.data(), sizeof(header));
+    if (header.magic != cache_magic or header.version != cache_version or
+        header.source_size != std::filesystem::file_size(source) or
+        header.source_time != source_time(source))
+    {
+        return std::nullopt;
+    }
+    // the index stride comes from the type, anything else is corrupt
+    if (header.indices_type != index_type::uint16 and
+        header.indices_type != index_type::uint32)
+    {
+        return std::nullopt;
+    }
+
+    auto vertex_size  = size_t{header.vertex_count} * sizeof(vertex);
+    auto meshlet_size = size_t{header.meshlet_count} *
+                        sizeof(meshopt::meshlet);
+    auto index_size   = size_t{header.index_count} *
+                        static_cast<size_t>(header.indices_type);
+    if (data.size() !=
+        sizeof(header) + vertex_size + meshlet_size + index_size)
+    {
+        return std::nullopt;
+    }
+
+    mesh result{.path = source, .indices_type = header.indices_type};
+    result.cached_vertices = data.subspan(sizeof(header), vertex_size);
+    result.cached_meshlets =
+        data.subspan(sizeof(header) + vertex_size, meshlet_size);
+    result.cached_indices =
+        data.subspan(sizeof(header) + vertex_size + meshlet_size);
+    result.cache = std::move(file);
+
+    // indices past the vertices or meshlets past the triangles would reach
+    // the gpu as out of bounds reads, the obj is parsed again instead
+    auto indices = unpack_indices(result);
+    if (indices.size() % 3 != 0 or
+        std::ranges::any_of(
+            indices, [&](uint32_t i) { return i >= header.vertex_count; }))
+    {
+        return std::nullopt;
+    }
+    auto triangle_count = indices.size() / 3;
+    for (uint32_t i = 0; i < header.meshlet_count; ++i)
+    {
+        meshopt::meshlet m;
+        std::memcpy(std::addressof(m),
+                    result.cached_meshlets.data() + i * sizeof(m),
+                    sizeof(m));
+        if (size_t{m.first_triangle} + m.triangle_count > triangle_count)
+        {
+            return std::nullopt;
+        }
+    }
+    return result;
+}
+
+mesh load_mesh(const std::filesystem::path& path)
+{
+    if (auto cached = read_cache(path))
+    {
+        return std::move(*cached);
+    }
+
+    auto result = parse_obj(path);
+    auto stats  = optimize_mesh(result);
+    wf::log(std::format("optimized {}: acmr {:.3f} to {:.3f}, atvr {:.3f} to "
+                        "{:.3f}, {} meshlets",
+                        path.string(),
+                        stats.before.acmr,
+                        stats.after.acmr,
+                        stats.before.atvr,
+                        stats.after.atvr,
+                        result.meshlet_count()));
+    try
+    {
+        write_cache(result, path);
+    }
+    catch (const std::exception& e)
+    {
+        wf::log(std::format(
+            "could not cache {}: {}", path.string(), e.what()));
+    }
+    return result;
+}
+} // namespace wf::assets
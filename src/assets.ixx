@@ -0,0 +1,107 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+export module assets;
+
+import meshopt;
+import utils;
+
+namespace wf::assets
+{
+export struct vertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+static_assert(sizeof(vertex) == 24);
+
+// indices are stored at the narrowest width holding every vertex so small
+// meshes upload and fetch half the bytes
+export enum class index_type : uint32_t
+{
+    uint16 = 2,
+    uint32 = 4
+};
+
+export struct mesh
+{
+    std::filesystem::path path;
+    std::vector<vertex> vertices;
+    std::vector<std::byte> indices;
+    index_type indices_type = index_type::uint16;
+    // consecutive triangle runs covering the indices, built with them
+    std::vector<meshopt::meshlet> meshlets;
+
+    // set when read from the binary cache, the payload is then served
+    // straight from the mapping and the vectors above stay empty
+    std::optional<mapped_file> cache;
+    std::span<const std::byte> cached_vertices;
+    std::span<const std::byte> cached_indices;
+    std::span<const std::byte> cached_meshlets;
+
+    uint32_t vertex_count() const;
+    uint32_t index_count() const;
+    std::span<const std::byte> vertex_bytes() const;
+    uint32_t meshlet_count() const;
+    std::span<const std::byte> index_bytes() const;
+    std::span<const std::byte> meshlet_bytes() const;
+};
+
+// header of the binary mesh cache, followed by the vertices, the meshlets
+// and then the indices so the file can be mapped and uploaded without any
+// parsing, the narrow indices go last to keep the rest aligned
+export struct cache_header
+{
+    std::array<char, 4> magic;
+    uint32_t version;
+    uint64_t source_size;
+    int64_t source_time;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    index_type indices_type;
+    uint32_t meshlet_count;
+    uint32_t reserved[2];
+};
+static_assert(sizeof(cache_header) == 48);
+
+export constexpr std::array<char, 4> cache_magic  = {'W', 'F', 'M', 'C'};
+export constexpr uint32_t cache_version           = 3;
+export constexpr std::string_view cache_extension = ".wfmesh";
+
+// parses the obj text in line aligned chunks on worker threads, then merges
+// the chunks and welds identical position and normal pairs into one vertex
+export mesh parse_obj(const std::filesystem::path& path,
+                      uint32_t worker_count =
+                          std::max(1u, std::thread::hardware_concurrency()));
+
+// reorders a freshly parsed mesh for the gpu, triangles for the post
+// transform cache and then for overdraw, vertices for fetch locality. drops
+// unreferenced vertices, may narrow the indices and splits the result into
+// meshlets
+export struct optimization
+{
+    meshopt::cache_stats before;
+    meshopt::cache_stats after;
+};
+export optimization optimize_mesh(mesh& m);
+
+export std::filesystem::path cache_path(const std::filesystem::path& source);
+export void write_cache(const mesh& m, const std::filesystem::path& source);
+
+// empty when the cache is missing, of another version or older than source
+export std::optional<mesh> read_cache(const std::filesystem::path& source);
+
+// cached when possible, otherwise parsed, optimized and cached for the next
+// run so the optimization is paid once per source
+export mesh load_mesh(const std::filesystem::path& path);
+} // namespace wf::assets
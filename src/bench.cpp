@@ -0,0 +1,487 @@
+module;
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <glm/glm.hpp>
+#include <limits>
+#include <magic_enum/magic_enum.hpp>
+#include <memory>
+#include <numbers>
+#include <print>
+#include <random>
+#include <stdexcept>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+module bench;
+
+import assets;
+import gerstner;
+import ocean;
+import profiler;
+import quantize;
+import scene;
+import simulation;
+import vk;
+
+namespace wf::bench
+{
+using clock = std::chrono::steady_clock;
+
+// repeats the body until at least min_duration elapsed and returns the best
+// seconds per iteration among a few rounds
+double measure(const std::function<void()>& body,
+               std::chrono::duration<double> min_duration =
+                   std::chrono::milliseconds{250})
+{
+    constexpr int rounds = 5;
+    body();
+
+    double best = std::numeric_limits<double>::max();
+    for (int round = 0; round < rounds; ++round)
+    {
+        uint64_t iterations = 0;
+        auto start          = clock::now();
+        std::chrono::duration<double> elapsed{};
+        do
+        {
+            body();
+            ++iterations;
+            elapsed = clock::now() - start;
+        } while (elapsed < min_duration / rounds);
+        best = std::min(best, elapsed.count() / iterations);
+    }
+    return best;
+}
+
+void gerstner_throughput()
+{
+    constexpr uint32_t resolution = 256;
+    constexpr float patch_size    = 256.f;
+
+    std::println("{:>8} {:>6} {:>12} {:>14} {:>10}",
+                 "isa",
+                 "waves",
+                 "ms/update",
+                 "Mpoints/s",
+                 "speedup");
+    for (uint32_t wave_count : {8u, 16u, 32u, 64u})
+    {
+        auto waves = gerstner::make_waves(wave_count, {1.f, 0.f}, 24.f, 0.8f);
+        gerstner::wave_field field{waves, resolution, patch_size};
+
+        double scalar_seconds = 0.;
+        for (auto kernel : gerstner::supported_isas())
+        {
+            field.set_isa(kernel);
+            float time   = 0.f;
+            auto seconds = measure([&] {
+                field.update(time);
+                time += 1.f / 60.f;
+            });
+            if (kernel == gerstner::isa::scalar)
+            {
+                scalar_seconds = seconds;
+            }
+            std::println("{:>8} {:>6} {:>12.3f} {:>14.1f} {:>9.2f}x",
+                         magic_enum::enum_name(kernel),
+                         wave_count,
+                         1000. * seconds,
+                         field.point_count() / seconds / 1e6,
+                         scalar_seconds / seconds);
+        }
+
+        // cpu twin of the compute kernel, what gpu validation runs against
+        std::vector<glm::vec3> positions(field.point_count());
+        std::vector<glm::vec3> normals(field.point_count());
+        float time   = 0.f;
+        auto seconds = measure([&] {
+            field.evaluate_reference(time, positions, normals);
+            time += 1.f / 60.f;
+        });
+        std::println("{:>8} {:>6} {:>12.3f} {:>14.1f} {:>9.2f}x",
+                     "fused",
+                     wave_count,
+                     1000. * seconds,
+                     field.point_count() / seconds / 1e6,
+                     scalar_seconds / seconds);
+    }
+}
+
+std::filesystem::path write_triangle()
+{
+    auto path =
+        std::filesystem::temp_directory_path() / "wf_bench_triangle.obj";
+    std::ofstream{path} << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+    return path;
+}
+
+// writes a scene of entity_count entities sharing one triangle mesh
+std::filesystem::path write_scene(uint32_t entity_count)
+{
+    auto mesh_path  = write_triangle();
+    auto scene_path = std::filesystem::temp_directory_path() /
+                      "wf_bench_scene.json";
+    std::ofstream file{scene_path};
+    file << R"({"entities":[)";
+    for (uint32_t i = 0; i < entity_count; ++i)
+    {
+        file << std::format(
+            R"({}{{"name":"e{}","components":[)"
+            R"({{"type":"transform","position":[{},{},{}]}},)"
+            R"({{"type":"mesh","file":"{}"}}]}})",
+            i == 0 ? "" : ",",
+            i,
+            i % 317,
+            i / 317,
+            -1.5f,
+            mesh_path.generic_string());
+    }
+    file << "]}";
+    return scene_path;
+}
+
+void scene_load()
+{
+    std::println("{:>10} {:>12} {:>14} {:>14}",
+                 "entities",
+                 "ms/load",
+                 "ms/instances",
+                 "Mentities/s");
+    for (uint32_t entity_count : {1'000u, 10'000u, 100'000u})
+    {
+        auto path = write_scene(entity_count);
+
+        auto load_seconds = measure([&] {
+            scene::world world;
+            scene::load(path, world);
+        });
+
+        scene::world world;
+        scene::load(path, world);
+        auto instance_seconds = measure([&] { world.instances(); });
+
+        std::println("{:>10} {:>12.3f} {:>14.3f} {:>14.2f}",
+                     entity_count,
+                     1000. * load_seconds,
+                     1000. * instance_seconds,
+                     entity_count / load_seconds / 1e6);
+        std::filesystem::remove(path);
+    }
+}
+
+// a frame of draw_count single instance draws recorded by a growing number
+// of threads, the profiler's record zone is the cpu time being scaled
+void command_recording()
+{
+    constexpr uint32_t draw_count  = 20'000;
+    constexpr uint32_t frame_count = 200;
+
+    auto triangle = assets::parse_obj(write_triangle());
+    scene::description scene{.meshes = std::span{std::addressof(triangle), 1}};
+    for (uint32_t i = 0; i < draw_count; ++i)
+    {
+        scene.transforms.emplace_back(1.f);
+        scene.batches.push_back({.mesh           = 0,
+                                 .first_instance = i,
+                                 .instance_count = 1});
+    }
+
+    // outlive the renderer, which keeps the last one attached
+    std::vector<std::unique_ptr<profiler::profiler>> profilers;
+    vk::instance renderer{VkExtent2D{640, 360}, vk::surface_layout{64, 64.f}};
+    renderer.load_scene(scene);
+
+    std::vector<uint32_t> thread_counts;
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t threads = 1; threads < cores; threads *= 2)
+    {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(cores);
+
+    std::println("{:>8} {:>12} {:>12} {:>10}",
+                 "threads",
+                 "p50 ms",
+                 "p95 ms",
+                 "speedup");
+    double single_thread = 0.;
+    for (auto threads : thread_counts)
+    {
+        renderer.set_record_threads(threads);
+        auto& profiler =
+            *profilers.emplace_back(std::make_unique<profiler::profiler>());
+        renderer.attach_profiler(profiler);
+        for (uint32_t frame = 0; frame < frame_count; ++frame)
+        {
+            profiler.next_frame();
+            renderer.draw_frame([](std::span<vk::vertex>) {});
+        }
+        renderer.wait_device_idle();
+
+        auto zones  = profiler.summarize();
+        auto record = std::ranges::find_if(zones, [](const auto& zone) {
+            return zone.name == "record" and not zone.gpu;
+        });
+        if (record == std::end(zones))
+        {
+            throw std::runtime_error{"no recording was profiled!"};
+        }
+        if (threads == 1)
+        {
+            single_thread = record->p50;
+        }
+        std::println("{:>8} {:>12.3f} {:>12.3f} {:>9.2f}x",
+                     threads,
+                     record->p50,
+                     record->p95,
+                     single_thread / record->p50);
+    }
+}
+
+// ticks a surface model back to back on the simulation thread while this
+// thread plays the renderer, blending every snapshot it gets into vertices
+void simulation_throughput()
+{
+    constexpr std::chrono::seconds duration{1};
+    constexpr uint32_t resolution = 256;
+    constexpr float patch_size    = 256.f;
+
+    auto run = [&](std::string_view name, auto& model) {
+        simulation::runner runner{
+            std::chrono::duration<double>{1. / 60.},
+            [&model](double time, simulation::snapshot& out) {
+                model.update(static_cast<float>(time));
+                out.positions.resize(size_t{resolution} * resolution);
+                out.normals.resize(out.positions.size());
+                model.write(out);
+            },
+            simulation::pacing::unthrottled};
+
+        std::vector<glm::vec3> blended(size_t{resolution} * resolution);
+        uint64_t frames = 0;
+        auto start      = clock::now();
+        while (clock::now() - start < duration)
+        {
+            auto state = runner.acquire();
+            for (size_t i = 0; i < blended.size(); ++i)
+            {
+                blended[i] = glm::mix(state.previous.positions[i],
+                                      state.current.positions[i],
+                                      state.alpha);
+            }
+            ++frames;
+        }
+        std::chrono::duration<double> elapsed = clock::now() - start;
+        auto stats                            = runner.stats();
+        std::println("{:>10} {:>10.1f} {:>12.3f} {:>12.1f}",
+                     name,
+                     stats.ticks / elapsed.count(),
+                     1000. * stats.step_time.count() / stats.ticks,
+                     frames / elapsed.count());
+    };
+
+    std::println("{:>10} {:>10} {:>12} {:>12}",
+                 "model",
+                 "ticks/s",
+                 "ms/tick",
+                 "frames/s");
+
+    struct fft_model
+    {
+        ocean::simulation ocean;
+        void update(float time)
+        {
+            ocean.update(time);
+        }
+        void write(simulation::snapshot& out) const
+        {
+            std::ranges::copy(ocean.positions(), std::begin(out.positions));
+            std::ranges::copy(ocean.normals(), std::begin(out.normals));
+        }
+    } fft{ocean::simulation{{.resolution = resolution,
+                             .patch_size = patch_size}}};
+    run("fft", fft);
+
+    struct gerstner_model
+    {
+        gerstner::wave_field field;
+        void update(float time)
+        {
+            field.update(time);
+        }
+        void write(simulation::snapshot& out) const
+        {
+            const auto& s = field.surface();
+            for (size_t i = 0; i < out.positions.size(); ++i)
+            {
+                out.positions[i] = {s.x[i], s.y[i], s.z[i]};
+                out.normals[i]   = {s.nx[i], s.ny[i], s.nz[i]};
+            }
+        }
+    } waves{gerstner::wave_field{
+        gerstner::make_waves(32, {1.f, 0.f}, 24.f, 0.8f),
+        resolution,
+        patch_size}};
+    run("gerstner", waves);
+}
+
+// latitude longitude sphere away from the origin, so positions only keep
+// their precision by being packed relative to the mesh bounds
+std::vector<assets::vertex> make_sphere(uint32_t rings)
+{
+    constexpr float radius = 50.f;
+    const glm::vec3 center{1000.f, -250.f, 40.f};
+
+    std::vector<assets::vertex> vertices;
+    vertices.reserve(size_t{rings + 1} * (2 * rings + 1));
+    for (uint32_t r = 0; r <= rings; ++r)
+    {
+        auto theta = std::numbers::pi_v<float> * r / rings;
+        for (uint32_t s = 0; s <= 2 * rings; ++s)
+        {
+            auto phi = std::numbers::pi_v<float> * s / rings;
+            glm::vec3 normal{std::sin(theta) * std::cos(phi),
+                             std::sin(theta) * std::sin(phi),
+                             std::cos(theta)};
+            vertices.push_back({center + normal * radius, normal});
+        }
+    }
+    return vertices;
+}
+
+// cost and accuracy of quantizing mesh vertices for upload
+void vertex_packing()
+{
+    std::println("{:>10} {:>10} {:>10} {:>10} {:>10} {:>12} {:>10}",
+                 "vertices",
+                 "float KiB",
+                 "packed KiB",
+                 "ms/pack",
+                 "Mverts/s",
+                 "max error",
+                 "max deg");
+    for (uint32_t rings : {64u, 256u, 1024u})
+    {
+        auto vertices = make_sphere(rings);
+        auto range    = quantize::fit_positions(vertices);
+        std::vector<quantize::mesh_vertex> packed(vertices.size());
+        auto seconds = measure(
+            [&] { quantize::pack_mesh(vertices, range, packed); });
+        auto error = quantize::measure(vertices, packed, range);
+
+        std::println("{:>10} {:>10.1f} {:>10.1f} {:>10.3f} {:>10.1f} "
+                     "{:>12.2e} {:>10.4f}",
+                     vertices.size(),
+                     sizeof(assets::vertex) * vertices.size() / 1024.,
+                     sizeof(quantize::mesh_vertex) * packed.size() / 1024.,
+                     1000. * seconds,
+                     vertices.size() / seconds / 1e6,
+                     error.position,
+                     error.normal_degrees);
+    }
+}
+
+// quads triangulated row by row the way exporters tend to write terrain and
+// hull patches, or the same triangles in random order
+assets::mesh make_grid(uint32_t quads, bool shuffled)
+{
+    assets::mesh grid;
+    auto stride = quads + 1;
+    for (uint32_t y = 0; y <= quads; ++y)
+    {
+        for (uint32_t x = 0; x <= quads; ++x)
+        {
+            grid.vertices.push_back(
+                {{static_cast<float>(x), static_cast<float>(y), 0.f},
+                 {0.f, 0.f, 1.f}});
+        }
+    }
+
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t y = 0; y < quads; ++y)
+    {
+        for (uint32_t x = 0; x < quads; ++x)
+        {
+            auto i = y * stride + x;
+            triangles.push_back({i, i + 1, i + stride + 1});
+            triangles.push_back({i + stride + 1, i + stride, i});
+        }
+    }
+    if (shuffled)
+    {
+        std::ranges::shuffle(triangles, std::mt19937{quads});
+    }
+    grid.indices_type = assets::index_type::uint32;
+    grid.indices.resize(triangles.size() * sizeof(triangles[0]));
+    std::memcpy(grid.indices.data(), triangles.data(), grid.indices.size());
+    return grid;
+}
+
+// post transform cache efficiency before and after the import optimization
+void mesh_optimization()
+{
+    std::println("{:>10} {:>10} {:>8} {:>8} {:>8} {:>8} {:>10} {:>10}",
+                 "mesh",
+                 "triangles",
+                 "acmr",
+                 "after",
+                 "atvr",
+                 "after",
+                 "ms",
+                 "meshlets");
+    for (uint32_t quads : {64u, 256u, 1024u})
+    {
+        for (bool shuffled : {false, true})
+        {
+            auto grid      = make_grid(quads, shuffled);
+            auto triangles = grid.index_count() / 3;
+            auto start     = clock::now();
+            auto stats     = assets::optimize_mesh(grid);
+            std::chrono::duration<double> elapsed = clock::now() - start;
+
+            std::println("{:>10} {:>10} {:>8.3f} {:>8.3f} {:>8.3f} {:>8.3f} "
+                         "{:>10.3f} {:>10}",
+                         std::format("{}{}", quads, shuffled ? "s" : ""),
+                         triangles,
+                         stats.before.acmr,
+                         stats.after.acmr,
+                         stats.before.atvr,
+                         stats.after.atvr,
+                         1000. * elapsed.count(),
+                         grid.meshlet_count());
+        }
+    }
+}
+
+const std::vector<std::pair<std::string_view, void (*)()>> benchmarks = {
+    {"gerstner", gerstner_throughput},
+    {"meshopt", mesh_optimization},
+    {"scene", scene_load},
+    {"record", command_recording},
+    {"simulation", simulation_throughput},
+    {"vertex", vertex_packing},
+};
+
+void run(std::string_view name)
+{
+    auto it = std::ranges::find_if(
+        benchmarks, [name](const auto& entry) { return entry.first == name; });
+    if (it == std::end(benchmarks))
+    {
+        throw std::runtime_error{std::format("unknown benchmark: {}", name)};
+    }
+    it->second();
+}
+} // namespace wf::bench
@@ -0,0 +1,11 @@
+module;
+#include <string_view>
+
+export module bench;
+
+namespace wf::bench
+{
+// runs the named microbenchmark and prints its report, throws for unknown
+// names so typos do not silently measure nothing
+export void run(std::string_view name);
+} // namespace wf::bench
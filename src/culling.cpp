@@ -0,0 +1,158 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+module culling;
+
+import jobs;
+import utils;
+
+namespace wf::culling
+{
+// draws own disjoint instance ranges, so a task takes a run of whole draws
+constexpr uint32_t draws_per_task = 64;
+
+view make_view(const glm::mat4& view_proj,
+               glm::vec3 camera,
+               float draw_distance)
+{
+    auto row = [&](int i) {
+        return glm::vec4{
+            view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]};
+    };
+    // zero to one depth, so the near plane is z alone
+    view result{.planes = {row(3) + row(0),
+                           row(3) - row(0),
+                           row(3) + row(1),
+                           row(3) - row(1),
+                           row(2),
+                           row(3) - row(2)},
+                .camera = glm::vec4{camera, draw_distance}};
+    // spheres need true distances, unlike the lod's box tests
+    for (auto& plane : result.planes)
+    {
+        plane /= glm::length(glm::vec3{plane});
+    }
+    return result;
+}
+
+glm::vec4 bounding_sphere(std::span<const assets::vertex> vertices)
+{
+    if (vertices.empty())
+    {
+        return glm::vec4{0.f};
+    }
+    // centered on the bounds, a little looser than a minimal sphere
+    auto min = vertices.front().position;
+    auto max = min;
+    for (const auto& v : vertices)
+    {
+        min = glm::min(min, v.position);
+        max = glm::max(max, v.position);
+    }
+    auto center = (min + max) * 0.5f;
+    auto radius = 0.f;
+    for (const auto& v : vertices)
+    {
+        radius = std::max(radius, glm::length(v.position - center));
+    }
+    return glm::vec4{center, radius};
+}
+
+glm::vec4 transform_sphere(glm::vec4 sphere, const glm::mat4& model)
+{
+    auto center = glm::vec3{model * glm::vec4{glm::vec3{sphere}, 1.f}};
+    auto scale  = std::max({glm::length(glm::vec3{model[0]}),
+                           glm::length(glm::vec3{model[1]}),
+                           glm::length(glm::vec3{model[2]})});
+    return glm::vec4{center, sphere.w * scale};
+}
+
+glm::vec4 transform_cone(glm::vec4 cone, const glm::mat4& model)
+{
+    if (cone.w >= 1.f)
+    {
+        return no_cone;
+    }
+    glm::mat3 linear{model};
+    auto x = glm::length(linear[0]);
+    auto y = glm::length(linear[1]);
+    auto z = glm::length(linear[2]);
+    constexpr float tolerance = 1e-3f;
+    if (std::abs(x - y) > tolerance * x or std::abs(x - z) > tolerance * x or
+        glm::determinant(linear) <= 0.f)
+    {
+        return no_cone;
+    }
+    return glm::vec4{glm::normalize(linear * glm::vec3{cone}), cone.w};
+}
+
+bool visible(const view& v, glm::vec4 sphere)
+{
+    auto center = glm::vec3{sphere};
+    for (const auto& plane : v.planes)
+    {
+        if (glm::dot(glm::vec3{plane}, center) + plane.w < -sphere.w)
+        {
+            return false;
+        }
+    }
+    return glm::length(glm::vec3{v.camera} - center) - sphere.w <
+           v.camera.w;
+}
+
+bool backfacing(const view& v, glm::vec4 sphere, glm::vec4 cone)
+{
+    auto offset = glm::vec3{sphere} - glm::vec3{v.camera};
+    return glm::dot(offset, glm::vec3{cone}) >=
+           cone.w * glm::length(offset) + sphere.w;
+}
+
+uint32_t cull(const view& v,
+              std::span<const instance_bounds> instances,
+              std::span<const draw_command> draws,
+              std::span<uint32_t> visible_instances,
+              std::span<draw_command> commands)
+{
+    std::vector<uint32_t> counts(draws.size());
+    jobs::parallel_for(
+        to<uint32_t>(draws.size()),
+        draws_per_task,
+        [&](uint32_t first, uint32_t last) {
+            for (auto d = first; d < last; ++d)
+            {
+                const auto& draw = draws[d];
+                auto end  = draw.first_instance + draw.instance_count;
+                auto kept = draw.first_instance;
+                for (auto i = draw.first_instance; i < end; ++i)
+                {
+                    const auto& bounds = instances[i];
+                    if (visible(v, bounds.sphere) and
+                        not backfacing(v, bounds.sphere, bounds.cone))
+                    {
+                        visible_instances[kept++] = bounds.instance;
+                    }
+                }
+                counts[d] = kept - draw.first_instance;
+            }
+        });
+
+    // in draw order, so the cpu path submits the same sequence every frame
+    uint32_t written = 0;
+    for (size_t d = 0; d < draws.size(); ++d)
+    {
+        if (counts[d] != 0)
+        {
+            commands[written]                = draws[d];
+            commands[written].instance_count = counts[d];
+            ++written;
+        }
+    }
+    return written;
+}
+} // namespace wf::culling
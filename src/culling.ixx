@@ -0,0 +1,70 @@
+module;
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+
+export module culling;
+
+import assets;
+
+namespace wf::culling
+{
+// same layout as VkDrawIndexedIndirectCommand, the gpu pass writes these
+export struct draw_command
+{
+    uint32_t index_count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    uint32_t first_instance;
+};
+static_assert(sizeof(draw_command) == 20);
+
+// world space bounds of one instance of a draw, either of a whole mesh or of
+// one of its meshlets, and the transform it is drawn with. padded to the
+// std430 stride of shaders/cull.comp
+export struct instance_bounds
+{
+    glm::vec4 sphere; // center, radius
+    glm::vec4 cone;   // axis, cutoff, see meshopt::meshlet
+    uint32_t draw;
+    uint32_t instance;
+    uint32_t padding[2];
+};
+static_assert(sizeof(instance_bounds) == 48);
+
+// a cone no camera position is behind, for bounds without one
+export constexpr glm::vec4 no_cone{0.f, 0.f, 0.f, 1.f};
+
+// normalized planes facing inwards and the distance past which nothing is
+// drawn, the push constant block of shaders/cull.comp starts with it
+export struct view
+{
+    std::array<glm::vec4, 6> planes;
+    glm::vec4 camera; // position, draw distance
+};
+
+export view make_view(const glm::mat4& view_proj,
+                      glm::vec3 camera,
+                      float draw_distance);
+
+export glm::vec4 bounding_sphere(std::span<const assets::vertex> vertices);
+export glm::vec4 transform_sphere(glm::vec4 sphere, const glm::mat4& model);
+// no_cone unless model keeps angles and winding, scaled axes would bend the
+// normals the cone was fitted to
+export glm::vec4 transform_cone(glm::vec4 cone, const glm::mat4& model);
+export bool visible(const view& v, glm::vec4 sphere);
+// whether every triangle inside the sphere faces away from the camera
+export bool backfacing(const view& v, glm::vec4 sphere, glm::vec4 cone);
+
+// every draw starts out covering all its instances, the transform indices
+// of the visible ones are written to the front of the draw's instance range
+// and the draws left with any are compacted into commands, returns how many
+// were written
+export uint32_t cull(const view& v,
+                     std::span<const instance_bounds> instances,
+                     std::span<const draw_command> draws,
+                     std::span<uint32_t> visible_instances,
+                     std::span<draw_command> commands);
+} // namespace wf::culling
@@ -0,0 +1,720 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <numbers>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WF_GERSTNER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define WF_TARGET_AVX2
+#define WF_TARGET_AVX512
+#else
+#define WF_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define WF_TARGET_AVX512 __attribute__((target("avx512f,fma")))
+#endif
+#else
+#define WF_GERSTNER_X86 0
+#endif
+
+module gerstner;
+
+namespace wf::gerstner
+{
+constexpr float gravity    = 9.81f;
+constexpr size_t max_width = 16;
+
+// sincos split into the quadrant and a minimax polynomial on [-pi/4, pi/4],
+// every kernel below evaluates the exact same sequence of operations
+constexpr float two_over_pi = 0.636619772367581343f;
+constexpr float pio2_hi     = 1.5703125f;
+constexpr float pio2_mid    = 4.837512969970703125e-4f;
+constexpr float pio2_lo     = 7.54978995489188216e-8f;
+constexpr float sin_c0      = -1.6666654611e-1f;
+constexpr float sin_c1      = 8.3321608736e-3f;
+constexpr float sin_c2      = -1.9515295891e-4f;
+constexpr float cos_c0      = 4.166664568298827e-2f;
+constexpr float cos_c1      = -1.388731625493765e-3f;
+constexpr float cos_c2      = 2.443315711809948e-5f;
+
+void sincos_scalar(float x, float& s, float& c)
+{
+    float q = std::nearbyint(x * two_over_pi);
+    auto quadrant = static_cast<int32_t>(q);
+    float r = x - q * pio2_hi;
+    r       = r - q * pio2_mid;
+    r       = r - q * pio2_lo;
+    float r2 = r * r;
+
+    float sin_r = r + r * r2 * (sin_c0 + r2 * (sin_c1 + r2 * sin_c2));
+    float cos_r = 1.f - 0.5f * r2 +
+                  r2 * r2 * (cos_c0 + r2 * (cos_c1 + r2 * cos_c2));
+
+    bool swap = quadrant & 1;
+    s         = swap ? cos_r : sin_r;
+    c         = swap ? sin_r : cos_r;
+    if (quadrant & 2)
+    {
+        s = -s;
+    }
+    if ((quadrant + 1) & 2)
+    {
+        c = -c;
+    }
+}
+
+// same as above with every multiply add fused, in the order waves.comp uses
+void sincos_fused(float x, float& s, float& c)
+{
+    float q       = std::nearbyint(x * two_over_pi);
+    auto quadrant = static_cast<int32_t>(q);
+    float r       = std::fma(-q, pio2_hi, x);
+    r             = std::fma(-q, pio2_mid, r);
+    r             = std::fma(-q, pio2_lo, r);
+    float r2      = r * r;
+
+    float sin_p = std::fma(r2, sin_c2, sin_c1);
+    sin_p       = std::fma(r2, sin_p, sin_c0);
+    float sin_r = std::fma(r * r2, sin_p, r);
+
+    float cos_p = std::fma(r2, cos_c2, cos_c1);
+    cos_p       = std::fma(r2, cos_p, cos_c0);
+    float cos_r = std::fma(r2 * r2, cos_p, std::fma(-0.5f, r2, 1.f));
+
+    bool swap = quadrant & 1;
+    s         = swap ? cos_r : sin_r;
+    c         = swap ? sin_r : cos_r;
+    if (quadrant & 2)
+    {
+        s = -s;
+    }
+    if ((quadrant + 1) & 2)
+    {
+        c = -c;
+    }
+}
+
+void wave_table::resize(size_t count)
+{
+    for (auto* stream : {&kdx,
+                         &kdy,
+                         &phase,
+                         &qa_dx,
+                         &qa_dy,
+                         &amplitude,
+                         &a_xx,
+                         &a_xy,
+                         &a_yy,
+                         &b_x,
+                         &b_y})
+    {
+        stream->resize(count);
+    }
+}
+
+size_t wave_table::size() const
+{
+    return kdx.size();
+}
+
+void surface_streams::resize(size_t count)
+{
+    for (auto* stream : {&x, &y, &z, &nx, &ny, &nz})
+    {
+        stream->resize(count);
+    }
+}
+
+void store_point(surface_streams& out,
+                 size_t i,
+                 float x,
+                 float y,
+                 float sx,
+                 float sy,
+                 float z,
+                 float axx,
+                 float axy,
+                 float ayy,
+                 float bx,
+                 float by)
+{
+    out.x[i] = x - sx;
+    out.y[i] = y - sy;
+    out.z[i] = z;
+
+    // exact normal, cross product of the two tangents of the displaced grid
+    float nx = axy * by + bx * (1.f - ayy);
+    float ny = bx * axy + by * (1.f - axx);
+    float nz = (1.f - axx) * (1.f - ayy) - axy * axy;
+    float inv_length = 1.f / std::sqrt(nx * nx + ny * ny + nz * nz);
+    out.nx[i] = nx * inv_length;
+    out.ny[i] = ny * inv_length;
+    out.nz[i] = nz * inv_length;
+}
+
+void evaluate_scalar(const wave_table& table,
+                     const float* x,
+                     const float* y,
+                     surface_streams& out,
+                     size_t first,
+                     size_t last)
+{
+    for (size_t i = first; i < last; ++i)
+    {
+        float sx = 0.f, sy = 0.f, z = 0.f;
+        float axx = 0.f, axy = 0.f, ayy = 0.f, bx = 0.f, by = 0.f;
+        for (size_t j = 0; j < table.size(); ++j)
+        {
+            float theta = table.kdx[j] * x[i] + table.kdy[j] * y[i] +
+                          table.phase[j];
+            float s, c;
+            sincos_scalar(theta, s, c);
+            sx += table.qa_dx[j] * s;
+            sy += table.qa_dy[j] * s;
+            z += table.amplitude[j] * c;
+            axx += table.a_xx[j] * c;
+            axy += table.a_xy[j] * c;
+            ayy += table.a_yy[j] * c;
+            bx += table.b_x[j] * s;
+            by += table.b_y[j] * s;
+        }
+        store_point(out, i, x[i], y[i], sx, sy, z, axx, axy, ayy, bx, by);
+    }
+}
+
+#if WF_GERSTNER_X86
+WF_TARGET_AVX2 inline void sincos_avx2(__m256 x, __m256& s, __m256& c)
+{
+    __m256 q = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(two_over_pi)),
+                               _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256i quadrant = _mm256_cvtps_epi32(q);
+    __m256 r = _mm256_fnmadd_ps(q, _mm256_set1_ps(pio2_hi), x);
+    r        = _mm256_fnmadd_ps(q, _mm256_set1_ps(pio2_mid), r);
+    r        = _mm256_fnmadd_ps(q, _mm256_set1_ps(pio2_lo), r);
+    __m256 r2 = _mm256_mul_ps(r, r);
+
+    __m256 sin_p = _mm256_fmadd_ps(
+        r2, _mm256_set1_ps(sin_c2), _mm256_set1_ps(sin_c1));
+    sin_p = _mm256_fmadd_ps(r2, sin_p, _mm256_set1_ps(sin_c0));
+    __m256 sin_r = _mm256_fmadd_ps(_mm256_mul_ps(r, r2), sin_p, r);
+
+    __m256 cos_p = _mm256_fmadd_ps(
+        r2, _mm256_set1_ps(cos_c2), _mm256_set1_ps(cos_c1));
+    cos_p = _mm256_fmadd_ps(r2, cos_p, _mm256_set1_ps(cos_c0));
+    __m256 cos_r = _mm256_fmadd_ps(_mm256_mul_ps(r2, r2),
+                                   cos_p,
+                                   _mm256_fnmadd_ps(_mm256_set1_ps(0.5f),
+                                                    r2,
+                                                    _mm256_set1_ps(1.f)));
+
+    __m256i one  = _mm256_set1_epi32(1);
+    __m256i two  = _mm256_set1_epi32(2);
+    __m256 swap  = _mm256_castsi256_ps(
+        _mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+    __m256 sin_sign = _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_and_si256(quadrant, two), 30));
+    __m256 cos_sign = _mm256_castsi256_ps(_mm256_slli_epi32(
+        _mm256_and_si256(_mm256_add_epi32(quadrant, one), two), 30));
+
+    s = _mm256_xor_ps(_mm256_blendv_ps(sin_r, cos_r, swap), sin_sign);
+    c = _mm256_xor_ps(_mm256_blendv_ps(cos_r, sin_r, swap), cos_sign);
+}
+
+WF_TARGET_AVX2 void evaluate_avx2(const wave_table& table,
+                                  const float* x,
+                                  const float* y,
+                                  surface_streams& out,
+                                  size_t first,
+                                  size_t last)
+{
+    const __m256 one = _mm256_set1_ps(1.f);
+    for (size_t i = first; i < last; i += 8)
+    {
+        __m256 px  = _mm256_loadu_ps(x + i);
+        __m256 py  = _mm256_loadu_ps(y + i);
+        __m256 sx  = _mm256_setzero_ps();
+        __m256 sy  = _mm256_setzero_ps();
+        __m256 z   = _mm256_setzero_ps();
+        __m256 axx = _mm256_setzero_ps();
+        __m256 axy = _mm256_setzero_ps();
+        __m256 ayy = _mm256_setzero_ps();
+        __m256 bx  = _mm256_setzero_ps();
+        __m256 by  = _mm256_setzero_ps();
+
+        for (size_t j = 0; j < table.size(); ++j)
+        {
+            __m256 theta = _mm256_fmadd_ps(
+                _mm256_set1_ps(table.kdx[j]),
+                px,
+                _mm256_fmadd_ps(_mm256_set1_ps(table.kdy[j]),
+                                py,
+                                _mm256_set1_ps(table.phase[j])));
+            __m256 s, c;
+            sincos_avx2(theta, s, c);
+            sx  = _mm256_fmadd_ps(_mm256_set1_ps(table.qa_dx[j]), s, sx);
+            sy  = _mm256_fmadd_ps(_mm256_set1_ps(table.qa_dy[j]), s, sy);
+            z   = _mm256_fmadd_ps(_mm256_set1_ps(table.amplitude[j]), c, z);
+            axx = _mm256_fmadd_ps(_mm256_set1_ps(table.a_xx[j]), c, axx);
+            axy = _mm256_fmadd_ps(_mm256_set1_ps(table.a_xy[j]), c, axy);
+            ayy = _mm256_fmadd_ps(_mm256_set1_ps(table.a_yy[j]), c, ayy);
+            bx  = _mm256_fmadd_ps(_mm256_set1_ps(table.b_x[j]), s, bx);
+            by  = _mm256_fmadd_ps(_mm256_set1_ps(table.b_y[j]), s, by);
+        }
+
+        __m256 one_axx = _mm256_sub_ps(one, axx);
+        __m256 one_ayy = _mm256_sub_ps(one, ayy);
+        __m256 nx = _mm256_fmadd_ps(axy, by, _mm256_mul_ps(bx, one_ayy));
+        __m256 ny = _mm256_fmadd_ps(bx, axy, _mm256_mul_ps(by, one_axx));
+        __m256 nz = _mm256_fmsub_ps(one_axx, one_ayy, _mm256_mul_ps(axy, axy));
+        __m256 length = _mm256_sqrt_ps(_mm256_fmadd_ps(
+            nx, nx, _mm256_fmadd_ps(ny, ny, _mm256_mul_ps(nz, nz))));
+
+        _mm256_storeu_ps(out.x.data() + i, _mm256_sub_ps(px, sx));
+        _mm256_storeu_ps(out.y.data() + i, _mm256_sub_ps(py, sy));
+        _mm256_storeu_ps(out.z.data() + i, z);
+        _mm256_storeu_ps(out.nx.data() + i, _mm256_div_ps(nx, length));
+        _mm256_storeu_ps(out.ny.data() + i, _mm256_div_ps(ny, length));
+        _mm256_storeu_ps(out.nz.data() + i, _mm256_div_ps(nz, length));
+    }
+}
+
+WF_TARGET_AVX512 inline void sincos_avx512(__m512 x, __m512& s, __m512& c)
+{
+    __m512 q = _mm512_roundscale_ps(
+        _mm512_mul_ps(x, _mm512_set1_ps(two_over_pi)),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512i quadrant = _mm512_cvtps_epi32(q);
+    __m512 r = _mm512_fnmadd_ps(q, _mm512_set1_ps(pio2_hi), x);
+    r        = _mm512_fnmadd_ps(q, _mm512_set1_ps(pio2_mid), r);
+    r        = _mm512_fnmadd_ps(q, _mm512_set1_ps(pio2_lo), r);
+    __m512 r2 = _mm512_mul_ps(r, r);
+
+    __m512 sin_p = _mm512_fmadd_ps(
+        r2, _mm512_set1_ps(sin_c2), _mm512_set1_ps(sin_c1));
+    sin_p = _mm512_fmadd_ps(r2, sin_p, _mm512_set1_ps(sin_c0));
+    __m512 sin_r = _mm512_fmadd_ps(_mm512_mul_ps(r, r2), sin_p, r);
+
+    __m512 cos_p = _mm512_fmadd_ps(
+        r2, _mm512_set1_ps(cos_c2), _mm512_set1_ps(cos_c1));
+    cos_p = _mm512_fmadd_ps(r2, cos_p, _mm512_set1_ps(cos_c0));
+    __m512 cos_r = _mm512_fmadd_ps(_mm512_mul_ps(r2, r2),
+                                   cos_p,
+                                   _mm512_fnmadd_ps(_mm512_set1_ps(0.5f),
+                                                    r2,
+                                                    _mm512_set1_ps(1.f)));
+
+    __m512i one     = _mm512_set1_epi32(1);
+    __m512i two     = _mm512_set1_epi32(2);
+    __mmask16 swap  = _mm512_test_epi32_mask(quadrant, one);
+    __m512i sin_sign = _mm512_slli_epi32(_mm512_and_si512(quadrant, two), 30);
+    __m512i cos_sign = _mm512_slli_epi32(
+        _mm512_and_si512(_mm512_add_epi32(quadrant, one), two), 30);
+
+    s = _mm512_castsi512_ps(_mm512_xor_si512(
+        _mm512_castps_si512(_mm512_mask_blend_ps(swap, sin_r, cos_r)),
+        sin_sign));
+    c = _mm512_castsi512_ps(_mm512_xor_si512(
+        _mm512_castps_si512(_mm512_mask_blend_ps(swap, cos_r, sin_r)),
+        cos_sign));
+}
+
+WF_TARGET_AVX512 void evaluate_avx512(const wave_table& table,
+                                      const float* x,
+                                      const float* y,
+                                      surface_streams& out,
+                                      size_t first,
+                                      size_t last)
+{
+    const __m512 one = _mm512_set1_ps(1.f);
+    for (size_t i = first; i < last; i += 16)
+    {
+        __m512 px  = _mm512_loadu_ps(x + i);
+        __m512 py  = _mm512_loadu_ps(y + i);
+        __m512 sx  = _mm512_setzero_ps();
+        __m512 sy  = _mm512_setzero_ps();
+        __m512 z   = _mm512_setzero_ps();
+        __m512 axx = _mm512_setzero_ps();
+        __m512 axy = _mm512_setzero_ps();
+        __m512 ayy = _mm512_setzero_ps();
+        __m512 bx  = _mm512_setzero_ps();
+        __m512 by  = _mm512_setzero_ps();
+
+        for (size_t j = 0; j < table.size(); ++j)
+        {
+            __m512 theta = _mm512_fmadd_ps(
+                _mm512_set1_ps(table.kdx[j]),
+                px,
+                _mm512_fmadd_ps(_mm512_set1_ps(table.kdy[j]),
+                                py,
+                                _mm512_set1_ps(table.phase[j])));
+            __m512 s, c;
+            sincos_avx512(theta, s, c);
+            sx  = _mm512_fmadd_ps(_mm512_set1_ps(table.qa_dx[j]), s, sx);
+            sy  = _mm512_fmadd_ps(_mm512_set1_ps(table.qa_dy[j]), s, sy);
+            z   = _mm512_fmadd_ps(_mm512_set1_ps(table.amplitude[j]), c, z);
+            axx = _mm512_fmadd_ps(_mm512_set1_ps(table.a_xx[j]), c, axx);
+            axy = _mm512_fmadd_ps(_mm512_set1_ps(table.a_xy[j]), c, axy);
+            ayy = _mm512_fmadd_ps(_mm512_set1_ps(table.a_yy[j]), c, ayy);
+            bx  = _mm512_fmadd_ps(_mm512_set1_ps(table.b_x[j]), s, bx);
+            by  = _mm512_fmadd_ps(_mm512_set1_ps(table.b_y[j]), s, by);
+        }
+
+        __m512 one_axx = _mm512_sub_ps(one, axx);
+        __m512 one_ayy = _mm512_sub_ps(one, ayy);
+        __m512 nx = _mm512_fmadd_ps(axy, by, _mm512_mul_ps(bx, one_ayy));
+        __m512 ny = _mm512_fmadd_ps(bx, axy, _mm512_mul_ps(by, one_axx));
+        __m512 nz = _mm512_fmsub_ps(one_axx, one_ayy, _mm512_mul_ps(axy, axy));
+        __m512 length = _mm512_sqrt_ps(_mm512_fmadd_ps(
+            nx, nx, _mm512_fmadd_ps(ny, ny, _mm512_mul_ps(nz, nz))));
+
+        _mm512_storeu_ps(out.x.data() + i, _mm512_sub_ps(px, sx));
+        _mm512_storeu_ps(out.y.data() + i, _mm512_sub_ps(py, sy));
+        _mm512_storeu_ps(out.z.data() + i, z);
+        _mm512_storeu_ps(out.nx.data() + i, _mm512_div_ps(nx, length));
+        _mm512_storeu_ps(out.ny.data() + i, _mm512_div_ps(ny, length));
+        _mm512_storeu_ps(out.nz.data() + i, _mm512_div_ps(nz, length));
+    }
+}
+
+bool cpu_supports(isa kernel)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    std::array<int, 4> leaf1{}, leaf7{};
+    __cpuid(leaf1.data(), 1);
+    __cpuidex(leaf7.data(), 7, 0);
+    bool os_avx = (leaf1[2] & (1 << 27)) and ((_xgetbv(0) & 0x6) == 0x6);
+    bool fma    = leaf1[2] & (1 << 12);
+    bool avx2   = os_avx and fma and (leaf7[1] & (1 << 5));
+    bool avx512 = avx2 and (leaf7[1] & (1 << 16)) and
+                  ((_xgetbv(0) & 0xe6) == 0xe6);
+#else
+    __builtin_cpu_init();
+    bool avx2 =
+        __builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma");
+    bool avx512 = avx2 and __builtin_cpu_supports("avx512f");
+#endif
+    switch (kernel)
+    {
+    case isa::avx2:
+        return avx2;
+    case isa::avx512:
+        return avx512;
+    default:
+        return true;
+    }
+}
+#else
+void evaluate_avx2(const wave_table& table,
+                   const float* x,
+                   const float* y,
+                   surface_streams& out,
+                   size_t first,
+                   size_t last)
+{
+    evaluate_scalar(table, x, y, out, first, last);
+}
+
+void evaluate_avx512(const wave_table& table,
+                     const float* x,
+                     const float* y,
+                     surface_streams& out,
+                     size_t first,
+                     size_t last)
+{
+    evaluate_scalar(table, x, y, out, first, last);
+}
+
+bool cpu_supports(isa kernel)
+{
+    return kernel == isa::scalar;
+}
+#endif
+
+std::vector<isa> supported_isas()
+{
+    std::vector<isa> isas;
+    for (auto kernel : {isa::scalar, isa::avx2, isa::avx512})
+    {
+        if (cpu_supports(kernel))
+        {
+            isas.push_back(kernel);
+        }
+    }
+    return isas;
+}
+
+isa best_isa()
+{
+    static const isa best = supported_isas().back();
+    return best;
+}
+
+std::vector<wave> make_waves(uint32_t count,
+                             glm::vec2 wind_direction,
+                             float median_wavelength,
+                             float steepness,
+                             uint32_t seed)
+{
+    std::mt19937 engine{seed};
+    std::uniform_real_distribution<float> octave{-1.f, 1.f};
+    std::uniform_real_distribution<float> spread{-std::numbers::pi_v<float> /
+                                                     3.f,
+                                                 std::numbers::pi_v<float> /
+                                                     3.f};
+    std::uniform_real_distribution<float> phase{
+        0.f, 2.f * std::numbers::pi_v<float>};
+
+    auto wind_angle = std::atan2(wind_direction.y, wind_direction.x);
+    std::vector<wave> waves(count);
+    for (auto& w : waves)
+    {
+        auto angle   = wind_angle + spread(engine);
+        w.direction  = {std::cos(angle), std::sin(angle)};
+        w.wavelength = median_wavelength * std::exp2(octave(engine));
+        w.amplitude  = w.wavelength / 120.f;
+        w.steepness  = steepness;
+        w.phase      = phase(engine);
+    }
+    return waves;
+}
+
+wave_field::wave_field(std::span<const wave> waves,
+                       uint32_t resolution,
+                       float patch_size,
+                       isa kernel)
+    : waves_{std::begin(waves), std::end(waves)}, resolution_{resolution},
+      patch_size_{patch_size},
+      point_count_{size_t{resolution} * resolution}, isa_{kernel}
+{
+    set_isa(kernel);
+    omega_.resize(waves_.size());
+    wavenumber_.resize(waves_.size());
+    table_.resize(waves_.size());
+    for (size_t j = 0; j < waves_.size(); ++j)
+    {
+        waves_[j].direction = glm::normalize(waves_[j].direction);
+        wavenumber_[j] = 2.f * std::numbers::pi_v<float> / waves_[j].wavelength;
+        omega_[j]      = std::sqrt(gravity * wavenumber_[j]);
+    }
+
+    auto padded = (point_count_ + max_width - 1) / max_width * max_width;
+    grid_x_.resize(padded);
+    grid_y_.resize(padded);
+    surface_.resize(padded);
+
+    auto cell_size = patch_size_ / resolution_;
+    auto origin    = -0.5f * patch_size_;
+    for (uint32_t y = 0; y < resolution_; ++y)
+    {
+        for (uint32_t x = 0; x < resolution_; ++x)
+        {
+            auto i     = size_t{y} * resolution_ + x;
+            grid_x_[i] = origin + x * cell_size;
+            grid_y_[i] = origin + y * cell_size;
+        }
+    }
+}
+
+void wave_field::prepare_(float time)
+{
+    // steepness is shared between waves so crests never loop over
+    auto count = static_cast<float>(waves_.size());
+    for (size_t j = 0; j < waves_.size(); ++j)
+    {
+        const auto& w = waves_[j];
+        auto k        = wavenumber_[j];
+        auto q        = std::clamp(w.steepness, 0.f, 1.f) /
+                 (k * w.amplitude * count);
+        auto phase = std::fmod(static_cast<double>(w.phase) -
+                                   static_cast<double>(omega_[j]) * time,
+                               2. * std::numbers::pi);
+
+        table_.kdx[j]       = k * w.direction.x;
+        table_.kdy[j]       = k * w.direction.y;
+        table_.phase[j]     = static_cast<float>(phase);
+        table_.qa_dx[j]     = q * w.amplitude * w.direction.x;
+        table_.qa_dy[j]     = q * w.amplitude * w.direction.y;
+        table_.amplitude[j] = w.amplitude;
+        table_.a_xx[j] = q * w.amplitude * k * w.direction.x * w.direction.x;
+        table_.a_xy[j] = q * w.amplitude * k * w.direction.x * w.direction.y;
+        table_.a_yy[j] = q * w.amplitude * k * w.direction.y * w.direction.y;
+        table_.b_x[j]  = w.amplitude * k * w.direction.x;
+        table_.b_y[j]  = w.amplitude * k * w.direction.y;
+    }
+}
+
+void wave_field::update(float time)
+{
+    prepare_(time);
+    auto padded = grid_x_.size();
+    switch (isa_)
+    {
+    case isa::avx512:
+        evaluate_avx512(
+            table_, grid_x_.data(), grid_y_.data(), surface_, 0, padded);
+        break;
+    case isa::avx2:
+        evaluate_avx2(
+            table_, grid_x_.data(), grid_y_.data(), surface_, 0, padded);
+        break;
+    default:
+        evaluate_scalar(
+            table_, grid_x_.data(), grid_y_.data(), surface_, 0, padded);
+        break;
+    }
+}
+
+void wave_field::set_isa(isa kernel)
+{
+    auto isas = supported_isas();
+    isa_      = std::ranges::find(isas, kernel) != std::end(isas) ? kernel
+                                                                  : isa::scalar;
+}
+
+isa wave_field::kernel_isa() const
+{
+    return isa_;
+}
+
+uint32_t wave_field::resolution() const
+{
+    return resolution_;
+}
+
+float wave_field::patch_size() const
+{
+    return patch_size_;
+}
+
+size_t wave_field::point_count() const
+{
+    return point_count_;
+}
+
+size_t wave_field::wave_count() const
+{
+    return waves_.size();
+}
+
+const surface_streams& wave_field::surface() const
+{
+    return surface_;
+}
+
+uint32_t wave_field::write_constants(float time,
+                                     std::span<wave_constants> out)
+{
+    if (out.size() < waves_.size())
+    {
+        throw std::runtime_error{"wave constants buffer is too small!"};
+    }
+    prepare_(time);
+    for (size_t j = 0; j < waves_.size(); ++j)
+    {
+        out[j] = {
+            .kdx       = table_.kdx[j],
+            .kdy       = table_.kdy[j],
+            .phase     = table_.phase[j],
+            .amplitude = table_.amplitude[j],
+            .qa_dx     = table_.qa_dx[j],
+            .qa_dy     = table_.qa_dy[j],
+            .b_x       = table_.b_x[j],
+            .b_y       = table_.b_y[j],
+            .a_xx      = table_.a_xx[j],
+            .a_xy      = table_.a_xy[j],
+            .a_yy      = table_.a_yy[j],
+            .unused    = 0.f,
+        };
+    }
+    return static_cast<uint32_t>(waves_.size());
+}
+
+void wave_field::evaluate_reference(float time,
+                                    std::span<glm::vec3> positions,
+                                    std::span<glm::vec3> normals)
+{
+    prepare_(time);
+    auto cell_size = patch_size_ / resolution_;
+    auto origin    = -0.5f * patch_size_;
+    for (size_t i = 0; i < point_count_; ++i)
+    {
+        float x = std::fma(
+            static_cast<float>(i % resolution_), cell_size, origin);
+        float y = std::fma(
+            static_cast<float>(i / resolution_), cell_size, origin);
+
+        float sx = 0.f, sy = 0.f, z = 0.f;
+        float axx = 0.f, axy = 0.f, ayy = 0.f, bx = 0.f, by = 0.f;
+        for (size_t j = 0; j < table_.size(); ++j)
+        {
+            float theta = std::fma(
+                table_.kdx[j], x, std::fma(table_.kdy[j], y, table_.phase[j]));
+            float s, c;
+            sincos_fused(theta, s, c);
+            sx  = std::fma(table_.qa_dx[j], s, sx);
+            sy  = std::fma(table_.qa_dy[j], s, sy);
+            z   = std::fma(table_.amplitude[j], c, z);
+            axx = std::fma(table_.a_xx[j], c, axx);
+            axy = std::fma(table_.a_xy[j], c, axy);
+            ayy = std::fma(table_.a_yy[j], c, ayy);
+            bx  = std::fma(table_.b_x[j], s, bx);
+            by  = std::fma(table_.b_y[j], s, by);
+        }
+
+        float one_axx = 1.f - axx;
+        float one_ayy = 1.f - ayy;
+        float nx      = std::fma(axy, by, bx * one_ayy);
+        float ny      = std::fma(bx, axy, by * one_axx);
+        float nz      = std::fma(one_axx, one_ayy, -(axy * axy));
+        float length =
+            std::sqrt(std::fma(nx, nx, std::fma(ny, ny, nz * nz)));
+
+        positions[i] = {x - sx, y - sy, z};
+        normals[i]   = {nx / length, ny / length, nz / length};
+    }
+}
+
+glm::vec3 wave_field::surface_at(glm::vec3 probe, float time) const
+{
+    // the grid moves horizontally, so find the rest position whose displaced
+    // point lands on the probe by fixed point iteration
+    auto count = static_cast<float>(waves_.size());
+    glm::vec2 rest{probe.x, probe.y};
+    glm::vec3 point{};
+    for (int iteration = 0; iteration < 4; ++iteration)
+    {
+        point = {rest, 0.f};
+        for (size_t j = 0; j < waves_.size(); ++j)
+        {
+            const auto& w = waves_[j];
+            auto k        = wavenumber_[j];
+            auto q        = std::clamp(w.steepness, 0.f, 1.f) /
+                     (k * w.amplitude * count);
+            auto theta = k * glm::dot(w.direction, rest) - omega_[j] * time +
+                         w.phase;
+            point.x -= q * w.amplitude * w.direction.x * std::sin(theta);
+            point.y -= q * w.amplitude * w.direction.y * std::sin(theta);
+            point.z += w.amplitude * std::cos(theta);
+        }
+        rest += glm::vec2{probe.x, probe.y} - glm::vec2{point.x, point.y};
+    }
+    return {probe.x, probe.y, point.z};
+}
+
+glm::vec3 wave_field::normal_at(glm::vec3 probe, float time) const
+{
+    constexpr float epsilon = 0.05f;
+    auto center = surface_at(probe, time);
+    auto dx     = surface_at(probe + glm::vec3{epsilon, 0.f, 0.f}, time);
+    auto dy     = surface_at(probe + glm::vec3{0.f, epsilon, 0.f}, time);
+    return glm::normalize(glm::cross(dx - center, dy - center));
+}
+} // namespace wf::gerstner
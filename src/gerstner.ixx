@@ -0,0 +1,158 @@
+module;
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+export module gerstner;
+
+import utils;
+
+namespace wf::gerstner
+{
+export struct wave
+{
+    glm::vec2 direction;
+    float wavelength;
+    float amplitude;
+    float steepness;
+    float phase;
+};
+
+export enum class isa
+{
+    scalar,
+    avx2,
+    avx512
+};
+
+export std::vector<isa> supported_isas();
+export isa best_isa();
+
+// builds a wind driven set of waves with wavelengths spread around the median
+// and directions scattered inside a half plane facing the wind
+export std::vector<wave> make_waves(uint32_t count,
+                                    glm::vec2 wind_direction,
+                                    float median_wavelength,
+                                    float steepness,
+                                    uint32_t seed = 1337);
+
+// per frame constants of every wave laid out as separate streams so kernels
+// broadcast one value per wave and iterate points in registers
+struct wave_table
+{
+    std::vector<float> kdx;
+    std::vector<float> kdy;
+    std::vector<float> phase;
+    std::vector<float> qa_dx;
+    std::vector<float> qa_dy;
+    std::vector<float> amplitude;
+    std::vector<float> a_xx;
+    std::vector<float> a_xy;
+    std::vector<float> a_yy;
+    std::vector<float> b_x;
+    std::vector<float> b_y;
+
+    void resize(size_t count);
+    size_t size() const;
+};
+
+export struct surface_streams
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> nx;
+    std::vector<float> ny;
+    std::vector<float> nz;
+
+    void resize(size_t count);
+};
+
+// per wave constants in the std430 layout read by shaders/waves.comp
+export struct wave_constants
+{
+    float kdx;
+    float kdy;
+    float phase;
+    float amplitude;
+    float qa_dx;
+    float qa_dy;
+    float b_x;
+    float b_y;
+    float a_xx;
+    float a_xy;
+    float a_yy;
+    float unused;
+};
+static_assert(sizeof(wave_constants) == 48);
+
+export class wave_field : non_copyable
+{
+  private:
+    std::vector<wave> waves_;
+    std::vector<float> omega_;
+    std::vector<float> wavenumber_;
+    wave_table table_;
+    uint32_t resolution_;
+    float patch_size_;
+    size_t point_count_;
+    isa isa_;
+
+    // rest positions of the grid padded to a multiple of the widest kernel
+    std::vector<float> grid_x_;
+    std::vector<float> grid_y_;
+    surface_streams surface_;
+
+    void prepare_(float time);
+
+  public:
+    wave_field(std::span<const wave> waves,
+               uint32_t resolution,
+               float patch_size,
+               isa kernel = best_isa());
+
+    void update(float time);
+    void set_isa(isa kernel);
+    isa kernel_isa() const;
+
+    uint32_t resolution() const;
+    float patch_size() const;
+    size_t point_count() const;
+    size_t wave_count() const;
+    const surface_streams& surface() const;
+
+    // constants of every wave at the given time for the compute kernel,
+    // returns the number of waves written
+    uint32_t write_constants(float time, std::span<wave_constants> out);
+
+    // cpu twin of the compute kernel, fused multiply adds and all, so it
+    // matches drivers which fuse the kernel's fma too
+    void evaluate_reference(float time,
+                            std::span<glm::vec3> positions,
+                            std::span<glm::vec3> normals);
+
+    // surface point vertically above or below the probe, for buoyancy
+    glm::vec3 surface_at(glm::vec3 probe, float time) const;
+    glm::vec3 normal_at(glm::vec3 probe, float time) const;
+};
+
+void evaluate_scalar(const wave_table& table,
+                     const float* x,
+                     const float* y,
+                     surface_streams& out,
+                     size_t first,
+                     size_t last);
+void evaluate_avx2(const wave_table& table,
+                   const float* x,
+                   const float* y,
+                   surface_streams& out,
+                   size_t first,
+                   size_t last);
+void evaluate_avx512(const wave_table& table,
+                     const float* x,
+                     const float* y,
+                     surface_streams& out,
+                     size_t first,
+                     size_t last);
+} // namespace wf::gerstner
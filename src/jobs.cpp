@@ -0,0 +1,375 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+module jobs;
+
+namespace wf::jobs
+{
+namespace
+{
+// which deque the current thread owns, none outside a pool
+thread_local const scheduler* current_scheduler = nullptr;
+thread_local uint32_t current_worker            = 0;
+} // namespace
+
+bool work_deque::push(task* t)
+{
+    auto bottom = bottom_.load(std::memory_order_relaxed);
+    auto top    = top_.load(std::memory_order_acquire);
+    if (bottom - top >= capacity)
+    {
+        return false;
+    }
+    tasks_[bottom & (capacity - 1)].store(t, std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+task* work_deque::pop()
+{
+    // the bottom is claimed before the top is read, a thief racing for the
+    // same last task then loses either here or at its exchange
+    auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_seq_cst);
+    auto top = top_.load(std::memory_order_seq_cst);
+    if (top > bottom)
+    {
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    auto* t = tasks_[bottom & (capacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        if (not top_.compare_exchange_strong(top,
+                                             top + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed))
+        {
+            t = nullptr;
+        }
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return t;
+}
+
+task* work_deque::steal()
+{
+    auto top    = top_.load(std::memory_order_seq_cst);
+    auto bottom = bottom_.load(std::memory_order_seq_cst);
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+    auto* t = tasks_[top & (capacity - 1)].load(std::memory_order_relaxed);
+    if (not top_.compare_exchange_strong(top,
+                                         top + 1,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return t;
+}
+
+scheduler::scheduler(uint32_t threads)
+{
+    threads = std::max(threads, 1u);
+    deques_.reserve(threads);
+    for (uint32_t i = 0; i < threads; ++i)
+    {
+        deques_.push_back(std::make_unique<work_deque>());
+    }
+    threads_.reserve(threads);
+    for (uint32_t i = 0; i < threads; ++i)
+    {
+        threads_.emplace_back([this, i] { work_(i); });
+    }
+}
+
+scheduler::~scheduler()
+{
+    stopping_ = true;
+    epoch_.fetch_add(1);
+    epoch_.notify_all();
+    threads_.clear();
+}
+
+uint32_t scheduler::workers() const
+{
+    return to<uint32_t>(deques_.size());
+}
+
+void scheduler::submit(job work, std::atomic<uint32_t>& pending)
+{
+    pending.fetch_add(1, std::memory_order_relaxed);
+    auto* t = new task{std::move(work), std::addressof(pending)};
+    if (current_scheduler == this)
+    {
+        if (not deques_[current_worker]->push(t))
+        {
+            run_(t);
+            return;
+        }
+    }
+    else
+    {
+        std::scoped_lock lock{injected_mutex_};
+        injected_.push_back(t);
+    }
+    epoch_.fetch_add(1, std::memory_order_release);
+    epoch_.notify_one();
+}
+
+void scheduler::run_(task* t)
+{
+    t->work();
+    auto* pending = t->pending;
+    delete t;
+    pending->fetch_sub(1, std::memory_order_release);
+}
+
+task* scheduler::find_task_(uint32_t worker)
+{
+    auto owned = current_scheduler == this;
+    if (owned)
+    {
+        if (auto* t = deques_[worker]->pop())
+        {
+            return t;
+        }
+    }
+    {
+        std::scoped_lock lock{injected_mutex_};
+        if (not injected_.empty())
+        {
+            auto* t = injected_.front();
+            injected_.pop_front();
+            return t;
+        }
+    }
+
+    // victims are visited from a random start so thieves spread out
+    thread_local std::minstd_rand random{std::random_device{}()};
+    auto count = workers();
+    auto start = random() % count;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto victim = (start + i) % count;
+        if (owned and victim == worker)
+        {
+            continue;
+        }
+        if (auto* t = deques_[victim]->steal())
+        {
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+void scheduler::work_(uint32_t worker)
+{
+    current_scheduler = this;
+    current_worker    = worker;
+    while (not stopping_)
+    {
+        // read before looking for work, so a task submitted in between
+        // changes the epoch and the wait below returns at once
+        auto epoch = epoch_.load(std::memory_order_acquire);
+        if (auto* t = find_task_(worker))
+        {
+            run_(t);
+            continue;
+        }
+        epoch_.wait(epoch, std::memory_order_acquire);
+    }
+}
+
+void scheduler::wait(const std::atomic<uint32_t>& pending)
+{
+    while (pending.load(std::memory_order_acquire) != 0)
+    {
+        if (auto* t = find_task_(current_worker))
+        {
+            run_(t);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+scheduler& shared()
+{
+    static scheduler instance;
+    return instance;
+}
+
+task_group::task_group(scheduler& scheduler) : scheduler_{scheduler}
+{
+}
+
+task_group::~task_group()
+{
+    scheduler_.wait(pending_);
+}
+
+void task_group::run(job work)
+{
+    scheduler_.submit(
+        [this, work = std::move(work)] {
+            try
+            {
+                work();
+            }
+            catch (...)
+            {
+                std::scoped_lock lock{error_mutex_};
+                if (not error_)
+                {
+                    error_ = std::current_exception();
+                }
+            }
+        },
+        pending_);
+}
+
+void task_group::wait()
+{
+    scheduler_.wait(pending_);
+    if (error_)
+    {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+namespace
+{
+void split(task_group& group,
+           uint32_t first,
+           uint32_t last,
+           uint32_t grain,
+           const std::function<void(uint32_t, uint32_t)>& function)
+{
+    while (last - first > grain)
+    {
+        auto middle = first + (last - first) / 2;
+        group.run([&group, middle, last, grain, &function] {
+            split(group, middle, last, grain, function);
+        });
+        last = middle;
+    }
+    function(first, last);
+}
+} // namespace
+
+void parallel_for(
+    scheduler& scheduler,
+    uint32_t count,
+    uint32_t grain,
+    const std::function<void(uint32_t first, uint32_t last)>& function)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    task_group group{scheduler};
+    try
+    {
+        split(group, 0, count, std::max(grain, 1u), function);
+    }
+    catch (...)
+    {
+        // the forked halves still reference the function
+        group.wait();
+        throw;
+    }
+    group.wait();
+}
+
+void parallel_for(
+    uint32_t count,
+    uint32_t grain,
+    const std::function<void(uint32_t first, uint32_t last)>& function)
+{
+    parallel_for(shared(), count, grain, function);
+}
+
+void parallel_ranges(
+    uint32_t count,
+    uint32_t workers,
+    const std::function<void(uint32_t first, uint32_t last)>& function)
+{
+    workers = std::clamp(workers, 1u, std::max(count, 1u));
+    parallel_for(count, (count + workers - 1) / workers, function);
+}
+
+graph::node_id graph::add(job work, std::initializer_list<node_id> after)
+{
+    auto id = to<node_id>(nodes_.size());
+    for (auto dependency : after)
+    {
+        if (dependency >= id)
+        {
+            throw std::runtime_error{"graph dependency on an unknown node!"};
+        }
+        nodes_[dependency].successors.push_back(id);
+    }
+    auto& added        = nodes_.emplace_back();
+    added.work         = std::move(work);
+    added.dependencies = to<uint32_t>(after.size());
+    return id;
+}
+
+void graph::start_(task_group& group, uint32_t index)
+{
+    group.run([this, &group, index] {
+        auto& current = nodes_[index];
+        current.work();
+        for (auto successor : current.successors)
+        {
+            // the last dependency to finish starts the successor
+            if (nodes_[successor].remaining.fetch_sub(
+                    1, std::memory_order_acq_rel) == 1)
+            {
+                start_(group, successor);
+            }
+        }
+    });
+}
+
+void graph::run(scheduler& scheduler)
+{
+    for (auto& n : nodes_)
+    {
+        n.remaining.store(n.dependencies, std::memory_order_relaxed);
+    }
+    task_group group{scheduler};
+    for (uint32_t i = 0; i < nodes_.size(); ++i)
+    {
+        if (nodes_[i].dependencies == 0)
+        {
+            start_(group, i);
+        }
+    }
+    group.wait();
+}
+
+size_t graph::size() const
+{
+    return nodes_.size();
+}
+} // namespace wf::jobs
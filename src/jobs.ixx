@@ -0,0 +1,141 @@
+module;
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+export module jobs;
+
+import utils;
+
+namespace wf::jobs
+{
+export using job = std::function<void()>;
+
+struct task
+{
+    job work;
+    std::atomic<uint32_t>* pending;
+};
+
+// chase-lev deque, the owning worker pushes and pops at the bottom while
+// thieves take from the top, only the last task is ever contended
+class work_deque : non_copyable
+{
+  private:
+    static constexpr int64_t capacity = int64_t{1} << 12;
+
+    std::atomic<int64_t> top_{0};
+    std::atomic<int64_t> bottom_{0};
+    std::array<std::atomic<task*>, capacity> tasks_{};
+
+  public:
+    // false when full, the caller then runs the task itself
+    bool push(task* t);
+    task* pop();
+    task* steal();
+};
+
+// one deque per worker thread, threads outside the pool hand their tasks in
+// through a shared queue, and every thread waiting on a join keeps running
+// queued tasks instead of blocking
+export class scheduler : non_copyable
+{
+  private:
+    std::vector<std::unique_ptr<work_deque>> deques_;
+    std::mutex injected_mutex_;
+    std::deque<task*> injected_;
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<bool> stopping_{false};
+    std::vector<std::jthread> threads_;
+
+    void work_(uint32_t worker);
+    task* find_task_(uint32_t worker);
+    void run_(task* t);
+
+  public:
+    // worker threads next to the callers, which help while they wait
+    explicit scheduler(uint32_t threads = std::max(
+                           2u, std::thread::hardware_concurrency()) - 1);
+    ~scheduler();
+
+    uint32_t workers() const;
+    void submit(job work, std::atomic<uint32_t>& pending);
+    // runs other tasks until pending drops to zero
+    void wait(const std::atomic<uint32_t>& pending);
+};
+
+// the process wide pool shared by every subsystem
+export scheduler& shared();
+
+// fork with run, join with wait, the first exception a task threw is
+// rethrown by wait once all of them finished
+export class task_group : non_copyable
+{
+  private:
+    scheduler& scheduler_;
+    std::atomic<uint32_t> pending_{0};
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+
+  public:
+    explicit task_group(scheduler& scheduler = shared());
+    ~task_group();
+
+    void run(job work);
+    void wait();
+};
+
+// splits [0, count) in halves until a range holds at most grain indices,
+// the calling thread keeps the left halves and thieves take the right ones
+export void parallel_for(
+    scheduler& scheduler,
+    uint32_t count,
+    uint32_t grain,
+    const std::function<void(uint32_t first, uint32_t last)>& function);
+
+export void parallel_for(
+    uint32_t count,
+    uint32_t grain,
+    const std::function<void(uint32_t first, uint32_t last)>& function);
+
+// [0, count) as about workers contiguous ranges
+export void parallel_ranges(
+    uint32_t count,
+    uint32_t workers,
+    const std::function<void(uint32_t first, uint32_t last)>& function);
+
+// jobs and their dependencies, built once and run every frame, a node
+// starts as soon as every node it was added after has finished
+export class graph : non_copyable
+{
+  private:
+    struct node
+    {
+        job work;
+        std::vector<uint32_t> successors;
+        uint32_t dependencies = 0;
+        std::atomic<uint32_t> remaining{0};
+    };
+    // a deque keeps the atomics in place as nodes are added
+    std::deque<node> nodes_;
+
+    void start_(task_group& group, uint32_t index);
+
+  public:
+    using node_id = uint32_t;
+
+    // dependencies must already be in the graph, so it can never cycle
+    node_id add(job work, std::initializer_list<node_id> after = {});
+    void run(scheduler& scheduler = shared());
+    size_t size() const;
+};
+} // namespace wf::jobs
@@ -0,0 +1,165 @@
+module;
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+module lod;
+
+namespace wf::lod
+{
+frustum::frustum(const glm::mat4& view_proj)
+{
+    auto row = [&](int i) {
+        return glm::vec4{
+            view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]};
+    };
+    // near uses w + z, which also holds for a zero to one depth range
+    planes_ = {row(3) + row(0),
+               row(3) - row(0),
+               row(3) + row(1),
+               row(3) - row(1),
+               row(3) + row(2),
+               row(3) - row(2)};
+}
+
+bool frustum::intersects(const aabb& box) const
+{
+    for (const auto& plane : planes_)
+    {
+        glm::vec3 positive{plane.x > 0.f ? box.max.x : box.min.x,
+                           plane.y > 0.f ? box.max.y : box.min.y,
+                           plane.z > 0.f ? box.max.z : box.min.z};
+        if (glm::dot(glm::vec3{plane}, positive) + plane.w < 0.f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool intersects_sphere(const aabb& box, glm::vec3 center, float radius)
+{
+    auto closest = glm::clamp(center, box.min, box.max);
+    auto offset  = closest - center;
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+quadtree::quadtree(const settings& lod_settings) : settings_{lod_settings}
+{
+    if (settings_.levels == 0 or settings_.patch_quads == 0 or
+        not std::has_single_bit(settings_.patch_quads))
+    {
+        throw std::runtime_error{
+            "lod needs at least one level and a power of two patch!"};
+    }
+
+    ranges_.resize(settings_.levels);
+    morph_ranges_.resize(settings_.levels);
+    float previous = 0.f;
+    for (uint32_t level = 0; level < settings_.levels; ++level)
+    {
+        ranges_[level]       = node_size_(level) * settings_.range_factor;
+        morph_ranges_[level] = {
+            previous + (ranges_[level] - previous) * settings_.morph_start,
+            ranges_[level]};
+        previous = ranges_[level];
+    }
+    selection_.reserve(settings_.max_patches);
+}
+
+float quadtree::node_size_(uint32_t level) const
+{
+    return std::ldexp(settings_.leaf_size, static_cast<int>(level));
+}
+
+aabb quadtree::node_bounds_(glm::vec2 corner, uint32_t level) const
+{
+    auto size = node_size_(level);
+    return {{corner, -settings_.max_height},
+            {corner + size, settings_.max_height}};
+}
+
+void quadtree::add_(glm::vec2 corner, uint32_t level)
+{
+    if (selection_.size() == settings_.max_patches)
+    {
+        return;
+    }
+    selection_.push_back({
+        .offset_size = {corner, node_size_(level), static_cast<float>(level)},
+        .morph = {morph_ranges_[level], 0.f, 0.f},
+    });
+}
+
+bool quadtree::select_(glm::vec2 corner,
+                       uint32_t level,
+                       const frustum& view,
+                       glm::vec3 camera)
+{
+    auto bounds = node_bounds_(corner, level);
+    if (not intersects_sphere(bounds, camera, ranges_[level]))
+    {
+        return false;
+    }
+    if (not view.intersects(bounds))
+    {
+        // handled, nothing of it is visible
+        return true;
+    }
+    if (level == 0 or
+        not intersects_sphere(bounds, camera, ranges_[level - 1]))
+    {
+        add_(corner, level);
+        return true;
+    }
+
+    // children out of their own range are drawn at their size anyway, they
+    // are fully morphed there and match this level's density
+    auto half = 0.5f * node_size_(level);
+    for (auto offset : {glm::vec2{0.f, 0.f},
+                        glm::vec2{half, 0.f},
+                        glm::vec2{0.f, half},
+                        glm::vec2{half, half}})
+    {
+        auto child = corner + offset;
+        if (not select_(child, level - 1, view, camera) and
+            view.intersects(node_bounds_(child, level - 1)))
+        {
+            add_(child, level - 1);
+        }
+    }
+    return true;
+}
+
+std::span<const patch_instance> quadtree::select(const glm::mat4& view_proj,
+                                                 glm::vec3 camera)
+{
+    selection_.clear();
+    auto root_level = settings_.levels - 1;
+    auto root_size  = node_size_(root_level);
+    select_(
+        glm::vec2{-0.5f * root_size}, root_level, frustum{view_proj}, camera);
+    return selection_;
+}
+
+std::span<const patch_instance> quadtree::selection() const
+{
+    return selection_;
+}
+
+const settings& quadtree::parameters() const
+{
+    return settings_;
+}
+
+uint32_t quadtree::triangles_per_patch() const
+{
+    return 2 * settings_.patch_quads * settings_.patch_quads;
+}
+} // namespace wf::lod
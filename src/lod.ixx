@@ -0,0 +1,77 @@
+module;
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+export module lod;
+
+import utils;
+
+namespace wf::lod
+{
+export struct settings
+{
+    // edge of the finest node, the root spans leaf_size * 2^(levels - 1)
+    float leaf_size      = 32.f;
+    uint32_t levels      = 10;
+    uint32_t patch_quads = 64;
+    float range_factor   = 3.f;
+    float morph_start    = 0.7f;
+    float max_height     = 25.f;
+    uint32_t max_patches = 4096;
+};
+
+// one drawn patch, consumed by the vertex stage as instance attributes
+export struct patch_instance
+{
+    glm::vec4 offset_size; // lower corner, edge length, level
+    glm::vec4 morph;       // distances where morphing starts and ends
+};
+
+struct aabb
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+class frustum
+{
+  private:
+    std::array<glm::vec4, 6> planes_;
+
+  public:
+    explicit frustum(const glm::mat4& view_proj);
+    bool intersects(const aabb& box) const;
+};
+
+// continuous distance based lod, nodes are selected every frame against the
+// camera and drawn as instances of one shared grid patch which morphs into
+// the next coarser level before reaching its range
+export class quadtree : non_copyable
+{
+  private:
+    settings settings_;
+    std::vector<float> ranges_;
+    std::vector<glm::vec2> morph_ranges_;
+    std::vector<patch_instance> selection_;
+
+    float node_size_(uint32_t level) const;
+    aabb node_bounds_(glm::vec2 corner, uint32_t level) const;
+    bool select_(glm::vec2 corner,
+                 uint32_t level,
+                 const frustum& view,
+                 glm::vec3 camera);
+    void add_(glm::vec2 corner, uint32_t level);
+
+  public:
+    explicit quadtree(const settings& lod_settings);
+
+    std::span<const patch_instance> select(const glm::mat4& view_proj,
+                                           glm::vec3 camera);
+    std::span<const patch_instance> selection() const;
+    const settings& parameters() const;
+    uint32_t triangles_per_patch() const;
+};
+} // namespace wf::lod
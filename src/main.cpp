@@ -1,48 +1,675 @@
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <rapidjson/document.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
 #include <exception>
+#include <filesystem>
+#include <format>
+#include <optional>
 #include <print>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <string>
+#include <system_error>
+#include <variant>
+#include <vector>
 
+import bench;
+import gerstner;
+import ocean;
+import profiler;
+import scene;
+import simulation;
+import utils;
 import vk;
 import window;
 
 namespace wf
 {
+enum class wave_model
+{
+    fft,
+    gerstner
+};
+
+struct options
+{
+    bool headless       = false;
+    uint32_t frames     = 1000;
+    VkExtent2D extent   = {1600, 900};
+    wave_model waves    = wave_model::fft;
+    uint32_t wave_count = 32;
+    bool gpu_surface    = false;
+    bool validate       = false;
+    std::string benchmark;
+    std::string scene = "../waves_scene.json";
+    uint32_t scatter  = 0;
+    std::string trace;
+    uint32_t tick_rate = 60;
+    // statistics drawn over the frame, no font leaves them off
+    std::string hud_font;
+    uint32_t hud_size = 16;
+    vk::frame_settings pacing;
+    ocean::parameters ocean;
+};
+
+constexpr std::string_view config_path = "../config.json";
+
+uint32_t parse_number(std::string_view value)
+{
+    uint32_t number{};
+    auto [end, error] =
+        std::from_chars(value.data(), value.data() + value.size(), number);
+    if (error != std::errc{} or end != value.data() + value.size())
+    {
+        throw std::runtime_error{std::format("invalid number: {}", value)};
+    }
+    return number;
+}
+
+vk::present_mode parse_present_mode(std::string_view value)
+{
+    using namespace std::string_view_literals;
+    if (value == "fifo"sv)
+    {
+        return vk::present_mode::fifo;
+    }
+    if (value == "mailbox"sv)
+    {
+        return vk::present_mode::mailbox;
+    }
+    if (value == "immediate"sv)
+    {
+        return vk::present_mode::immediate;
+    }
+    throw std::runtime_error{std::format("unknown present mode: {}", value)};
+}
+
+// defaults overridden by the renderer section of config.json, the command
+// line in turn overrides these
+options read_config(const std::filesystem::path& path)
+{
+    options opts{};
+    if (not std::filesystem::exists(path))
+    {
+        return opts;
+    }
+    auto text = load_text_from_file(path);
+    rapidjson::Document document;
+    document.Parse(text.data(), text.size());
+    if (document.HasParseError() or not document.IsObject())
+    {
+        throw std::runtime_error{
+            std::format("failed to parse config {}", path.string())};
+    }
+    auto renderer = document.FindMember("renderer");
+    if (renderer == document.MemberEnd() or not renderer->value.IsObject())
+    {
+        return opts;
+    }
+
+    const auto& section = renderer->value;
+    auto read_number    = [&section](const char* name, uint32_t& value) {
+        auto member = section.FindMember(name);
+        if (member != section.MemberEnd() and member->value.IsUint())
+        {
+            value = member->value.GetUint();
+        }
+    };
+    read_number("width", opts.extent.width);
+    read_number("height", opts.extent.height);
+    read_number("frames_in_flight", opts.pacing.frames_in_flight);
+    read_number("swap_chain_images", opts.pacing.swap_chain_images);
+    read_number("hud_size", opts.hud_size);
+    auto hud_font = section.FindMember("hud_font");
+    if (hud_font != section.MemberEnd() and hud_font->value.IsString())
+    {
+        opts.hud_font = hud_font->value.GetString();
+    }
+    auto present = section.FindMember("present_mode");
+    if (present != section.MemberEnd() and present->value.IsString())
+    {
+        opts.pacing.present = parse_present_mode(present->value.GetString());
+    }
+    return opts;
+}
+
+options parse_options(std::span<char*> args, options opts)
+{
+    using namespace std::string_view_literals;
+    for (auto it = std::begin(args); it != std::end(args); ++it)
+    {
+        std::string_view arg{*it};
+        if (arg == "--headless"sv)
+        {
+            opts.headless = true;
+        }
+        else if (arg == "--frames"sv and std::next(it) != std::end(args))
+        {
+            opts.frames = parse_number(*++it);
+        }
+        else if (arg == "--ocean-resolution"sv and
+                 std::next(it) != std::end(args))
+        {
+            opts.ocean.resolution = parse_number(*++it);
+        }
+        else if (arg == "--spectrum"sv and std::next(it) != std::end(args))
+        {
+            std::string_view value{*++it};
+            if (value == "phillips"sv)
+            {
+                opts.ocean.spectrum = ocean::spectrum_type::phillips;
+            }
+            else if (value == "jonswap"sv)
+            {
+                opts.ocean.spectrum = ocean::spectrum_type::jonswap;
+            }
+            else
+            {
+                throw std::runtime_error{
+                    std::format("unknown spectrum: {}", value)};
+            }
+        }
+        else if (arg == "--waves"sv and std::next(it) != std::end(args))
+        {
+            std::string_view value{*++it};
+            if (value == "fft"sv)
+            {
+                opts.waves = wave_model::fft;
+            }
+            else if (value == "gerstner"sv)
+            {
+                opts.waves = wave_model::gerstner;
+            }
+            else
+            {
+                throw std::runtime_error{
+                    std::format("unknown wave model: {}", value)};
+            }
+        }
+        else if (arg == "--wave-count"sv and std::next(it) != std::end(args))
+        {
+            opts.wave_count = parse_number(*++it);
+        }
+        else if (arg == "--gpu-surface"sv)
+        {
+            opts.gpu_surface = true;
+        }
+        else if (arg == "--validate"sv)
+        {
+            opts.validate = true;
+        }
+        else if (arg == "--scene"sv and std::next(it) != std::end(args))
+        {
+            opts.scene = *++it;
+        }
+        else if (arg == "--no-scene"sv)
+        {
+            opts.scene.clear();
+        }
+        else if (arg == "--no-hud"sv)
+        {
+            opts.hud_font.clear();
+        }
+        else if (arg == "--scatter"sv and std::next(it) != std::end(args))
+        {
+            opts.scatter = parse_number(*++it);
+        }
+        else if (arg == "--frames-in-flight"sv and
+                 std::next(it) != std::end(args))
+        {
+            opts.pacing.frames_in_flight = parse_number(*++it);
+        }
+        else if (arg == "--present"sv and std::next(it) != std::end(args))
+        {
+            opts.pacing.present = parse_present_mode(*++it);
+        }
+        else if (arg == "--swap-chain-images"sv and
+                 std::next(it) != std::end(args))
+        {
+            opts.pacing.swap_chain_images = parse_number(*++it);
+        }
+        else if (arg == "--tick-rate"sv and std::next(it) != std::end(args))
+        {
+            opts.tick_rate = std::max(parse_number(*++it), 1u);
+        }
+        else if (arg == "--trace"sv and std::next(it) != std::end(args))
+        {
+            opts.trace = *++it;
+        }
+        else if (arg == "--bench"sv and std::next(it) != std::end(args))
+        {
+            opts.benchmark = *++it;
+        }
+        else
+        {
+            throw std::runtime_error{std::format("unknown option: {}", arg)};
+        }
+    }
+    return opts;
+}
+
+using surface_model = std::variant<ocean::simulation, gerstner::wave_field>;
+
 class app
 {
   private:
-    window window_;
-    vk::instance vk_instance_{window_};
+    options options_;
+    surface_model surface_;
+    std::optional<window> window_;
+    profiler::profiler profiler_;
+    vk::instance vk_instance_;
+    // ticks the cpu surface on its own thread, declared after everything
+    // its steps touch so it stops first
+    std::optional<simulation::runner> simulation_;
+    std::chrono::steady_clock::time_point start_time_ =
+        std::chrono::steady_clock::now();
+    uint64_t drawn_triangles_ = 0;
+    bool gpu_surface_         = false;
+    float last_time_          = 0.f;
+    std::filesystem::file_time_type config_time_;
+    std::chrono::steady_clock::time_point config_checked_;
+    // frames and solver work since the hud was last refreshed
+    bool hud_            = false;
+    uint32_t hud_frames_ = 0;
+    simulation::statistics hud_stats_{};
+    std::chrono::steady_clock::time_point hud_updated_ =
+        std::chrono::steady_clock::now();
 
-  public:
-    app()
+    static surface_model create_surface_(const options& opts)
+    {
+        if (opts.waves == wave_model::gerstner)
+        {
+            auto waves = gerstner::make_waves(opts.wave_count,
+                                              opts.ocean.wind_direction,
+                                              opts.ocean.patch_size / 10.f,
+                                              0.8f,
+                                              opts.ocean.seed);
+            return surface_model{std::in_place_type<gerstner::wave_field>,
+                                 waves,
+                                 opts.ocean.resolution,
+                                 opts.ocean.patch_size};
+        }
+        return surface_model{std::in_place_type<ocean::simulation>,
+                             opts.ocean};
+    }
+
+    static std::optional<window> create_window_(const options& opts)
+    {
+        if (opts.headless)
+        {
+            return std::nullopt;
+        }
+        return std::make_optional<window>();
+    }
+
+    static vk::instance create_vk_instance_(std::optional<window>& window,
+                                            const options& opts)
+    {
+        vk::surface_layout layout{opts.ocean.resolution, opts.ocean.patch_size};
+        if (window)
+        {
+            return vk::instance{*window, layout, opts.pacing};
+        }
+        return vk::instance{opts.extent, layout, opts.pacing};
+    }
+
+    void load_scene_()
+    {
+        if (options_.scene.empty())
+        {
+            return;
+        }
+        if (not std::filesystem::exists(options_.scene))
+        {
+            wf::log(std::format("scene {} not found, drawing the ocean only",
+                                options_.scene));
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        scene::world world;
+        scene::load(options_.scene, world);
+        if (options_.scatter > 0)
+        {
+            scene::scatter(
+                world, options_.scatter, options_.ocean.patch_size * 4.f);
+        }
+        auto instances = world.instances();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        wf::log(std::format("scene: {} entities loaded in {:.1f} ms",
+                            world.entity_count(),
+                            1000. * elapsed.count()));
+        vk_instance_.load_scene(instances);
+    }
+
+    void enable_hud_()
+    {
+        if (options_.hud_font.empty())
+        {
+            return;
+        }
+        if (not std::filesystem::exists(options_.hud_font))
+        {
+            wf::log(std::format("font {} not found, drawing without the hud",
+                                options_.hud_font));
+            return;
+        }
+        vk_instance_.enable_overlay(options_.hud_font, options_.hud_size);
+        hud_ = true;
+    }
+
+    // averaged over a quarter second, so the text changes slowly enough to
+    // read and is only laid out again a few times a second
+    void update_hud_(std::chrono::steady_clock::time_point now)
+    {
+        ++hud_frames_;
+        std::chrono::duration<double> elapsed = now - hud_updated_;
+        if (not hud_ or elapsed < std::chrono::milliseconds{250})
+        {
+            return;
+        }
+        auto frame_ms = 1000. * elapsed.count() / hud_frames_;
+        auto solver   = std::string{"waves: evaluated on the gpu"};
+        if (simulation_)
+        {
+            auto stats = simulation_->stats();
+            auto ticks = stats.ticks - hud_stats_.ticks;
+            solver     = std::format(
+                "waves: {:.3f} ms per tick, {} late",
+                1000. * (stats.step_time - hud_stats_.step_time).count() /
+                    std::max<uint64_t>(ticks, 1),
+                stats.late_ticks - hud_stats_.late_ticks);
+            hud_stats_ = stats;
+        }
+        vk_instance_.overlay_text(
+            std::format("frame: {:.2f} ms ({:.0f} fps)\n{}\n"
+                        "scene: {} triangles in {} draws",
+                        frame_ms,
+                        1000. / frame_ms,
+                        solver,
+                        vk_instance_.drawn_triangles(),
+                        vk_instance_.drawn_batches()));
+        hud_frames_  = 0;
+        hud_updated_ = now;
+    }
+
+    bool enable_gpu_surface_()
+    {
+        if (not options_.gpu_surface)
+        {
+            return false;
+        }
+        auto* field =
+            std::get_if<gerstner::wave_field>(std::addressof(surface_));
+        if (field == nullptr)
+        {
+            wf::log("only gerstner waves run on the gpu, keeping the surface "
+                    "on the cpu");
+            return false;
+        }
+        return vk_instance_.enable_compute_surface(
+            to<uint32_t>(field->wave_count()));
+    }
+
+    // compares the last gpu evaluated frame against the cpu twin of the
+    // compute kernel. positions are expected to match when the driver fuses
+    // fma, which vulkan does not require, so differences are reported as a
+    // diagnostic rather than treated as an error
+    void validate_gpu_surface_()
+    {
+        auto& field   = std::get<gerstner::wave_field>(surface_);
+        auto vertices = vk_instance_.read_compute_surface();
+        std::vector<glm::vec3> positions(field.point_count());
+        std::vector<glm::vec3> normals(field.point_count());
+        field.evaluate_reference(last_time_, positions, normals);
+
+        size_t mismatched    = 0;
+        float position_error = 0.f;
+        float normal_error   = 0.f;
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            using bits = std::array<uint32_t, 3>;
+            if (std::bit_cast<bits>(vertices[i].pos) !=
+                std::bit_cast<bits>(positions[i]))
+            {
+                ++mismatched;
+            }
+            position_error = std::max(
+                position_error, glm::length(vertices[i].pos - positions[i]));
+            normal_error = std::max(
+                normal_error, glm::length(vertices[i].normal - normals[i]));
+        }
+        std::println("gpu surface: {} of {} positions differ from the cpu "
+                     "kernel, max position error {:.3g}, max normal error "
+                     "{:.3g}",
+                     mismatched,
+                     vertices.size(),
+                     position_error,
+                     normal_error);
+        if (mismatched > 0)
+        {
+            std::println("gpu surface: differences are expected when the "
+                         "driver does not fuse fma");
+        }
+    }
+
+    // one simulation tick, runs on the simulation thread
+    void step_(double time, simulation::snapshot& out)
+    {
+        profiler::scope zone{profiler_, "simulation"};
+        std::visit(
+            [time](auto& model) { model.update(static_cast<float>(time)); },
+            surface_);
+        std::visit(
+            overloaded{
+                [&out](const ocean::simulation& ocean) {
+                    auto positions = ocean.positions();
+                    auto normals   = ocean.normals();
+                    out.positions.assign(std::begin(positions),
+                                         std::end(positions));
+                    out.normals.assign(std::begin(normals), std::end(normals));
+                },
+                [&out](const gerstner::wave_field& field) {
+                    const auto& s = field.surface();
+                    out.positions.resize(field.point_count());
+                    out.normals.resize(field.point_count());
+                    for (size_t i = 0; i < field.point_count(); ++i)
+                    {
+                        out.positions[i] = {s.x[i], s.y[i], s.z[i]};
+                        out.normals[i]   = {s.nx[i], s.ny[i], s.nz[i]};
+                    }
+                },
+            },
+            surface_);
+    }
+
+    // polled about once a second, an edited frame policy is applied between
+    // two frames and rebuilds only what it touches
+    void watch_config_()
     {
-        while (!glfwWindowShouldClose(window_))
+        auto now = std::chrono::steady_clock::now();
+        if (now - config_checked_ < std::chrono::seconds{1})
+        {
+            return;
+        }
+        config_checked_ = now;
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(config_path, error);
+        if (error or time == config_time_)
+        {
+            return;
+        }
+        config_time_ = time;
+        try
+        {
+            vk_instance_.apply(read_config(config_path).pacing);
+        }
+        catch (const std::exception& e)
+        {
+            wf::log(std::format("config not applied: {}", e.what()));
+        }
+    }
+
+    void run_windowed_()
+    {
+        std::error_code error;
+        config_time_ = std::filesystem::last_write_time(config_path, error);
+        while (!glfwWindowShouldClose(*window_))
         {
             glfwPollEvents();
+            watch_config_();
             draw_frame();
         }
+    }
+
+    void run_headless_()
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < options_.frames; ++i)
+        {
+            draw_frame();
+            drawn_triangles_ += vk_instance_.drawn_triangles();
+        }
         vk_instance_.wait_device_idle();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        std::println("rendered {} offscreen frames in {:.3f} s ({:.1f} fps)",
+                     options_.frames,
+                     elapsed.count(),
+                     options_.frames / elapsed.count());
+        if (simulation_)
+        {
+            auto stats = simulation_->stats();
+            std::println("ocean {}x{} update: {:.3f} ms per tick, {} ticks at "
+                         "{} Hz, {} late",
+                         options_.ocean.resolution,
+                         options_.ocean.resolution,
+                         1000. * stats.step_time.count() /
+                             std::max<uint64_t>(stats.ticks, 1),
+                         stats.ticks,
+                         options_.tick_rate,
+                         stats.late_ticks);
+        }
+        std::println("ocean lod: {} triangles per frame",
+                     drawn_triangles_ / std::max(options_.frames, 1u));
+        // fetches are those of the last frame, before any vertex reuse
+        for (const auto& stream : vk_instance_.vertex_streams())
+        {
+            std::println("{}: {} B each ({} as floats), {:.1f} KiB resident "
+                         "({:.1f}), {:.1f} KiB fetched per frame ({:.1f})",
+                         stream.name,
+                         stream.stride,
+                         stream.decoded_stride,
+                         stream.resident_bytes / 1024.,
+                         stream.decoded_resident_bytes / 1024.,
+                         stream.fetched_bytes / 1024.,
+                         stream.decoded_fetched_bytes / 1024.);
+        }
+        auto pipelines = vk_instance_.pipeline_startup();
+        std::println("pipelines created in {:.2f} ms from a {} cache",
+                     1000. * pipelines.creation.count(),
+                     pipelines.warm_cache ? "warm" : "cold");
+    }
+
+  public:
+    app(const options& opts)
+        : options_{opts}, surface_{create_surface_(opts)},
+          window_{create_window_(opts)},
+          vk_instance_{create_vk_instance_(window_, opts)}
+    {
+        load_scene_();
+        gpu_surface_ = enable_gpu_surface_();
+        enable_hud_();
+        vk_instance_.attach_profiler(profiler_);
+        if (not gpu_surface_)
+        {
+            simulation_.emplace(
+                std::chrono::duration<double>{1. / options_.tick_rate},
+                [this](double time, simulation::snapshot& out) {
+                    step_(time, out);
+                });
+        }
+        if (window_)
+        {
+            run_windowed_();
+        }
+        else
+        {
+            run_headless_();
+        }
+        vk_instance_.wait_device_idle();
+        if (gpu_surface_ and options_.validate)
+        {
+            validate_gpu_surface_();
+        }
+        profiler::print_summary(profiler_.summarize());
+        if (not options_.trace.empty())
+        {
+            profiler_.write_chrome_trace(options_.trace);
+            std::println("trace written to {}", options_.trace);
+        }
     }
 
     void draw_frame()
     {
-        vk_instance_.draw_frame();
+        profiler_.next_frame();
+        profiler::scope frame{profiler_, "frame"};
+        auto now   = std::chrono::steady_clock::now();
+        auto time  = std::chrono::duration<float>(now - start_time_).count();
+        last_time_ = time;
+        update_hud_(now);
+        if (gpu_surface_)
+        {
+            vk_instance_.draw_frame(std::get<gerstner::wave_field>(surface_),
+                                    time);
+            return;
+        }
+
+        // blended between the two newest ticks, the shaders renormalize
+        auto state = simulation_->acquire();
+        vk_instance_.draw_frame([&state](std::span<vk::vertex> vertices) {
+            const auto& [previous, current, alpha] = state;
+            for (size_t i = 0; i < vertices.size(); ++i)
+            {
+                vertices[i] = {glm::mix(previous.positions[i],
+                                        current.positions[i],
+                                        alpha),
+                               glm::mix(previous.normals[i],
+                                        current.normals[i],
+                                        alpha)};
+            }
+        });
     }
 };
 } // namespace wf
 
-int main()
+int main(int argc, char** argv)
 {
     try
     {
-        wf::app app;
+        auto defaults = wf::read_config(wf::config_path);
+        auto options  = wf::parse_options(
+            std::span{argv + 1, static_cast<size_t>(argc - 1)}, defaults);
+        if (not options.benchmark.empty())
+        {
+            wf::bench::run(options.benchmark);
+            return 0;
+        }
+        wf::app app{options};
     }
     catch (const std::exception& e)
     {
@@ -0,0 +1,412 @@
+module;
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+module meshopt;
+
+import utils;
+
+namespace wf::meshopt
+{
+namespace
+{
+constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+
+// a fifo of cache_size entries kept as insertion times, a vertex is cached
+// while fewer than cache_size others went in after it
+class fifo_cache
+{
+  private:
+    std::vector<uint32_t> inserted_;
+    uint32_t cache_size_;
+    uint32_t time_;
+
+  public:
+    fifo_cache(uint32_t vertex_count, uint32_t cache_size)
+        : inserted_(vertex_count, 0), cache_size_{cache_size},
+          time_{cache_size + 1}
+    {
+    }
+
+    uint32_t age(uint32_t vertex) const
+    {
+        return time_ - inserted_[vertex];
+    }
+
+    bool cached(uint32_t vertex) const
+    {
+        return age(vertex) <= cache_size_;
+    }
+
+    // returns whether the vertex had to be transformed
+    bool use(uint32_t vertex)
+    {
+        if (cached(vertex))
+        {
+            return false;
+        }
+        inserted_[vertex] = time_++;
+        return true;
+    }
+};
+
+// triangles around every vertex, compressed into one array
+struct adjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    adjacency(std::span<const uint32_t> indices, uint32_t vertex_count)
+        : offsets(size_t{vertex_count} + 1, 0), triangles(indices.size())
+    {
+        for (auto v : indices)
+        {
+            ++offsets[v + 1];
+        }
+        std::partial_sum(
+            std::begin(offsets), std::end(offsets), std::begin(offsets));
+        auto cursor = offsets;
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::span<const uint32_t> around(uint32_t vertex) const
+    {
+        return std::span{triangles}.subspan(
+            offsets[vertex], offsets[vertex + 1] - offsets[vertex]);
+    }
+};
+
+// sphere around the center of the bounds, cone around the average normal
+void bound_meshlet(meshlet& m,
+                   std::span<const uint32_t> indices,
+                   std::span<const glm::vec3> positions)
+{
+    auto corners = indices.subspan(size_t{m.first_triangle} * 3,
+                                   size_t{m.triangle_count} * 3);
+    auto min     = positions[corners.front()];
+    auto max     = min;
+    for (auto v : corners)
+    {
+        min = glm::min(min, positions[v]);
+        max = glm::max(max, positions[v]);
+    }
+    m.center = (min + max) * 0.5f;
+    m.radius = 0.f;
+    for (auto v : corners)
+    {
+        m.radius = std::max(m.radius, glm::length(positions[v] - m.center));
+    }
+
+    auto normal = [&](size_t corner) {
+        const auto& a = positions[corners[corner]];
+        auto face     = glm::cross(positions[corners[corner + 1]] - a,
+                               positions[corners[corner + 2]] - a);
+        auto length   = glm::length(face);
+        return length > 0.f ? face / length : glm::vec3{0.f};
+    };
+    glm::vec3 sum{0.f};
+    for (size_t i = 0; i < corners.size(); i += 3)
+    {
+        sum += normal(i);
+    }
+
+    // normals spread over more than a hemisphere, or nearly so, leave no
+    // direction every triangle faces away from
+    m.cone_axis   = glm::vec3{0.f};
+    m.cone_cutoff = 1.f;
+    auto length   = glm::length(sum);
+    if (length == 0.f)
+    {
+        return;
+    }
+    auto axis    = sum / length;
+    auto min_cos = 1.f;
+    for (size_t i = 0; i < corners.size(); i += 3)
+    {
+        // degenerate triangles cover no pixels, whichever way they face
+        auto n = normal(i);
+        if (n != glm::vec3{0.f})
+        {
+            min_cos = std::min(min_cos, glm::dot(axis, n));
+        }
+    }
+    if (min_cos <= 0.1f)
+    {
+        return;
+    }
+    m.cone_axis   = axis;
+    m.cone_cutoff = std::sqrt(1.f - min_cos * min_cos);
+}
+} // namespace
+
+cache_stats analyze_vertex_cache(std::span<const uint32_t> indices,
+                                 uint32_t vertex_count,
+                                 uint32_t cache_size)
+{
+    fifo_cache cache{vertex_count, cache_size};
+    std::vector<bool> referenced(vertex_count);
+    uint32_t transforms = 0;
+    uint32_t vertices   = 0;
+    for (auto v : indices)
+    {
+        transforms += cache.use(v) ? 1 : 0;
+        if (not referenced[v])
+        {
+            referenced[v] = true;
+            ++vertices;
+        }
+    }
+    auto triangles = static_cast<float>(indices.size() / 3);
+    return {.acmr = triangles > 0.f ? transforms / triangles : 0.f,
+            .atvr = vertices > 0 ? static_cast<float>(transforms) / vertices
+                                 : 0.f};
+}
+
+void optimize_vertex_cache(std::span<uint32_t> indices,
+                           uint32_t vertex_count,
+                           uint32_t cache_size)
+{
+    if (indices.empty())
+    {
+        return;
+    }
+    adjacency around{indices, vertex_count};
+    std::vector<uint32_t> live(vertex_count, 0);
+    for (auto v : indices)
+    {
+        ++live[v];
+    }
+
+    std::vector<bool> emitted(indices.size() / 3);
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::vector<uint32_t> dead_ends;
+    std::vector<uint32_t> candidates;
+    fifo_cache cache{vertex_count, cache_size};
+    uint32_t cursor = 0;
+
+    // vertices fanned around recently with triangles left, or failing that
+    // the next one in input order that has any
+    auto skip_dead_end = [&]() -> uint32_t {
+        while (not dead_ends.empty())
+        {
+            auto v = dead_ends.back();
+            dead_ends.pop_back();
+            if (live[v] > 0)
+            {
+                return v;
+            }
+        }
+        for (; cursor < vertex_count; ++cursor)
+        {
+            if (live[cursor] > 0)
+            {
+                return cursor;
+            }
+        }
+        return unused;
+    };
+
+    // prefers the oldest candidate that stays cached through its own fan
+    auto next_vertex = [&]() -> uint32_t {
+        auto best          = unused;
+        int64_t best_score = -1;
+        for (auto v : candidates)
+        {
+            if (live[v] == 0)
+            {
+                continue;
+            }
+            int64_t score = 0;
+            if (cache.age(v) + 2 * live[v] <= cache_size)
+            {
+                score = cache.age(v);
+            }
+            if (score > best_score)
+            {
+                best_score = score;
+                best       = v;
+            }
+        }
+        return best != unused ? best : skip_dead_end();
+    };
+
+    auto fan = skip_dead_end();
+    while (fan != unused)
+    {
+        candidates.clear();
+        for (auto t : around.around(fan))
+        {
+            if (emitted[t])
+            {
+                continue;
+            }
+            for (auto v : indices.subspan(size_t{t} * 3, 3))
+            {
+                result.push_back(v);
+                dead_ends.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                cache.use(v);
+            }
+            emitted[t] = true;
+        }
+        fan = next_vertex();
+    }
+    std::ranges::copy(result, std::begin(indices));
+}
+
+void optimize_overdraw(std::span<uint32_t> indices,
+                       std::span<const glm::vec3> positions,
+                       uint32_t cache_size)
+{
+    auto triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+    {
+        return;
+    }
+
+    // a triangle missing on all corners is where the cache order jumped, so
+    // moving whole clusters around costs little locality
+    fifo_cache cache{static_cast<uint32_t>(positions.size()), cache_size};
+    std::vector<size_t> starts;
+    for (size_t t = 0; t < triangle_count; ++t)
+    {
+        auto misses = 0;
+        for (auto v : indices.subspan(t * 3, 3))
+        {
+            misses += cache.use(v) ? 1 : 0;
+        }
+        if (t == 0 or misses == 3)
+        {
+            starts.push_back(t);
+        }
+    }
+    starts.push_back(triangle_count);
+
+    glm::vec3 center{0.f};
+    for (auto v : indices)
+    {
+        center += positions[v];
+    }
+    center /= static_cast<float>(indices.size());
+
+    // area weighted, so the summed cross products are the cluster's normal
+    std::vector<float> scores(starts.size() - 1);
+    for (size_t c = 0; c + 1 < starts.size(); ++c)
+    {
+        glm::vec3 centroid{0.f};
+        glm::vec3 normal{0.f};
+        float area = 0.f;
+        for (auto t = starts[c]; t < starts[c + 1]; ++t)
+        {
+            const auto& a = positions[indices[t * 3]];
+            const auto& b = positions[indices[t * 3 + 1]];
+            const auto& p = positions[indices[t * 3 + 2]];
+            auto face     = glm::cross(b - a, p - a);
+            auto weight   = glm::length(face);
+            centroid += (a + b + p) * (weight / 3.f);
+            normal += face;
+            area += weight;
+        }
+        auto length = glm::length(normal);
+        scores[c]   = area > 0.f and length > 0.f
+                          ? glm::dot(centroid / area - center, normal / length)
+                          : 0.f;
+    }
+
+    std::vector<size_t> order(scores.size());
+    std::iota(std::begin(order), std::end(order), size_t{0});
+    std::ranges::stable_sort(
+        order, [&](size_t a, size_t b) { return scores[a] > scores[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (auto c : order)
+    {
+        result.insert(std::end(result),
+                      std::begin(indices) + starts[c] * 3,
+                      std::begin(indices) + starts[c + 1] * 3);
+    }
+    std::ranges::copy(result, std::begin(indices));
+}
+
+uint32_t optimize_vertex_fetch(std::span<uint32_t> indices,
+                               std::span<uint32_t> remap)
+{
+    std::ranges::fill(remap, unused);
+    uint32_t next = 0;
+    for (auto& v : indices)
+    {
+        if (remap[v] == unused)
+        {
+            remap[v] = next++;
+        }
+        v = remap[v];
+    }
+    return next;
+}
+
+std::vector<meshlet> build_meshlets(std::span<const uint32_t> indices,
+                                    std::span<const glm::vec3> positions,
+                                    uint32_t max_vertices,
+                                    uint32_t max_triangles)
+{
+    std::vector<meshlet> result;
+    // the meshlet each vertex was last counted in, plus one
+    std::vector<uint32_t> owner(positions.size(), 0);
+    uint32_t id = 1;
+    auto added  = [&](std::span<const uint32_t> corners) {
+        uint32_t count = 0;
+        for (auto c = corners.begin(); c != corners.end(); ++c)
+        {
+            // a corner repeated within the triangle counts once
+            if (owner[*c] != id and std::find(corners.begin(), c, *c) == c)
+            {
+                ++count;
+            }
+        }
+        return count;
+    };
+
+    meshlet current{};
+    auto triangle_count = to<uint32_t>(indices.size() / 3);
+    for (uint32_t t = 0; t < triangle_count; ++t)
+    {
+        auto corners  = indices.subspan(size_t{t} * 3, 3);
+        auto vertices = added(corners);
+        if (current.triangle_count == max_triangles or
+            current.vertex_count + vertices > max_vertices)
+        {
+            result.push_back(current);
+            current  = {.first_triangle = t};
+            ++id;
+            vertices = added(corners);
+        }
+        for (auto v : corners)
+        {
+            owner[v] = id;
+        }
+        current.vertex_count += vertices;
+        ++current.triangle_count;
+    }
+    if (current.triangle_count != 0)
+    {
+        result.push_back(current);
+    }
+    for (auto& m : result)
+    {
+        bound_meshlet(m, indices, positions);
+    }
+    return result;
+}
+} // namespace wf::meshopt
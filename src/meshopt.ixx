@@ -0,0 +1,77 @@
+module;
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+export module meshopt;
+
+namespace wf::meshopt
+{
+// entries of the simulated post transform cache, a fifo as on most gpus
+export constexpr uint32_t default_cache_size = 16;
+
+// average cache miss ratio, transformed vertices per triangle, between 0.5
+// and 3, and average transform to vertex ratio, transformed vertices per
+// referenced vertex, 1 at best
+export struct cache_stats
+{
+    float acmr;
+    float atvr;
+};
+
+export cache_stats
+analyze_vertex_cache(std::span<const uint32_t> indices,
+                     uint32_t vertex_count,
+                     uint32_t cache_size = default_cache_size);
+
+// tipsify by sander, nehab and barczak: fans around the vertex most likely
+// to still be cached and only jumps elsewhere on a dead end, linear in the
+// index count
+export void optimize_vertex_cache(std::span<uint32_t> indices,
+                                  uint32_t vertex_count,
+                                  uint32_t cache_size = default_cache_size);
+
+// splits cache ordered triangles into clusters where the order jumped and
+// sorts those so outward facing ones away from the center come first, they
+// tend to occlude the rest whichever side the mesh is seen from
+export void optimize_overdraw(std::span<uint32_t> indices,
+                              std::span<const glm::vec3> positions,
+                              uint32_t cache_size = default_cache_size);
+
+// renumbers vertices in order of first use so fetches walk the vertex buffer
+// forwards, remap receives the new index of every old vertex and the unused
+// ones get max uint32, returns how many vertices remain
+export uint32_t optimize_vertex_fetch(std::span<uint32_t> indices,
+                                      std::span<uint32_t> remap);
+
+// limits of one meshlet, small enough for a mesh shader workgroup to hold
+// its vertices and triangles
+export constexpr uint32_t max_meshlet_vertices  = 64;
+export constexpr uint32_t max_meshlet_triangles = 124;
+
+// a run of consecutive triangles of the index buffer, so it draws as an
+// index range. the cone holds every triangle normal, the whole meshlet faces
+// away from a camera at c when
+// dot(center - c, cone_axis) >= cone_cutoff * length(center - c) + radius,
+// a cutoff of 1 never passes
+export struct meshlet
+{
+    glm::vec3 center;
+    float radius;
+    glm::vec3 cone_axis;
+    float cone_cutoff;
+    uint32_t first_triangle;
+    uint32_t triangle_count;
+    uint32_t vertex_count;
+};
+static_assert(sizeof(meshlet) == 44);
+
+// splits the triangles in index order whenever the next one would exceed a
+// limit, run after the other passes so meshlets follow their locality
+export std::vector<meshlet>
+build_meshlets(std::span<const uint32_t> indices,
+               std::span<const glm::vec3> positions,
+               uint32_t max_vertices  = max_meshlet_vertices,
+               uint32_t max_triangles = max_meshlet_triangles);
+} // namespace wf::meshopt
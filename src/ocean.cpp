@@ -0,0 +1,361 @@
+module;
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <numbers>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+module ocean;
+
+import jobs;
+
+namespace wf::ocean
+{
+constexpr float gravity = 9.81f;
+// rows or columns per task, enough fft work to outweigh a steal
+constexpr uint32_t rows_per_task = 8;
+
+void complex_field::resize(size_t size)
+{
+    re.assign(size, 0.f);
+    im.assign(size, 0.f);
+}
+
+fft_plan::fft_plan(uint32_t size) : size_{size}
+{
+    if (not std::has_single_bit(size) or size < 2)
+    {
+        throw std::invalid_argument{"ocean resolution must be a power of two"};
+    }
+
+    auto bits = std::countr_zero(size);
+    bit_reversal_.resize(size);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        uint32_t reversed = 0;
+        for (int bit = 0; bit < bits; ++bit)
+        {
+            reversed |= ((i >> bit) & 1u) << (bits - 1 - bit);
+        }
+        bit_reversal_[i] = reversed;
+    }
+
+    // stage with butterfly span m keeps its m twiddles at offset m - 1
+    twiddle_re_.resize(size - 1);
+    twiddle_im_.resize(size - 1);
+    for (uint32_t m = 1; m < size; m <<= 1)
+    {
+        for (uint32_t j = 0; j < m; ++j)
+        {
+            auto angle = std::numbers::pi * j / m;
+            twiddle_re_[m - 1 + j] = static_cast<float>(std::cos(angle));
+            twiddle_im_[m - 1 + j] = static_cast<float>(std::sin(angle));
+        }
+    }
+}
+
+void fft_plan::inverse_rows(complex_field& field,
+                            uint32_t first_row,
+                            uint32_t last_row) const
+{
+    for (uint32_t row = first_row; row < last_row; ++row)
+    {
+        float* re = field.re.data() + size_t{row} * size_;
+        float* im = field.im.data() + size_t{row} * size_;
+
+        for (uint32_t i = 0; i < size_; ++i)
+        {
+            auto j = bit_reversal_[i];
+            if (i < j)
+            {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+
+        for (uint32_t m = 1; m < size_; m <<= 1)
+        {
+            const float* w_re = twiddle_re_.data() + m - 1;
+            const float* w_im = twiddle_im_.data() + m - 1;
+            for (uint32_t base = 0; base < size_; base += 2 * m)
+            {
+                float* a_re = re + base;
+                float* a_im = im + base;
+                float* b_re = re + base + m;
+                float* b_im = im + base + m;
+                for (uint32_t j = 0; j < m; ++j)
+                {
+                    float t_re = b_re[j] * w_re[j] - b_im[j] * w_im[j];
+                    float t_im = b_re[j] * w_im[j] + b_im[j] * w_re[j];
+                    b_re[j]    = a_re[j] - t_re;
+                    b_im[j]    = a_im[j] - t_im;
+                    a_re[j] += t_re;
+                    a_im[j] += t_im;
+                }
+            }
+        }
+    }
+}
+
+void fft_plan::inverse_columns(complex_field& field,
+                               uint32_t first_column,
+                               uint32_t last_column) const
+{
+    // columns are transformed a whole row segment at a time, every butterfly
+    // shares one twiddle across the segment so the inner loop is contiguous
+    auto row_re = [&](uint32_t row) {
+        return field.re.data() + size_t{row} * size_ + first_column;
+    };
+    auto row_im = [&](uint32_t row) {
+        return field.im.data() + size_t{row} * size_ + first_column;
+    };
+    auto width = last_column - first_column;
+
+    for (uint32_t i = 0; i < size_; ++i)
+    {
+        auto j = bit_reversal_[i];
+        if (i < j)
+        {
+            std::swap_ranges(row_re(i), row_re(i) + width, row_re(j));
+            std::swap_ranges(row_im(i), row_im(i) + width, row_im(j));
+        }
+    }
+
+    for (uint32_t m = 1; m < size_; m <<= 1)
+    {
+        for (uint32_t base = 0; base < size_; base += 2 * m)
+        {
+            for (uint32_t j = 0; j < m; ++j)
+            {
+                float w_re  = twiddle_re_[m - 1 + j];
+                float w_im  = twiddle_im_[m - 1 + j];
+                float* a_re = row_re(base + j);
+                float* a_im = row_im(base + j);
+                float* b_re = row_re(base + j + m);
+                float* b_im = row_im(base + j + m);
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    float t_re = b_re[x] * w_re - b_im[x] * w_im;
+                    float t_im = b_re[x] * w_im + b_im[x] * w_re;
+                    b_re[x]    = a_re[x] - t_re;
+                    b_im[x]    = a_im[x] - t_im;
+                    a_re[x] += t_re;
+                    a_im[x] += t_im;
+                }
+            }
+        }
+    }
+}
+
+simulation::simulation(const parameters& params)
+    : params_{params}, plan_{params.resolution}
+{
+    auto cells = size_t{params_.resolution} * params_.resolution;
+    for (auto* field : {std::addressof(h0_),
+                        std::addressof(h0_minus_conj_),
+                        std::addressof(height_slope_x_),
+                        std::addressof(displacement_),
+                        std::addressof(slope_y_)})
+    {
+        field->resize(cells);
+    }
+    kx_.resize(cells);
+    ky_.resize(cells);
+    omega_.resize(cells);
+    positions_.resize(cells);
+    normals_.resize(cells);
+    initialize_spectrum_();
+}
+
+float simulation::spectrum_(glm::vec2 k) const
+{
+    auto k_length = glm::length(k);
+    if (k_length < 1e-6f)
+    {
+        return 0.f;
+    }
+    auto wind      = glm::normalize(params_.wind_direction);
+    auto alignment = glm::dot(k / k_length, wind);
+
+    if (params_.spectrum == spectrum_type::phillips)
+    {
+        auto largest_wave  = params_.wind_speed * params_.wind_speed / gravity;
+        auto smallest_wave = largest_wave / 1000.f;
+        auto k2            = k_length * k_length;
+        auto phillips      = params_.phillips_amplitude *
+                        std::exp(-1.f / (k2 * largest_wave * largest_wave)) /
+                        (k2 * k2) * alignment * alignment *
+                        std::exp(-k2 * smallest_wave * smallest_wave);
+        return alignment < 0.f ? phillips * 0.07f : phillips;
+    }
+
+    // jonswap frequency spectrum mapped to wavenumbers with deep water
+    // dispersion and cos^2 directional spreading
+    auto omega      = std::sqrt(gravity * k_length);
+    auto fetch_term = gravity * params_.fetch /
+                      (params_.wind_speed * params_.wind_speed);
+    auto alpha      = 0.076f * std::pow(fetch_term, -0.22f);
+    auto omega_peak = 22.f * std::pow(gravity * gravity /
+                                          (params_.wind_speed * params_.fetch),
+                                      1.f / 3.f);
+    auto sigma      = omega <= omega_peak ? 0.07f : 0.09f;
+    auto r          = std::exp(-(omega - omega_peak) * (omega - omega_peak) /
+                      (2.f * sigma * sigma * omega_peak * omega_peak));
+    auto s_omega    = alpha * gravity * gravity / std::pow(omega, 5.f) *
+                   std::exp(-1.25f * std::pow(omega_peak / omega, 4.f)) *
+                   std::pow(params_.peak_enhancement, r);
+    auto d_omega_dk = gravity / (2.f * omega);
+    auto spreading  = alignment > 0.f ? 2.f / std::numbers::pi_v<float> *
+                                           alignment * alignment
+                                      : 0.f;
+    auto delta_k    = 2.f * std::numbers::pi_v<float> / params_.patch_size;
+    return 2.f * s_omega * d_omega_dk / k_length * spreading * delta_k *
+           delta_k;
+}
+
+void simulation::initialize_spectrum_()
+{
+    std::mt19937 engine{params_.seed};
+    std::normal_distribution<float> gaussian{0.f, 1.f};
+
+    auto n          = params_.resolution;
+    auto wavenumber = [&](uint32_t i) {
+        auto index = static_cast<int>(i < n / 2 ? i : i - n);
+        return 2.f * std::numbers::pi_v<float> * index / params_.patch_size;
+    };
+
+    for (uint32_t y = 0; y < n; ++y)
+    {
+        for (uint32_t x = 0; x < n; ++x)
+        {
+            auto i = size_t{y} * n + x;
+            glm::vec2 k{wavenumber(x), wavenumber(y)};
+            kx_[i]    = k.x;
+            ky_[i]    = k.y;
+            omega_[i] = std::sqrt(gravity * glm::length(k));
+
+            auto amplitude = std::sqrt(spectrum_(k) * 0.5f);
+            h0_.re[i]      = gaussian(engine) * amplitude;
+            h0_.im[i]      = gaussian(engine) * amplitude;
+        }
+    }
+
+    for (uint32_t y = 0; y < n; ++y)
+    {
+        for (uint32_t x = 0; x < n; ++x)
+        {
+            auto i               = size_t{y} * n + x;
+            auto mirror          = size_t{(n - y) % n} * n + (n - x) % n;
+            h0_minus_conj_.re[i] = h0_.re[mirror];
+            h0_minus_conj_.im[i] = -h0_.im[mirror];
+        }
+    }
+}
+
+void simulation::evolve_rows_(float time, uint32_t first_row, uint32_t last_row)
+{
+    auto n     = params_.resolution;
+    auto first = size_t{first_row} * n;
+    auto last  = size_t{last_row} * n;
+    for (auto i = first; i < last; ++i)
+    {
+        auto phase = omega_[i] * time;
+        auto c     = std::cos(phase);
+        auto s     = std::sin(phase);
+
+        // h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t)
+        auto h_re = (h0_.re[i] + h0_minus_conj_.re[i]) * c -
+                    (h0_.im[i] - h0_minus_conj_.im[i]) * s;
+        auto h_im = (h0_.re[i] - h0_minus_conj_.re[i]) * s +
+                    (h0_.im[i] + h0_minus_conj_.im[i]) * c;
+
+        auto kx       = kx_[i];
+        auto ky       = ky_[i];
+        auto k_length = std::sqrt(kx * kx + ky * ky);
+        auto inv_k    = k_length > 0.f ? 1.f / k_length : 0.f;
+
+        // h + i * (i kx h)
+        height_slope_x_.re[i] = h_re * (1.f - kx);
+        height_slope_x_.im[i] = h_im * (1.f - kx);
+
+        // (-i kx/k h) + i * (-i ky/k h)
+        displacement_.re[i] = (ky * h_re + kx * h_im) * inv_k;
+        displacement_.im[i] = (ky * h_im - kx * h_re) * inv_k;
+
+        // i ky h
+        slope_y_.re[i] = -ky * h_im;
+        slope_y_.im[i] = ky * h_re;
+    }
+}
+
+void simulation::assemble_rows_(uint32_t first_row, uint32_t last_row)
+{
+    auto n         = params_.resolution;
+    auto cell_size = params_.patch_size / n;
+    auto origin    = -0.5f * params_.patch_size;
+    for (uint32_t y = first_row; y < last_row; ++y)
+    {
+        for (uint32_t x = 0; x < n; ++x)
+        {
+            auto i = size_t{y} * n + x;
+            positions_[i] = {
+                origin + x * cell_size -
+                    params_.choppiness * displacement_.re[i],
+                origin + y * cell_size -
+                    params_.choppiness * displacement_.im[i],
+                height_slope_x_.re[i],
+            };
+            normals_[i] = glm::normalize(
+                glm::vec3{-height_slope_x_.im[i], -slope_y_.re[i], 1.f});
+        }
+    }
+}
+
+void simulation::update(float time)
+{
+    auto n = params_.resolution;
+    jobs::parallel_for(n, rows_per_task, [&](uint32_t first, uint32_t last) {
+        evolve_rows_(time, first, last);
+        for (auto* field : {std::addressof(height_slope_x_),
+                            std::addressof(displacement_),
+                            std::addressof(slope_y_)})
+        {
+            plan_.inverse_rows(*field, first, last);
+        }
+    });
+    jobs::parallel_for(n, rows_per_task, [&](uint32_t first, uint32_t last) {
+        for (auto* field : {std::addressof(height_slope_x_),
+                            std::addressof(displacement_),
+                            std::addressof(slope_y_)})
+        {
+            plan_.inverse_columns(*field, first, last);
+        }
+    });
+    jobs::parallel_for(n, rows_per_task, [&](uint32_t first, uint32_t last) {
+        assemble_rows_(first, last);
+    });
+}
+
+uint32_t simulation::resolution() const
+{
+    return params_.resolution;
+}
+
+float simulation::patch_size() const
+{
+    return params_.patch_size;
+}
+
+std::span<const glm::vec3> simulation::positions() const
+{
+    return positions_;
+}
+
+std::span<const glm::vec3> simulation::normals() const
+{
+    return normals_;
+}
+} // namespace wf::ocean
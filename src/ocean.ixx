@@ -0,0 +1,96 @@
+module;
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+export module ocean;
+
+import utils;
+
+namespace wf::ocean
+{
+export enum class spectrum_type
+{
+    phillips,
+    jonswap
+};
+
+export struct parameters
+{
+    uint32_t resolution      = 256;
+    float patch_size         = 256.f;
+    glm::vec2 wind_direction = {1.f, 0.f};
+    float wind_speed         = 20.f;
+    float phillips_amplitude = 4e-4f;
+    float fetch              = 120'000.f;
+    float peak_enhancement   = 3.3f;
+    float choppiness         = 1.2f;
+    spectrum_type spectrum   = spectrum_type::phillips;
+    uint32_t seed            = 1337;
+};
+
+// complex field kept as separate real and imaginary planes so butterflies
+// run over contiguous floats
+struct complex_field
+{
+    std::vector<float> re;
+    std::vector<float> im;
+
+    void resize(size_t size);
+};
+
+// radix-2 inverse fft plan shared by rows and columns of an N x N grid
+class fft_plan
+{
+  private:
+    uint32_t size_;
+    std::vector<uint32_t> bit_reversal_;
+    std::vector<float> twiddle_re_;
+    std::vector<float> twiddle_im_;
+
+  public:
+    explicit fft_plan(uint32_t size);
+    void inverse_rows(complex_field& field,
+                      uint32_t first_row,
+                      uint32_t last_row) const;
+    void inverse_columns(complex_field& field,
+                         uint32_t first_column,
+                         uint32_t last_column) const;
+};
+
+export class simulation : non_copyable
+{
+  private:
+    parameters params_;
+    fft_plan plan_;
+
+    complex_field h0_;
+    complex_field h0_minus_conj_;
+    std::vector<float> kx_;
+    std::vector<float> ky_;
+    std::vector<float> omega_;
+
+    // height + i * slope_x, displacement_x + i * displacement_y, slope_y
+    complex_field height_slope_x_;
+    complex_field displacement_;
+    complex_field slope_y_;
+
+    std::vector<glm::vec3> positions_;
+    std::vector<glm::vec3> normals_;
+
+    void initialize_spectrum_();
+    float spectrum_(glm::vec2 k) const;
+    void evolve_rows_(float time, uint32_t first_row, uint32_t last_row);
+    void assemble_rows_(uint32_t first_row, uint32_t last_row);
+
+  public:
+    explicit simulation(const parameters& params);
+
+    void update(float time);
+    uint32_t resolution() const;
+    float patch_size() const;
+    std::span<const glm::vec3> positions() const;
+    std::span<const glm::vec3> normals() const;
+};
+} // namespace wf::ocean
@@ -0,0 +1,239 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <print>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+module profiler;
+
+namespace wf::profiler
+{
+namespace
+{
+uint32_t thread_index()
+{
+    static std::atomic<uint32_t> next{0};
+    thread_local uint32_t index = next++;
+    return index;
+}
+
+double percentile(std::span<const double> sorted, double fraction)
+{
+    // nearest rank
+    auto rank = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+} // namespace
+
+sample_ring::sample_ring(size_t capacity)
+    : slots_{std::make_unique<slot[]>(std::bit_ceil(capacity))},
+      mask_{std::bit_ceil(capacity) - 1}
+{
+}
+
+// the payload is stored in relaxed atomics, the sequence turns odd while a
+// slot is written and even once it holds the sample of that round
+void sample_ring::push(const sample& s)
+{
+    auto index  = head_.fetch_add(1, std::memory_order_relaxed);
+    auto& entry = slots_[index & mask_];
+    entry.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.words[0].store(std::bit_cast<uintptr_t>(s.name),
+                         std::memory_order_relaxed);
+    entry.words[1].store(s.begin, std::memory_order_relaxed);
+    entry.words[2].store(s.end, std::memory_order_relaxed);
+    entry.words[3].store((uint64_t{s.frame} << 32) | (s.thread << 1) |
+                             uint64_t{s.gpu},
+                         std::memory_order_relaxed);
+    entry.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+std::vector<sample> sample_ring::snapshot() const
+{
+    auto head  = head_.load(std::memory_order_acquire);
+    auto first = head > mask_ ? head - mask_ - 1 : 0;
+    std::vector<sample> result;
+    result.reserve(head - first);
+    for (auto index = first; index < head; ++index)
+    {
+        const auto& entry = slots_[index & mask_];
+        auto sequence     = entry.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2)
+        {
+            continue; // still being written or already overwritten
+        }
+        std::array<uint64_t, 4> words;
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            words[i] = entry.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != sequence)
+        {
+            continue;
+        }
+        result.push_back(
+            {.name   = std::bit_cast<const char*>(
+                 static_cast<uintptr_t>(words[0])),
+             .begin  = words[1],
+             .end    = words[2],
+             .frame  = static_cast<uint32_t>(words[3] >> 32),
+             .thread = static_cast<uint32_t>(words[3] & 0xffffffff) >> 1,
+             .gpu    = (words[3] & 1) != 0});
+    }
+    return result;
+}
+
+size_t sample_ring::capacity() const
+{
+    return mask_ + 1;
+}
+
+profiler::profiler(size_t capacity) : ring_{capacity}
+{
+}
+
+uint64_t profiler::now() const
+{
+    return to_ticks(std::chrono::steady_clock::now());
+}
+
+uint64_t profiler::to_ticks(std::chrono::steady_clock::time_point time) const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time -
+                                                                epoch_)
+        .count();
+}
+
+void profiler::record(const char* name,
+                      uint64_t begin,
+                      uint64_t end,
+                      bool gpu)
+{
+    ring_.push({.name   = name,
+                .begin  = begin,
+                .end    = end,
+                .frame  = frame_.load(std::memory_order_relaxed),
+                .thread = thread_index(),
+                .gpu    = gpu});
+}
+
+void profiler::record(const sample& s)
+{
+    ring_.push(s);
+}
+
+void profiler::next_frame()
+{
+    frame_.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t profiler::frame() const
+{
+    return frame_.load(std::memory_order_relaxed);
+}
+
+std::vector<sample> profiler::samples() const
+{
+    return ring_.snapshot();
+}
+
+std::vector<zone_summary> profiler::summarize() const
+{
+    std::map<std::pair<std::string, bool>, std::vector<double>> zones;
+    for (const auto& s : samples())
+    {
+        zones[{s.name, s.gpu}].push_back((s.end - s.begin) / 1e6);
+    }
+
+    std::vector<zone_summary> result;
+    for (auto& [key, durations] : zones)
+    {
+        std::ranges::sort(durations);
+        result.push_back({.name  = key.first,
+                          .gpu   = key.second,
+                          .count = durations.size(),
+                          .p50   = percentile(durations, 0.50),
+                          .p95   = percentile(durations, 0.95),
+                          .p99   = percentile(durations, 0.99)});
+    }
+    return result;
+}
+
+void profiler::write_chrome_trace(const std::filesystem::path& path) const
+{
+    // gpu zones go on their own track above every cpu thread
+    constexpr uint32_t gpu_track = 1000;
+
+    std::ofstream file{path, std::ios::trunc};
+    file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                        "\"tid\":{},\"args\":{{\"name\":\"gpu\"}}}}",
+                        gpu_track);
+    for (const auto& s : samples())
+    {
+        file << std::format(
+            ",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":1,"
+            "\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},"
+            "\"args\":{{\"frame\":{}}}}}",
+            s.name,
+            s.gpu ? "gpu" : "cpu",
+            s.gpu ? gpu_track : s.thread,
+            s.begin / 1e3,
+            (s.end - s.begin) / 1e3,
+            s.frame);
+    }
+    file << "\n]}\n";
+}
+
+scope::scope(optional_ref<profiler> profiler, const char* name)
+    : profiler_{profiler}, name_{name}
+{
+    if (profiler_)
+    {
+        begin_ = profiler_->get().now();
+    }
+}
+
+scope::~scope()
+{
+    if (profiler_)
+    {
+        auto& p = profiler_->get();
+        p.record(name_, begin_, p.now(), false);
+    }
+}
+
+void print_summary(const std::vector<zone_summary>& zones)
+{
+    std::println("{:<20} {:>4} {:>8} {:>9} {:>9} {:>9}",
+                 "zone",
+                 "",
+                 "samples",
+                 "p50 ms",
+                 "p95 ms",
+                 "p99 ms");
+    for (const auto& zone : zones)
+    {
+        std::println("{:<20} {:>4} {:>8} {:>9.3f} {:>9.3f} {:>9.3f}",
+                     zone.name,
+                     zone.gpu ? "gpu" : "cpu",
+                     zone.count,
+                     zone.p50,
+                     zone.p95,
+                     zone.p99);
+    }
+}
+} // namespace wf::profiler
@@ -0,0 +1,106 @@
+module;
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+export module profiler;
+
+import utils;
+
+namespace wf::profiler
+{
+// one timed zone, names are string literals so a sample never allocates
+export struct sample
+{
+    const char* name;
+    uint64_t begin; // nanoseconds since the profiler was created
+    uint64_t end;
+    uint32_t frame;
+    uint32_t thread;
+    bool gpu;
+};
+
+// fixed size ring shared by every thread, writers claim a slot with one
+// atomic increment and publish it through the slot's sequence number so a
+// reader copies finished samples without ever blocking a writer
+export class sample_ring : non_copyable
+{
+  private:
+    struct slot
+    {
+        std::atomic<uint64_t> sequence{0};
+        std::array<std::atomic<uint64_t>, 4> words{};
+    };
+
+    std::unique_ptr<slot[]> slots_;
+    uint64_t mask_;
+    std::atomic<uint64_t> head_{0};
+
+  public:
+    // rounded up to a power of two
+    explicit sample_ring(size_t capacity);
+
+    void push(const sample& s);
+    // the published samples still in the ring, oldest first
+    std::vector<sample> snapshot() const;
+    size_t capacity() const;
+};
+
+export struct zone_summary
+{
+    std::string name;
+    bool gpu;
+    size_t count;
+    double p50; // milliseconds
+    double p95;
+    double p99;
+};
+
+export class profiler : non_copyable
+{
+  private:
+    sample_ring ring_;
+    std::chrono::steady_clock::time_point epoch_ =
+        std::chrono::steady_clock::now();
+    std::atomic<uint32_t> frame_{0};
+
+  public:
+    explicit profiler(size_t capacity = size_t{1} << 16);
+
+    uint64_t now() const;
+    uint64_t to_ticks(std::chrono::steady_clock::time_point time) const;
+    void record(const char* name, uint64_t begin, uint64_t end, bool gpu);
+    // for samples timed elsewhere, gpu zones resolved frames later
+    void record(const sample& s);
+    void next_frame();
+    uint32_t frame() const;
+
+    std::vector<sample> samples() const;
+    // per zone percentiles over the samples still in the ring, which makes
+    // them a rolling window of the most recent frames
+    std::vector<zone_summary> summarize() const;
+    // json loadable by chrome://tracing and perfetto
+    void write_chrome_trace(const std::filesystem::path& path) const;
+};
+
+// times its own lifetime, does nothing without a profiler
+export class scope : non_copyable
+{
+  private:
+    optional_ref<profiler> profiler_;
+    const char* name_;
+    uint64_t begin_ = 0;
+
+  public:
+    scope(optional_ref<profiler> profiler, const char* name);
+    ~scope();
+};
+
+export void print_summary(const std::vector<zone_summary>& zones);
+} // namespace wf::profiler
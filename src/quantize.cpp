@@ -0,0 +1,163 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+
+module quantize;
+
+import assets;
+import jobs;
+import utils;
+
+namespace wf::quantize
+{
+constexpr uint32_t vertices_per_task = 4096;
+
+int16_t pack_snorm16(float value)
+{
+    return static_cast<int16_t>(
+        std::lround(std::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+float unpack_snorm16(int16_t value)
+{
+    return std::max(value / 32767.f, -1.f);
+}
+
+uint8_t pack_unorm8(float value)
+{
+    return static_cast<uint8_t>(
+        std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+}
+
+float unpack_unorm8(uint8_t value)
+{
+    return value / 255.f;
+}
+
+std::array<int16_t, 2> pack_octahedral(glm::vec3 normal)
+{
+    auto sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (sum == 0.f)
+    {
+        return {0, 0};
+    }
+    auto n = normal / sum;
+    // the lower half folds over the diagonals onto the outer triangles
+    if (n.z < 0.f)
+    {
+        auto sign = [](float v) { return v >= 0.f ? 1.f : -1.f; };
+        n         = {(1.f - std::abs(n.y)) * sign(n.x),
+                     (1.f - std::abs(n.x)) * sign(n.y),
+                     n.z};
+    }
+    return {pack_snorm16(n.x), pack_snorm16(n.y)};
+}
+
+glm::vec3 unpack_octahedral(std::array<int16_t, 2> packed)
+{
+    glm::vec3 n{unpack_snorm16(packed[0]), unpack_snorm16(packed[1]), 0.f};
+    n.z    = 1.f - std::abs(n.x) - std::abs(n.y);
+    auto t = std::max(-n.z, 0.f);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    return glm::normalize(n);
+}
+
+std::array<uint8_t, 2> pack_uv(glm::vec2 uv)
+{
+    return {pack_unorm8(uv.x), pack_unorm8(uv.y)};
+}
+
+glm::vec2 unpack_uv(std::array<uint8_t, 2> packed)
+{
+    return {unpack_unorm8(packed[0]), unpack_unorm8(packed[1])};
+}
+
+position_range fit_positions(std::span<const assets::vertex> vertices)
+{
+    if (vertices.empty())
+    {
+        return {glm::vec3{0.f}, 1.f};
+    }
+    auto min = vertices.front().position;
+    auto max = min;
+    for (const auto& v : vertices)
+    {
+        min = glm::min(min, v.position);
+        max = glm::max(max, v.position);
+    }
+    auto half   = (max - min) * 0.5f;
+    auto extent = std::max({half.x, half.y, half.z});
+    return {(min + max) * 0.5f, extent > 0.f ? extent : 1.f};
+}
+
+std::array<int16_t, 4> pack_position(glm::vec3 position,
+                                     const position_range& range)
+{
+    auto p = (position - range.origin) / range.extent;
+    return {pack_snorm16(p.x), pack_snorm16(p.y), pack_snorm16(p.z), 0};
+}
+
+glm::vec3 unpack_position(std::array<int16_t, 4> packed,
+                          const position_range& range)
+{
+    glm::vec3 p{unpack_snorm16(packed[0]),
+                unpack_snorm16(packed[1]),
+                unpack_snorm16(packed[2])};
+    return range.origin + p * range.extent;
+}
+
+glm::mat4 dequantize(const position_range& range)
+{
+    glm::mat4 m{range.extent};
+    m[3] = glm::vec4{range.origin, 1.f};
+    return m;
+}
+
+void pack_mesh(std::span<const assets::vertex> vertices,
+               const position_range& range,
+               std::span<mesh_vertex> out)
+{
+    jobs::parallel_for(to<uint32_t>(vertices.size()),
+                       vertices_per_task,
+                       [&](uint32_t first, uint32_t last) {
+                           for (auto i = first; i < last; ++i)
+                           {
+                               out[i] = {
+                                   pack_position(vertices[i].position, range),
+                                   pack_octahedral(vertices[i].normal)};
+                           }
+                       });
+}
+
+error measure(std::span<const assets::vertex> vertices,
+              std::span<const mesh_vertex> packed,
+              const position_range& range)
+{
+    error result{0.f, 0.f};
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        auto position = unpack_position(packed[i].position, range);
+        result.position =
+            std::max(result.position,
+                     glm::length(position - vertices[i].position));
+
+        // a zero normal has no direction to lose
+        auto length = glm::length(vertices[i].normal);
+        if (length == 0.f)
+        {
+            continue;
+        }
+        auto cosine = glm::dot(vertices[i].normal / length,
+                               unpack_octahedral(packed[i].normal));
+        result.normal_degrees =
+            std::max(result.normal_degrees,
+                     glm::degrees(std::acos(std::clamp(cosine, -1.f, 1.f))));
+    }
+    return result;
+}
+} // namespace wf::quantize
@@ -0,0 +1,75 @@
+module;
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+
+export module quantize;
+
+import assets;
+
+namespace wf::quantize
+{
+// [-1, 1] onto the symmetric 16 bit range, decoded the way VK_FORMAT_*_SNORM
+// attributes are so the cpu sees exactly what the vertex stage does
+export int16_t pack_snorm16(float value);
+export float unpack_snorm16(int16_t value);
+
+// [0, 1] in 1/255 steps, as VK_FORMAT_*_UNORM decodes it
+export uint8_t pack_unorm8(float value);
+export float unpack_unorm8(uint8_t value);
+
+// unit vector projected onto the octahedron and unfolded into a square, two
+// snorm values cover the sphere with a near uniform error
+export std::array<int16_t, 2> pack_octahedral(glm::vec3 normal);
+export glm::vec3 unpack_octahedral(std::array<int16_t, 2> packed);
+
+// texture coordinates in [0, 1], the RG8 encoding
+export std::array<uint8_t, 2> pack_uv(glm::vec2 uv);
+export glm::vec2 unpack_uv(std::array<uint8_t, 2> packed);
+
+// positions are stored relative to the origin and divided by the extent, so
+// each mesh spends its 16 bits on its own bounds. the extent is uniform so
+// the matrix undoing it leaves normals pointing the same way
+export struct position_range
+{
+    glm::vec3 origin;
+    float extent;
+};
+
+export position_range fit_positions(std::span<const assets::vertex> vertices);
+export std::array<int16_t, 4> pack_position(glm::vec3 position,
+                                            const position_range& range);
+export glm::vec3 unpack_position(std::array<int16_t, 4> packed,
+                                 const position_range& range);
+
+// takes the decoded snorm position back to the mesh's own space, the
+// renderer folds it into every instance transform
+export glm::mat4 dequantize(const position_range& range);
+
+// mesh vertex as uploaded, half of assets::vertex. positions keep a fourth
+// component because three wide 16 bit formats are optional for vertex input
+export struct mesh_vertex
+{
+    std::array<int16_t, 4> position;
+    std::array<int16_t, 2> normal;
+};
+static_assert(sizeof(mesh_vertex) == 12);
+
+// packs on the job scheduler, out holds one vertex per input vertex
+export void pack_mesh(std::span<const assets::vertex> vertices,
+                      const position_range& range,
+                      std::span<mesh_vertex> out);
+
+// largest round trip error over a packed mesh
+export struct error
+{
+    // in mesh units
+    float position;
+    float normal_degrees;
+};
+
+export error measure(std::span<const assets::vertex> vertices,
+                     std::span<const mesh_vertex> packed,
+                     const position_range& range);
+} // namespace wf::quantize
@@ -0,0 +1,377 @@
+module;
+#include <rapidjson/error/en.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <filesystem>
+#include <format>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <numbers>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+module scene;
+
+namespace wf::scene
+{
+size_t description::instance_count() const
+{
+    return transforms.size();
+}
+
+namespace
+{
+// sax handler following the fixed shape of scene files, entities are spawned
+// as soon as their object closes so no document is ever materialized
+class scene_reader
+    : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, scene_reader>
+{
+  private:
+    enum class context
+    {
+        root,
+        document,
+        entities,
+        entity,
+        components,
+        component,
+        vector,
+        ignored
+    };
+
+    world& scene_;
+    std::vector<context> stack_ = {context::root};
+    std::string key_;
+
+    // fields of the component being read, applied once its type is known
+    std::string type_;
+    std::string file_;
+    std::array<float, 3> vector_{};
+    uint32_t vector_size_ = 0;
+    std::optional<glm::vec3> position_;
+    std::optional<glm::vec3> rotation_;
+    std::optional<glm::vec3> scale_;
+
+    // the entity being read
+    transform transform_;
+    std::optional<uint32_t> mesh_;
+
+    context top_() const
+    {
+        return stack_.back();
+    }
+
+    bool push_(context inner)
+    {
+        stack_.push_back(top_() == context::ignored ? context::ignored
+                                                    : inner);
+        return true;
+    }
+
+    bool pop_()
+    {
+        stack_.pop_back();
+        return true;
+    }
+
+    void finish_component_()
+    {
+        if (type_ == "transform")
+        {
+            transform_.position = position_.value_or(glm::vec3{0.f});
+            transform_.rotation =
+                glm::radians(rotation_.value_or(glm::vec3{0.f}));
+            transform_.scale = scale_.value_or(glm::vec3{1.f});
+        }
+        else if (type_ == "mesh" and not file_.empty())
+        {
+            mesh_ = scene_.mesh_index(file_);
+        }
+        type_.clear();
+        file_.clear();
+        position_.reset();
+        rotation_.reset();
+        scale_.reset();
+    }
+
+    void finish_vector_()
+    {
+        if (vector_size_ != 3)
+        {
+            return;
+        }
+        glm::vec3 value{vector_[0], vector_[1], vector_[2]};
+        if (key_ == "position")
+        {
+            position_ = value;
+        }
+        else if (key_ == "rotation")
+        {
+            rotation_ = value;
+        }
+        else if (key_ == "scale")
+        {
+            scale_ = value;
+        }
+    }
+
+  public:
+    explicit scene_reader(world& scene) : scene_{scene}
+    {
+    }
+
+    bool Double(double value)
+    {
+        if (top_() == context::vector)
+        {
+            if (vector_size_ < vector_.size())
+            {
+                vector_[vector_size_] = static_cast<float>(value);
+            }
+            ++vector_size_;
+        }
+        return true;
+    }
+    bool Int(int value)
+    {
+        return Double(value);
+    }
+    bool Uint(unsigned value)
+    {
+        return Double(value);
+    }
+    bool Int64(int64_t value)
+    {
+        return Double(static_cast<double>(value));
+    }
+    bool Uint64(uint64_t value)
+    {
+        return Double(static_cast<double>(value));
+    }
+
+    bool String(const char* value, rapidjson::SizeType length, bool)
+    {
+        if (top_() == context::component)
+        {
+            if (key_ == "type")
+            {
+                type_.assign(value, length);
+            }
+            else if (key_ == "file")
+            {
+                file_.assign(value, length);
+            }
+        }
+        return true;
+    }
+
+    bool Key(const char* value, rapidjson::SizeType length, bool)
+    {
+        key_.assign(value, length);
+        return true;
+    }
+
+    bool StartObject()
+    {
+        switch (top_())
+        {
+        case context::root:
+            return push_(context::document);
+        case context::entities:
+            transform_ = {};
+            mesh_.reset();
+            return push_(context::entity);
+        case context::components:
+            return push_(context::component);
+        default:
+            return push_(context::ignored);
+        }
+    }
+
+    bool EndObject(rapidjson::SizeType)
+    {
+        if (top_() == context::component)
+        {
+            finish_component_();
+        }
+        else if (top_() == context::entity and mesh_)
+        {
+            scene_.spawn(transform_, *mesh_);
+        }
+        return pop_();
+    }
+
+    bool StartArray()
+    {
+        if (top_() == context::document and key_ == "entities")
+        {
+            return push_(context::entities);
+        }
+        if (top_() == context::entity and key_ == "components")
+        {
+            return push_(context::components);
+        }
+        if (top_() == context::component)
+        {
+            vector_size_ = 0;
+            return push_(context::vector);
+        }
+        return push_(context::ignored);
+    }
+
+    bool EndArray(rapidjson::SizeType)
+    {
+        if (top_() == context::vector)
+        {
+            finish_vector_();
+        }
+        return pop_();
+    }
+};
+
+glm::mat4 to_matrix(const transform& t)
+{
+    auto model = glm::translate(glm::mat4{1.f}, t.position);
+    model      = glm::rotate(model, t.rotation.z, glm::vec3{0.f, 0.f, 1.f});
+    model      = glm::rotate(model, t.rotation.y, glm::vec3{0.f, 1.f, 0.f});
+    model      = glm::rotate(model, t.rotation.x, glm::vec3{1.f, 0.f, 0.f});
+    return glm::scale(model, t.scale);
+}
+
+auto instance_group(entt::registry& registry)
+{
+    // owning group, both pools are packed in the same entity order
+    return registry.group<mesh_ref, transform>();
+}
+} // namespace
+
+world::world()
+{
+    instance_group(registry_);
+}
+
+uint32_t world::mesh_index(const std::filesystem::path& path)
+{
+    auto [it, inserted] = mesh_indices_.try_emplace(
+        path.string(), static_cast<uint32_t>(meshes_.size()));
+    if (inserted)
+    {
+        meshes_.push_back({.path = path});
+    }
+    return it->second;
+}
+
+void world::load_meshes()
+{
+    for (auto& m : meshes_)
+    {
+        if (m.index_count() == 0)
+        {
+            m = assets::load_mesh(m.path);
+        }
+    }
+}
+
+entt::entity world::spawn(const transform& t, uint32_t mesh)
+{
+    auto entity = registry_.create();
+    registry_.emplace<mesh_ref>(entity, mesh);
+    registry_.emplace<transform>(entity, t);
+    return entity;
+}
+
+size_t world::entity_count() const
+{
+    return registry_.view<const mesh_ref>().size();
+}
+
+std::span<const assets::mesh> world::meshes() const
+{
+    return meshes_;
+}
+
+entt::registry& world::registry()
+{
+    return registry_;
+}
+
+description world::instances()
+{
+    auto group = instance_group(registry_);
+    group.sort<mesh_ref>([](const mesh_ref& lhs, const mesh_ref& rhs) {
+        return lhs.mesh < rhs.mesh;
+    });
+
+    description result{.meshes = meshes_};
+    result.transforms.reserve(group.size());
+    group.each([&](const mesh_ref& ref, const transform& t) {
+        if (result.batches.empty() or result.batches.back().mesh != ref.mesh)
+        {
+            result.batches.push_back(
+                {.mesh           = ref.mesh,
+                 .first_instance = static_cast<uint32_t>(
+                     result.transforms.size()),
+                 .instance_count = 0});
+        }
+        ++result.batches.back().instance_count;
+        result.transforms.push_back(to_matrix(t));
+    });
+    return result;
+}
+
+void load(const std::filesystem::path& path, world& scene)
+{
+    mapped_file file{path};
+    auto text = file.text();
+    rapidjson::MemoryStream stream{text.data(), text.size()};
+    scene_reader handler{scene};
+    rapidjson::Reader reader;
+    auto result = reader.Parse(stream, handler);
+    if (result.IsError())
+    {
+        throw std::runtime_error{
+            std::format("failed to parse scene {} at {}: {}",
+                        path.string(),
+                        result.Offset(),
+                        rapidjson::GetParseError_En(result.Code()))};
+    }
+    scene.load_meshes();
+}
+
+void scatter(world& scene, uint32_t count, float extent, uint32_t seed)
+{
+    if (scene.meshes().empty())
+    {
+        throw std::runtime_error{"scene has no meshes to scatter!"};
+    }
+
+    std::mt19937 engine{seed};
+    std::uniform_real_distribution<float> horizontal{-0.5f * extent,
+                                                     0.5f * extent};
+    std::uniform_real_distribution<float> depth{-40.f, -2.f};
+    std::uniform_real_distribution<float> heading{
+        0.f, 2.f * std::numbers::pi_v<float>};
+    std::uniform_real_distribution<float> size{0.25f, 1.f};
+    std::uniform_int_distribution<uint32_t> pick{
+        0, static_cast<uint32_t>(scene.meshes().size() - 1)};
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        transform t{};
+        t.position   = {horizontal(engine), horizontal(engine), depth(engine)};
+        t.rotation.z = heading(engine);
+        t.scale      = glm::vec3{size(engine)};
+        scene.spawn(t, pick(engine));
+    }
+}
+} // namespace wf::scene
@@ -0,0 +1,83 @@
+module;
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+export module scene;
+
+import assets;
+import utils;
+
+namespace wf::scene
+{
+// components, kept in packed entt storage
+export struct transform
+{
+    glm::vec3 position = glm::vec3{0.f};
+    glm::vec3 rotation = glm::vec3{0.f}; // euler angles in radians
+    glm::vec3 scale    = glm::vec3{1.f};
+};
+
+export struct mesh_ref
+{
+    uint32_t mesh;
+};
+
+// instances of one mesh, their transforms are contiguous so the whole batch
+// is a single instanced draw
+export struct batch
+{
+    uint32_t mesh;
+    uint32_t first_instance;
+    uint32_t instance_count;
+};
+
+// what the renderer consumes, built from the registry by world::instances
+export struct description
+{
+    std::span<const assets::mesh> meshes;
+    std::vector<glm::mat4> transforms;
+    std::vector<batch> batches;
+
+    size_t instance_count() const;
+};
+
+export class world : non_copyable
+{
+  private:
+    entt::registry registry_;
+    std::vector<assets::mesh> meshes_;
+    std::unordered_map<std::string, uint32_t> mesh_indices_;
+
+  public:
+    world();
+
+    // entities referencing the same file share one mesh
+    uint32_t mesh_index(const std::filesystem::path& path);
+    // loads every referenced mesh, through the binary cache when fresh
+    void load_meshes();
+
+    entt::entity spawn(const transform& t, uint32_t mesh);
+    size_t entity_count() const;
+    std::span<const assets::mesh> meshes() const;
+    entt::registry& registry();
+
+    // walks the packed transforms grouped by mesh and bakes them into
+    // instance matrices, one batch per mesh
+    description instances();
+};
+
+// streams the scene file through a sax parser straight into the registry
+export void load(const std::filesystem::path& path, world& scene);
+
+// adds count instances of the loaded meshes scattered below the surface
+export void scatter(world& scene,
+                    uint32_t count,
+                    float extent,
+                    uint32_t seed = 1337);
+} // namespace wf::scene
@@ -0,0 +1,128 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+module simulation;
+
+namespace wf::simulation
+{
+snapshot& snapshot_exchange::back()
+{
+    return slots_[back_];
+}
+
+void snapshot_exchange::publish()
+{
+    // the slot handed back is whichever the reader released last
+    back_ = middle_.exchange(back_ | fresh, std::memory_order_acq_rel) &
+            ~fresh;
+}
+
+bool snapshot_exchange::acquire()
+{
+    if ((middle_.load(std::memory_order_relaxed) & fresh) == 0)
+    {
+        return false;
+    }
+    // the oldest slot goes back to the writer, the newest becomes current
+    auto published =
+        middle_.exchange(previous_, std::memory_order_acq_rel) & ~fresh;
+    previous_ = std::exchange(current_, published);
+    return true;
+}
+
+const snapshot& snapshot_exchange::current() const
+{
+    return slots_[current_];
+}
+
+const snapshot& snapshot_exchange::previous() const
+{
+    return slots_[previous_];
+}
+
+runner::runner(std::chrono::duration<double> timestep,
+               step_function step,
+               pacing mode)
+    : timestep_{timestep}, step_{std::move(step)}, pacing_{mode}
+{
+    step_once_(0);
+    thread_ = std::jthread{[this](std::stop_token stop) { run_(stop); }};
+}
+
+void runner::step_once_(uint64_t tick)
+{
+    auto start = clock::now();
+    auto& out  = exchange_.back();
+    out.tick   = tick;
+    out.time   = tick * timestep_.count();
+    step_(out.time, out);
+    out.published = clock::now();
+    exchange_.publish();
+
+    step_nanoseconds_.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(out.published -
+                                                             start)
+            .count(),
+        std::memory_order_relaxed);
+    ticks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void runner::run_(std::stop_token stop)
+{
+    auto timestep = std::chrono::duration_cast<clock::duration>(timestep_);
+    auto next     = clock::now();
+    for (uint64_t tick = 1; not stop.stop_requested(); ++tick)
+    {
+        if (pacing_ == pacing::realtime)
+        {
+            next += timestep;
+            auto now = clock::now();
+            if (now < next)
+            {
+                std::this_thread::sleep_until(next);
+            }
+            else if (now - next > timestep)
+            {
+                late_ticks_.fetch_add(1, std::memory_order_relaxed);
+                next = now;
+            }
+        }
+        step_once_(tick);
+    }
+}
+
+interpolation runner::acquire()
+{
+    exchange_.acquire();
+    const auto& current  = exchange_.current();
+    const auto& previous = exchange_.previous();
+
+    // until two snapshots exist there is nothing to blend from
+    if (previous.positions.size() != current.positions.size())
+    {
+        return {current, current, 1.f};
+    }
+    std::chrono::duration<double> since = clock::now() - current.published;
+    auto alpha = static_cast<float>(since / timestep_);
+    return {previous, current, std::clamp(alpha, 0.f, 1.f)};
+}
+
+statistics runner::stats() const
+{
+    return {ticks_.load(std::memory_order_relaxed),
+            late_ticks_.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds{
+                step_nanoseconds_.load(std::memory_order_relaxed)}};
+}
+
+std::chrono::duration<double> runner::timestep() const
+{
+    return timestep_;
+}
+} // namespace wf::simulation
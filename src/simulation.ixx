@@ -0,0 +1,110 @@
+module;
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+export module simulation;
+
+import utils;
+
+namespace wf::simulation
+{
+export using clock = std::chrono::steady_clock;
+
+// surface state at the end of one tick
+export struct snapshot
+{
+    uint64_t tick = 0;
+    double time   = 0.; // simulated seconds
+    clock::time_point published;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+};
+
+// triple buffer with one more slot on the reader side, so it can hold the
+// two newest snapshots to blend between while the writer always has a free
+// slot, neither side ever waits for the other
+export class snapshot_exchange : non_copyable
+{
+  private:
+    static constexpr uint32_t fresh = 4;
+
+    std::array<snapshot, 4> slots_;
+    // index of the published slot, or'ed with fresh until the reader took it
+    std::atomic<uint32_t> middle_{1};
+    uint32_t back_     = 0;
+    uint32_t current_  = 2;
+    uint32_t previous_ = 3;
+
+  public:
+    // writer side
+    snapshot& back();
+    void publish();
+
+    // reader side, true when a newer snapshot became current
+    bool acquire();
+    const snapshot& current() const;
+    const snapshot& previous() const;
+};
+
+export enum class pacing
+{
+    realtime,   // one tick per timestep of wall clock time
+    unthrottled // back to back, for measuring throughput
+};
+
+// what the renderer draws, alpha blends from previous to current and grows
+// with the time since current was published, one tick behind the simulation
+export struct interpolation
+{
+    const snapshot& previous;
+    const snapshot& current;
+    float alpha;
+};
+
+export struct statistics
+{
+    uint64_t ticks;
+    // ticks that started more than a timestep late, the schedule is then
+    // restarted instead of running the backlog back to back
+    uint64_t late_ticks;
+    std::chrono::duration<double> step_time;
+};
+
+export using step_function = std::function<void(double time, snapshot& out)>;
+
+// advances the simulation at a fixed timestep on its own thread, a slow
+// frame neither slows the simulation down nor waits for it
+export class runner : non_copyable
+{
+  private:
+    std::chrono::duration<double> timestep_;
+    step_function step_;
+    pacing pacing_;
+    snapshot_exchange exchange_;
+    std::atomic<uint64_t> ticks_{0};
+    std::atomic<uint64_t> late_ticks_{0};
+    std::atomic<int64_t> step_nanoseconds_{0};
+    // declared last, so the thread is joined before anything it uses goes
+    std::jthread thread_;
+
+    void step_once_(uint64_t tick);
+    void run_(std::stop_token stop);
+
+  public:
+    // the first tick runs before returning, so there is always a snapshot
+    runner(std::chrono::duration<double> timestep,
+           step_function step,
+           pacing mode = pacing::realtime);
+
+    interpolation acquire();
+    statistics stats() const;
+    std::chrono::duration<double> timestep() const;
+};
+} // namespace wf::simulation
@@ -0,0 +1,293 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <glm/glm.hpp>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+module text;
+
+namespace wf::text
+{
+skyline_packer::skyline_packer(uint32_t width, uint32_t height)
+    : width_{width}, height_{height}
+{
+    clear();
+}
+
+void skyline_packer::clear()
+{
+    skyline_.assign(1, {0, 0, width_});
+}
+
+std::optional<uint32_t> skyline_packer::fit_(size_t index,
+                                             uint32_t width,
+                                             uint32_t height) const
+{
+    auto x = skyline_[index].x;
+    if (x + width > width_)
+    {
+        return std::nullopt;
+    }
+    uint32_t top     = 0;
+    uint32_t covered = 0;
+    for (auto i = index; covered < width; ++i)
+    {
+        top = std::max(top, skyline_[i].y);
+        covered += skyline_[i].width;
+    }
+    if (top + height > height_)
+    {
+        return std::nullopt;
+    }
+    return top;
+}
+
+std::optional<std::array<uint32_t, 2>> skyline_packer::pack(uint32_t width,
+                                                            uint32_t height)
+{
+    auto best     = skyline_.size();
+    auto best_top = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < skyline_.size(); ++i)
+    {
+        auto top = fit_(i, width, height);
+        if (top and *top < best_top)
+        {
+            best     = i;
+            best_top = *top;
+        }
+    }
+    if (best == skyline_.size())
+    {
+        return std::nullopt;
+    }
+
+    // the new segment covers the ones under it, the last of those may keep
+    // a part sticking out to the right
+    auto x = skyline_[best].x;
+    skyline_.insert(std::begin(skyline_) + best,
+                    {x, best_top + height, width});
+    auto right = x + width;
+    auto next  = best + 1;
+    while (next < skyline_.size() and skyline_[next].x < right)
+    {
+        auto end = skyline_[next].x + skyline_[next].width;
+        if (end <= right)
+        {
+            skyline_.erase(std::begin(skyline_) + next);
+            continue;
+        }
+        skyline_[next].width = end - right;
+        skyline_[next].x     = right;
+        break;
+    }
+    for (size_t i = 0; i + 1 < skyline_.size();)
+    {
+        if (skyline_[i].y == skyline_[i + 1].y)
+        {
+            skyline_[i].width += skyline_[i + 1].width;
+            skyline_.erase(std::begin(skyline_) + i + 1);
+            continue;
+        }
+        ++i;
+    }
+    return std::array{x, best_top};
+}
+
+// a texel of space around every glyph keeps bilinear taps off neighbours
+constexpr uint32_t glyph_padding = 1;
+
+font::font(const std::filesystem::path& path, uint32_t atlas_size)
+    : atlas_size_{atlas_size}, atlas_(size_t{atlas_size} * atlas_size, 0),
+      packer_{atlas_size, atlas_size}, dirty_first_{atlas_size}
+{
+    if (FT_Init_FreeType(std::addressof(library_)) != 0)
+    {
+        throw std::runtime_error{"failed to initialize freetype!"};
+    }
+    if (FT_New_Face(
+            library_, path.string().c_str(), 0, std::addressof(face_)) != 0)
+    {
+        FT_Done_FreeType(library_);
+        throw std::runtime_error{
+            std::format("failed to load font {}!", path.string())};
+    }
+}
+
+font::~font()
+{
+    FT_Done_Face(face_);
+    FT_Done_FreeType(library_);
+}
+
+glyph font::rasterize_(char32_t codepoint, uint32_t pixel_size)
+{
+    if (pixel_size_ != pixel_size)
+    {
+        FT_Set_Pixel_Sizes(face_, 0, pixel_size);
+        pixel_size_ = pixel_size;
+    }
+    if (FT_Load_Char(face_, codepoint, FT_LOAD_RENDER) != 0)
+    {
+        throw std::runtime_error{
+            std::format("failed to rasterize codepoint {}!",
+                        static_cast<uint32_t>(codepoint))};
+    }
+    const auto* slot   = face_->glyph;
+    const auto& bitmap = slot->bitmap;
+    glyph result{
+        .offset  = {static_cast<float>(slot->bitmap_left),
+                    -static_cast<float>(slot->bitmap_top)},
+        .size    = {static_cast<float>(bitmap.width),
+                    static_cast<float>(bitmap.rows)},
+        .uv      = glm::vec4{0.f},
+        .advance = static_cast<float>(slot->advance.x) / 64.f,
+    };
+    if (bitmap.width == 0 or bitmap.rows == 0)
+    {
+        return result;
+    }
+
+    auto corner = packer_.pack(bitmap.width + glyph_padding,
+                               bitmap.rows + glyph_padding);
+    if (not corner)
+    {
+        throw std::runtime_error{"glyph atlas is full!"};
+    }
+    auto [x, y] = *corner;
+    for (uint32_t row = 0; row < bitmap.rows; ++row)
+    {
+        std::memcpy(atlas_.data() + size_t{y + row} * atlas_size_ + x,
+                    bitmap.buffer + static_cast<ptrdiff_t>(row) * bitmap.pitch,
+                    bitmap.width);
+    }
+    dirty_first_ = std::min(dirty_first_, y);
+    dirty_last_  = std::max(dirty_last_, y + bitmap.rows);
+
+    auto texel = 1.f / static_cast<float>(atlas_size_);
+    result.uv  = glm::vec4{x, y, x + bitmap.width, y + bitmap.rows} * texel;
+    return result;
+}
+
+const glyph& font::get(char32_t codepoint, uint32_t pixel_size)
+{
+    auto key = (uint64_t{pixel_size} << 32) | codepoint;
+    auto it  = glyphs_.find(key);
+    if (it == std::end(glyphs_))
+    {
+        it = glyphs_.emplace(key, rasterize_(codepoint, pixel_size)).first;
+    }
+    return it->second;
+}
+
+// design units of the face scaled the way FT_Set_Pixel_Sizes does
+float font::ascender(uint32_t pixel_size) const
+{
+    return static_cast<float>(face_->ascender) * pixel_size /
+           face_->units_per_EM;
+}
+
+float font::line_height(uint32_t pixel_size) const
+{
+    return static_cast<float>(face_->height) * pixel_size /
+           face_->units_per_EM;
+}
+
+uint32_t font::atlas_size() const
+{
+    return atlas_size_;
+}
+
+std::span<const uint8_t> font::atlas() const
+{
+    return atlas_;
+}
+
+std::optional<row_range> font::take_dirty_rows()
+{
+    if (dirty_first_ >= dirty_last_)
+    {
+        return std::nullopt;
+    }
+    row_range rows{dirty_first_, dirty_last_ - dirty_first_};
+    dirty_first_ = atlas_size_;
+    dirty_last_  = 0;
+    return rows;
+}
+
+namespace
+{
+constexpr char32_t replacement = 0xfffd;
+
+// next codepoint of the utf-8 text, malformed sequences decode to the
+// replacement character one byte at a time
+char32_t next_codepoint(std::string_view& text)
+{
+    auto lead   = static_cast<uint8_t>(text.front());
+    auto length = lead < 0x80   ? 1u
+                  : lead < 0xc0 ? 0u
+                  : lead < 0xe0 ? 2u
+                  : lead < 0xf0 ? 3u
+                  : lead < 0xf8 ? 4u
+                                : 0u;
+    if (length == 0 or length > text.size())
+    {
+        text.remove_prefix(1);
+        return replacement;
+    }
+    char32_t codepoint =
+        length == 1 ? lead : lead & (0xffu >> (length + 1));
+    for (size_t i = 1; i < length; ++i)
+    {
+        auto continuation = static_cast<uint8_t>(text[i]);
+        if ((continuation & 0xc0) != 0x80)
+        {
+            text.remove_prefix(1);
+            return replacement;
+        }
+        codepoint = (codepoint << 6) | (continuation & 0x3f);
+    }
+    text.remove_prefix(length);
+    return codepoint;
+}
+} // namespace
+
+void layout(font& f,
+            std::string_view text,
+            glm::vec2 origin,
+            uint32_t pixel_size,
+            uint32_t color,
+            std::vector<glyph_instance>& out)
+{
+    glm::vec2 pen{origin.x, origin.y + f.ascender(pixel_size)};
+    while (not text.empty())
+    {
+        auto codepoint = next_codepoint(text);
+        if (codepoint == U'\n')
+        {
+            pen = {origin.x, pen.y + f.line_height(pixel_size)};
+            continue;
+        }
+        const auto& g = f.get(codepoint, pixel_size);
+        if (g.size.x > 0.f)
+        {
+            // whole pixels keep the glyphs as sharp as they were rasterized
+            out.push_back({.rect  = glm::vec4{glm::floor(pen + g.offset),
+                                              g.size},
+                           .uv    = g.uv,
+                           .color = color});
+        }
+        pen.x += g.advance;
+    }
+}
+} // namespace wf::text
@@ -0,0 +1,118 @@
+module;
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <glm/glm.hpp>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+export module text;
+
+import utils;
+
+namespace wf::text
+{
+// packs rectangles into a fixed area keeping only the top edge of what was
+// placed, every rectangle goes where its top ends up lowest, leftmost first
+export class skyline_packer
+{
+  private:
+    struct segment
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    uint32_t width_;
+    uint32_t height_;
+    std::vector<segment> skyline_;
+
+    // top of a rectangle resting on the skyline from segment index on
+    std::optional<uint32_t> fit_(size_t index,
+                                 uint32_t width,
+                                 uint32_t height) const;
+
+  public:
+    skyline_packer(uint32_t width, uint32_t height);
+
+    // top left corner of the placed rectangle, empty when it fits nowhere
+    std::optional<std::array<uint32_t, 2>> pack(uint32_t width,
+                                                uint32_t height);
+    void clear();
+};
+
+// a rasterized glyph, in pixels from the pen position on the baseline
+export struct glyph
+{
+    glm::vec2 offset;
+    glm::vec2 size;
+    glm::vec4 uv; // top left and bottom right in the atlas
+    float advance;
+};
+
+// one quad as the vertex stage of shaders/text.vert reads it
+export struct glyph_instance
+{
+    glm::vec4 rect; // top left and size in pixels
+    glm::vec4 uv;
+    uint32_t color; // rgba8
+};
+static_assert(sizeof(glyph_instance) == 36);
+
+export struct row_range
+{
+    uint32_t first;
+    uint32_t count;
+};
+
+export constexpr uint32_t default_atlas_size = 512;
+
+// a font face and its single channel glyph atlas, glyphs are rasterized
+// the first time a size and codepoint pair is asked for and then kept
+export class font : non_copyable
+{
+  private:
+    FT_Library library_ = nullptr;
+    FT_Face face_       = nullptr;
+    FT_UInt pixel_size_ = 0;
+    uint32_t atlas_size_;
+    std::vector<uint8_t> atlas_;
+    skyline_packer packer_;
+    std::unordered_map<uint64_t, glyph> glyphs_;
+    // rows rasterized into since they were last taken
+    uint32_t dirty_first_;
+    uint32_t dirty_last_ = 0;
+
+    glyph rasterize_(char32_t codepoint, uint32_t pixel_size);
+
+  public:
+    explicit font(const std::filesystem::path& path,
+                  uint32_t atlas_size = default_atlas_size);
+    ~font();
+
+    // throws once the atlas is full
+    const glyph& get(char32_t codepoint, uint32_t pixel_size);
+    float ascender(uint32_t pixel_size) const;
+    float line_height(uint32_t pixel_size) const;
+
+    uint32_t atlas_size() const;
+    std::span<const uint8_t> atlas() const;
+    // empty when no glyph was added since the last call
+    std::optional<row_range> take_dirty_rows();
+};
+
+// appends a quad per glyph of the utf-8 text, origin is the top left of the
+// first line in pixels and lines break on '\n'
+export void layout(font& f,
+                   std::string_view text,
+                   glm::vec2 origin,
+                   uint32_t pixel_size,
+                   uint32_t color,
+                   std::vector<glyph_instance>& out);
+} // namespace wf::text
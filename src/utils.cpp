@@ -1,7 +1,20 @@
 module;
+#include <cstring>
 #include <fmt/format.h>
 #include <fmt/std.h>
 #include <source_location>
+#include <stdexcept>
+#include <utility>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 module utils;
 
@@ -14,25 +27,183 @@ void log(const std::string& message, const std::source_location& loc)
 
 std::string load_text_from_file(const std::filesystem::path& path)
 {
-    std::ifstream file{path};
-    file.exceptions(std::istream::failbit | std::ifstream::badbit);
-    std::string text = {std::istreambuf_iterator<char>{file}, {}};
-    return text;
+    mapped_file file{path};
+    return std::string{file.text()};
 }
 
 std::vector<std::byte> load_binary_from_file(const std::filesystem::path& path)
 {
-    std::ifstream file{path, std::ios::binary | std::ios::ate};
-    if (!file.is_open())
+    mapped_file file{path};
+    auto bytes = file.bytes();
+    return {std::begin(bytes), std::end(bytes)};
+}
+
+mapped_file::mapped_file(const std::filesystem::path& path,
+                         access_pattern pattern)
+{
+#ifdef _WIN32
+    auto file = CreateFileW(path.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            OPEN_EXISTING,
+                            pattern == access_pattern::sequential
+                                ? FILE_FLAG_SEQUENTIAL_SCAN
+                                : FILE_FLAG_RANDOM_ACCESS,
+                            nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error{
+            fmt::format("failed to open file {}!", path.string())};
+    }
+    file_ = file;
+
+    LARGE_INTEGER size{};
+    GetFileSizeEx(file, std::addressof(size));
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ == 0)
+    {
+        return;
+    }
+    mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ != nullptr)
+    {
+        data_ = static_cast<const std::byte*>(
+            MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (data_ == nullptr)
+    {
+        release_();
+        throw std::runtime_error{
+            fmt::format("failed to map file {}!", path.string())};
+    }
+    if (pattern == access_pattern::sequential)
+    {
+        WIN32_MEMORY_RANGE_ENTRY range{const_cast<std::byte*>(data_), size_};
+        PrefetchVirtualMemory(
+            GetCurrentProcess(), 1, std::addressof(range), 0);
+    }
+#else
+    descriptor_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor_ < 0)
+    {
+        throw std::runtime_error{
+            fmt::format("failed to open file {}!", path.string())};
+    }
+
+    struct stat status{};
+    if (::fstat(descriptor_, std::addressof(status)) != 0)
+    {
+        release_();
+        throw std::runtime_error{
+            fmt::format("failed to stat file {}!", path.string())};
+    }
+    size_ = static_cast<size_t>(status.st_size);
+    if (size_ == 0)
     {
-        throw std::runtime_error("Failed to open file");
+        return;
     }
-    file.exceptions(std::istream::failbit | std::ifstream::badbit);
-    auto size = static_cast<size_t>(file.tellg());
-    file.seekg(std::ios::beg);
-    std::vector<std::byte> data{size};
-    file.read(reinterpret_cast<char*>(data.data()), size);
-    return data;
+
+    auto* data =
+        ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor_, 0);
+    if (data == MAP_FAILED)
+    {
+        release_();
+        throw std::runtime_error{
+            fmt::format("failed to map file {}!", path.string())};
+    }
+    data_ = static_cast<const std::byte*>(data);
+    if (pattern == access_pattern::sequential)
+    {
+        ::madvise(data, size_, MADV_SEQUENTIAL);
+        ::madvise(data, size_, MADV_WILLNEED);
+    }
+    else
+    {
+        ::madvise(data, size_, MADV_RANDOM);
+    }
+#endif
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)},
+      size_{std::exchange(other.size_, 0)},
+#ifdef _WIN32
+      file_{std::exchange(other.file_, nullptr)},
+      mapping_{std::exchange(other.mapping_, nullptr)}
+#else
+      descriptor_{std::exchange(other.descriptor_, -1)}
+#endif
+{
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+    if (this != std::addressof(other))
+    {
+        release_();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+        file_    = std::exchange(other.file_, nullptr);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+#else
+        descriptor_ = std::exchange(other.descriptor_, -1);
+#endif
+    }
+    return *this;
+}
+
+mapped_file::~mapped_file()
+{
+    release_();
+}
+
+void mapped_file::release_()
+{
+#ifdef _WIN32
+    if (data_ != nullptr)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr)
+    {
+        CloseHandle(mapping_);
+    }
+    if (file_ != nullptr)
+    {
+        CloseHandle(file_);
+    }
+    file_    = nullptr;
+    mapping_ = nullptr;
+#else
+    if (data_ != nullptr)
+    {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+    if (descriptor_ >= 0)
+    {
+        ::close(descriptor_);
+    }
+    descriptor_ = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+std::span<const std::byte> mapped_file::bytes() const
+{
+    return {data_, size_};
+}
+
+std::string_view mapped_file::text() const
+{
+    return {reinterpret_cast<const char*>(data_), size_};
+}
+
+size_t mapped_file::size() const
+{
+    return size_;
 }
 
 scoped_file::~scoped_file()
@@ -1,9 +1,15 @@
 module;
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <fmt/format.h>
 #include <glm/glm.hpp>
 #include <source_location>
+#include <span>
+#include <string_view>
+#include <vector>
 
 export module utils;
 
@@ -29,6 +35,43 @@ static_assert(std::default_initializable<non_copyable>);
 static_assert(not std::copy_constructible<non_copyable>);
 static_assert(std::move_constructible<non_copyable>);
 
+export enum class access_pattern
+{
+    sequential,
+    random
+};
+
+// read only view of a whole file mapped into the address space, the pages
+// are faulted in by the kernel on first touch instead of being copied
+export class mapped_file
+{
+  private:
+    const std::byte* data_ = nullptr;
+    size_t size_           = 0;
+#ifdef _WIN32
+    void* file_    = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int descriptor_ = -1;
+#endif
+
+    void release_();
+
+  public:
+    explicit mapped_file(
+        const std::filesystem::path& path,
+        access_pattern pattern = access_pattern::sequential);
+    mapped_file(const mapped_file&)            = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+    ~mapped_file();
+
+    std::span<const std::byte> bytes() const;
+    std::string_view text() const;
+    size_t size() const;
+};
+
 export struct scoped_file
 {
   private:
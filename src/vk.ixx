@@ -1,13 +1,40 @@
 module;
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <filesystem>
+#include <functional>
 #include <glm/glm.hpp>
 #include <optional>
+#include <span>
 #include <string_view>
+#include <thread>
 #include <vector>
 #include <vulkan/vulkan.h>
 
 export module vk;
 
+export import :allocator;
+export import :bindless;
+export import :culler;
+export import :frame_ring;
+export import :gpu_timer;
+export import :pipeline_cache;
+export import :pipeline_library;
+export import :recorder;
+export import :text_overlay;
+export import :upload;
+export import :vertex_format;
+import assets;
+import culling;
+import gerstner;
+import jobs;
+import lod;
+import meshopt;
+import profiler;
+import quantize;
+import scene;
+import text;
 import window;
 import utils;
 
@@ -18,26 +45,105 @@ struct uniform_buffer_object
     alignas(16) glm::mat4 model;
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
+    alignas(16) glm::vec4 camera;
+    // simulated patch size, simulation resolution, quads per lod patch
+    alignas(16) glm::vec4 surface;
 };
 
+// one simulated surface point, read by the vertex stage from a storage buffer
 export struct vertex
 {
-    glm::vec2 pos;
-    glm::vec3 color;
-
-    static VkVertexInputBindingDescription get_binding_description();
-    static std::array<VkVertexInputAttributeDescription, 2>
-    get_attribute_descriptions();
+    glm::vec3 pos;
+    glm::vec3 normal;
 };
 static_assert(std::is_standard_layout_v<vertex>,
               "vertex must be standard layout");
 
-const std::vector<vertex> vertices{{{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-                                   {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-                                   {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
-                                   {{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}};
+// corner of the shared lod patch as lattice coordinates in [0, quads], the
+// vertex stage scales them to [0, 1]. instanced once per selected node
+struct patch_vertex
+{
+    std::array<uint8_t, 2> grid;
+};
+
+using patch_format = vertex_format<
+    vertex_stream<VK_VERTEX_INPUT_RATE_VERTEX, encoding::uint8x2>,
+    vertex_stream<VK_VERTEX_INPUT_RATE_INSTANCE,
+                  encoding::float32x4,
+                  encoding::float32x4>>;
+static_assert(patch_format::stream<0>::stride == sizeof(patch_vertex));
+static_assert(patch_format::stream<1>::stride == sizeof(lod::patch_instance));
+
+// the merged scene meshes, then the culled instance indices
+using mesh_format = vertex_format<
+    vertex_stream<VK_VERTEX_INPUT_RATE_VERTEX,
+                  encoding::snorm16x4,
+                  encoding::octahedral16>,
+    vertex_stream<VK_VERTEX_INPUT_RATE_INSTANCE, encoding::uint32>>;
+static_assert(mesh_format::stream<0>::stride == sizeof(quantize::mesh_vertex));
+
+export struct surface_layout
+{
+    uint32_t resolution;
+    float patch_size;
+};
+
+// how the culled scene reaches the gpu, from the most capable device down:
+// culled by compute and drawn with a gpu written count, culled on the cpu
+// into one indirect multi draw, or culled on the cpu and drawn one by one
+enum class scene_submission
+{
+    gpu_culled,
+    multi_draw,
+    direct
+};
+
+export struct pipeline_timings
+{
+    std::chrono::duration<double> creation;
+    bool warm_cache;
+};
+
+// fifo waits for vblank and never tears, mailbox replaces the queued image
+// for lower latency and immediate presents at once, tearing included
+export enum class present_mode
+{
+    fifo,
+    mailbox,
+    immediate
+};
+
+// latency against throughput policy, fewer frames in flight and images lower
+// input latency while more of them keep the gpu busy
+export struct frame_settings
+{
+    uint32_t frames_in_flight = 2;
+    present_mode present      = present_mode::mailbox;
+    // zero asks for one image more than the surface minimum
+    uint32_t swap_chain_images = 0;
+
+    bool operator==(const frame_settings&) const = default;
+};
+
+export using surface_writer = std::function<void(std::span<vertex>)>;
+
+// push constants of shaders/waves.comp
+struct surface_dispatch
+{
+    uint32_t resolution;
+    uint32_t wave_count;
+    float cell_size;
+    float origin;
+};
+constexpr uint32_t surface_workgroup_size = 64;
 
-const std::vector<uint16_t> indices = {0, 1, 2, 2, 3, 0};
+// push constants of the bindless vertex shaders, heap slots of the surface
+// and instance transforms the draw reads
+struct draw_resources
+{
+    uint32_t surface;
+    uint32_t transforms;
+};
 
 using namespace std::string_view_literals;
 constexpr std::array validation_layers = {"VK_LAYER_KHRONOS_validation"};
@@ -48,16 +154,18 @@ constexpr bool validation_layers_enabled = true;
 #endif
 
 constexpr std::array device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-constexpr int max_frames_in_flight     = 2;
 
 struct queue_family_indices
 {
     std::optional<uint32_t> graphics_family;
     std::optional<uint32_t> present_family;
+    std::optional<uint32_t> transfer_family;
+    std::optional<uint32_t> compute_family;
 
-    bool is_complete() const
+    bool is_complete(bool needs_present = true) const
     {
-        return graphics_family.has_value() and present_family.has_value();
+        return graphics_family.has_value() and
+               (present_family.has_value() or not needs_present);
     }
 };
 
@@ -71,45 +179,143 @@ struct swap_chain_support_details
 export class instance : wf::non_copyable
 {
   private:
-    std::reference_wrapper<window> window_;
+    optional_ref<window> window_;
     VkInstance instance_                      = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT debug_messenger_ = VK_NULL_HANDLE;
     VkSurfaceKHR surface_                     = VK_NULL_HANDLE;
 
     VkPhysicalDevice physical_device_ = VK_NULL_HANDLE;
     VkDevice logical_device_          = VK_NULL_HANDLE;
+    std::optional<device_allocator> allocator_;
+    std::optional<uploader> uploader_;
+    std::optional<pipeline_cache> pipeline_cache_;
+    // empty without descriptor indexing, draws then read the storage
+    // buffers through the per frame descriptor sets instead
+    std::optional<bindless_heap> bindless_;
+    std::chrono::duration<double> pipeline_creation_{};
+    queue_family_indices queue_families_;
 
     VkQueue graphics_queue_    = VK_NULL_HANDLE;
     VkQueue present_queue_     = VK_NULL_HANDLE;
+    VkQueue transfer_queue_    = VK_NULL_HANDLE;
+    VkQueue compute_queue_     = VK_NULL_HANDLE;
     VkSwapchainKHR swap_chain_ = VK_NULL_HANDLE;
     std::vector<VkImage> swap_chain_images_;
     VkFormat swap_chain_image_format_;
     VkExtent2D swap_chain_extent_;
     std::vector<VkImageView> swap_chain_image_views_;
+    std::vector<allocation> offscreen_image_allocations_;
+    // shared by every frame in flight, the render pass clears it on load
+    // and the subpass dependency orders one frame's tests after the last
+    VkFormat depth_format_;
+    VkImage depth_image_ = VK_NULL_HANDLE;
+    allocation depth_image_allocation_;
+    VkImageView depth_image_view_ = VK_NULL_HANDLE;
 
     VkRenderPass render_pass_;
     VkDescriptorSetLayout descriptor_set_layout_;
     VkPipelineLayout pipeline_layout_;
-    VkPipeline graphics_pipeline_;
+    std::optional<pipeline_library> pipelines_;
+    pipeline_id surface_pipeline_ = 0;
     std::vector<VkFramebuffer> swap_chain_framebuffers_;
     VkCommandPool command_pool_;
     std::vector<VkCommandBuffer> command_buffers_;
+    // the render pass is split across threads once the scene holds enough
+    // draws to pay for the secondary command buffers
+    std::optional<parallel_recorder> recorder_;
+    uint32_t record_threads_ =
+        std::max(1u, std::thread::hardware_concurrency());
 
     std::vector<VkSemaphore> image_available_semaphores_;
     std::vector<VkSemaphore> render_finished_semaphores_;
     std::vector<VkFence> in_flight_fences_;
+    frame_settings frames_;
     uint32_t current_frame_ = 0;
-    VkBuffer vertex_buffer_;
-    VkDeviceMemory vertex_buffer_memory_;
+    // camera animation clock, the surface brings its own simulated time
+    std::chrono::steady_clock::time_point start_time_ =
+        std::chrono::steady_clock::now();
+    uint32_t surface_resolution_;
+    float surface_patch_size_;
+    std::vector<VkBuffer> surface_vertex_buffers_;
+    std::vector<allocation> surface_vertex_allocations_;
+    std::vector<uint32_t> surface_slots_;
+
+    lod::quadtree lod_;
+    uint32_t patch_index_count_ = 0;
+    uint32_t patch_count_       = 0;
+    VkBuffer patch_vertex_buffer_;
+    allocation patch_vertex_allocation_;
     VkBuffer index_buffer_;
-    VkDeviceMemory index_buffer_memory_;
+    allocation index_buffer_allocation_;
+    VkDeviceSize patch_instance_offset_ = 0;
+
+    // gpu evaluated surface, written by the compute queue each frame and
+    // bound as the vertex buffer in place of the host written one
+    bool compute_surface_       = false;
+    uint32_t max_surface_waves_ = 0;
+    VkDescriptorSetLayout compute_descriptor_set_layout_;
+    VkPipelineLayout compute_pipeline_layout_;
+    VkPipeline compute_pipeline_;
+    VkDescriptorPool compute_descriptor_pool_;
+    std::vector<VkDescriptorSet> compute_descriptor_sets_;
+    VkCommandPool compute_command_pool_;
+    std::vector<VkCommandBuffer> compute_command_buffers_;
+    VkSemaphore compute_timeline_;
+    uint64_t compute_value_ = 0;
+    std::vector<VkBuffer> compute_surface_buffers_;
+    std::vector<allocation> compute_surface_allocations_;
+    std::vector<VkBuffer> wave_buffers_;
+    std::vector<allocation> wave_allocations_;
+
+    // scene entities sharing a mesh are one instanced draw, or one per
+    // meshlet for large meshes, all meshes share one vertex and one index
+    // buffer so a single indirect call draws them, per instance transforms
+    // live in a storage buffer
+    pipeline_id mesh_pipeline_ = 0;
+    VkBuffer scene_vertex_buffer_ = VK_NULL_HANDLE;
+    allocation scene_vertex_allocation_;
+    VkBuffer scene_index_buffer_ = VK_NULL_HANDLE;
+    allocation scene_index_allocation_;
+    uint32_t scene_vertex_count_ = 0;
+    std::vector<culling::draw_command> scene_draws_;
+    std::vector<culling::instance_bounds> scene_bounds_;
+    VkBuffer scene_draw_buffer_ = VK_NULL_HANDLE;
+    allocation scene_draw_allocation_;
+    VkBuffer scene_bounds_buffer_ = VK_NULL_HANDLE;
+    allocation scene_bounds_allocation_;
+    VkBuffer instance_transform_buffer_ = VK_NULL_HANDLE;
+    allocation instance_transform_allocation_;
+    uint32_t instance_transform_slot_ = 0;
 
-    std::vector<VkBuffer> uniform_buffers_;
-    std::vector<VkDeviceMemory> uniform_buffers_memory_;
-    std::vector<void*> uniform_buffers_mapped_;
+    // culled again every frame, the visible instance indices feed the mesh
+    // pipeline as a per instance attribute
+    scene_submission submission_ = scene_submission::direct;
+    std::optional<gpu_culler> culler_;
+    culling::view scene_view_{};
+    uint32_t scene_draw_count_          = 0;
+    VkDeviceSize scene_commands_offset_ = 0;
+    VkDeviceSize scene_visible_offset_  = 0;
+    std::vector<culling::draw_command> scene_commands_;
+
+    // per frame transient data, the uniforms are bound at a dynamic offset
+    std::optional<frame_ring> frame_ring_;
+    VkDeviceSize uniform_offset_ = 0;
     VkDescriptorPool descriptor_pool_;
+    // one per frame in flight, or a single uniforms only set with the heap
     std::vector<VkDescriptorSet> descriptor_sets_;
 
+    // cpu zones go straight to the attached profiler, gpu zones reach it
+    // through timestamp queries read back a few frames later
+    optional_ref<profiler::profiler> profiler_;
+    std::optional<gpu_timer> gpu_timer_;
+    bool compute_timestamps_ = false;
+
+    // drawn last, over everything else in the render pass
+    std::optional<text_overlay> overlay_;
+
+    void initialize_();
+    bool headless_() const;
+    std::span<const char* const> required_device_extensions_() const;
     void create_instance_();
     swap_chain_support_details query_swap_chain_support_(
         VkPhysicalDevice device);
@@ -126,40 +332,126 @@ export class instance : wf::non_copyable
     bool check_device_extension_support_(VkPhysicalDevice device);
     void create_swap_chain_();
     void create_image_views_();
+    void create_offscreen_targets_(VkExtent2D extent);
+    VkFormat find_depth_format_();
+    void create_depth_target_();
     void create_grahpics_pipeline_();
     void create_render_pass_();
     void create_framebuffers_();
     void create_command_pool_();
     void create_command_buffers_();
-    void record_command_buffer_(VkCommandBuffer command_buffer,
-                                uint32_t image_index);
+    void record_command_buffer_(
+        VkCommandBuffer command_buffer,
+        uint32_t image_index,
+        const std::optional<surface_dispatch>& dispatch);
+    uint32_t recording_partitions_() const;
+    void record_partition_(VkCommandBuffer command_buffer,
+                           uint32_t partition,
+                           uint32_t partitions);
+    std::optional<uint32_t> begin_frame_();
+    void submit_frame_(uint32_t image_index,
+                       const std::optional<surface_dispatch>& dispatch);
     void create_sync_objects_();
+    void create_frame_resources_();
+    void destroy_frame_resources_();
+    void create_gpu_timer_();
+    std::optional<uint32_t> begin_gpu_zone_(VkCommandBuffer command_buffer,
+                                            const char* name);
+    void end_gpu_zone_(VkCommandBuffer command_buffer,
+                       std::optional<uint32_t> zone);
     void recreate_swap_chain_();
     void cleanup_swap_chain_();
-    void create_vertex_buffer_();
-    uint32_t find_memory_type_(uint32_t type_filter,
-                               VkMemoryPropertyFlags properties);
+    void create_surface_vertex_buffers_();
+    bool async_compute_() const;
+    void create_compute_pipeline_();
+    void create_compute_buffers_();
+    void create_compute_descriptor_sets_();
+    void create_compute_commands_();
+    void create_compute_frames_();
+    void destroy_compute_frames_();
+    void write_surface_descriptors_();
+    void record_surface_dispatch_(VkCommandBuffer command_buffer,
+                                  const surface_dispatch& dispatch);
+    void submit_surface_dispatch_(const surface_dispatch& dispatch);
+    void destroy_compute_surface_();
+    void record_scene_(VkCommandBuffer command_buffer,
+                       uint32_t partition,
+                       uint32_t partitions);
+    void upload_scene_(const scene::description& scene);
+    void write_scene_descriptors_();
+    void create_culler_();
+    void cull_scene_(const uniform_buffer_object& ubo);
+    void destroy_scene_();
+    void compact_memory_();
+    VkBuffer create_unbound_buffer_(VkDeviceSize size,
+                                    VkBufferUsageFlags usage);
     void create_buffer_(VkDeviceSize size,
                         VkBufferUsageFlags usage,
                         VkMemoryPropertyFlags properties,
                         VkBuffer& buffer,
-                        VkDeviceMemory& buffer_memory);
+                        allocation& buffer_allocation);
+    void destroy_buffer_(VkBuffer buffer, const allocation& buffer_allocation);
+    void log_memory_statistics_() const;
 
-    void copy_buffer_(VkBuffer src_buffer,
-                      VkBuffer dst_buffer,
-                      VkDeviceSize size);
-    void create_index_buffer_();
+    void create_patch_buffers_();
+    void update_patches_(const uniform_buffer_object& ubo);
     void create_descriptor_set_layout_();
-    void create_uniform_buffers_();
-    void update_uniform_buffer_(uint32_t current_image);
+    void create_frame_ring_();
+    uniform_buffer_object update_uniform_buffer_();
     void create_descriptor_pool_();
     void create_descriptor_sets_();
+    VkDescriptorSet frame_descriptor_set_() const;
 
   public:
     bool framebuffer_resized = false;
-    instance(window& window);
+    instance(window& window,
+             const surface_layout& surface,
+             const frame_settings& frames       = {},
+             const lod::settings& lod_settings = {});
+    instance(VkExtent2D offscreen_extent,
+             const surface_layout& surface,
+             const frame_settings& frames       = {},
+             const lod::settings& lod_settings = {});
     operator VkInstance();
-    void draw_frame();
+    void draw_frame(const surface_writer& write_surface);
+
+    // moves surface evaluation to a compute pass, returns false when the
+    // device cannot host it and the caller should keep writing on the cpu
+    bool enable_compute_surface(uint32_t max_waves);
+    void draw_frame(gerstner::wave_field& field, float time);
+    std::vector<vertex> read_compute_surface();
+
+    // replaces the drawn entities, meshes are uploaded once however many
+    // instances reference them
+    void load_scene(const scene::description& scene);
+    uint32_t drawn_triangles() const;
+    // draws the last frame issued, the overlay's included, commands of an
+    // indirect call count one each
+    uint32_t drawn_batches() const;
+    // what the vertex input of the last frame kept resident and fetched
+    std::vector<stream_report> vertex_streams() const;
+
+    // screen space text from the font at the given pixel size, throws when
+    // the font cannot be loaded
+    void enable_overlay(const std::filesystem::path& font,
+                        uint32_t pixel_size);
+    // shown from the next frame on until replaced
+    void overlay_text(std::string_view text);
+
+    // upper bound on the threads recording a frame, one keeps it inline
+    void set_record_threads(uint32_t threads);
+
+    // waits for the device and rebuilds only what the new policy changes,
+    // per frame resources for the frame count and the swap chain otherwise
+    void apply(const frame_settings& frames);
+    const frame_settings& frames() const;
+
+    // times the frame stages from now on, gpu passes too when the device
+    // supports timestamps on the queues involved
+    void attach_profiler(profiler::profiler& profiler);
+
+    // time spent creating pipelines and whether the disk cache seeded them
+    pipeline_timings pipeline_startup() const;
     void wait_device_idle();
     ~instance();
 };
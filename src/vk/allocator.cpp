@@ -0,0 +1,491 @@
+module;
+#include <algorithm>
+#include <bit>
+#include <bitset>
+#include <fmt/format.h>
+#include <numeric>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+module vk;
+
+namespace wf::vk
+{
+uint8_t order_for(VkDeviceSize size, VkDeviceSize alignment)
+{
+    auto node_size = std::bit_ceil(
+        std::max({size, alignment, min_allocation_size}));
+    return to<uint8_t>(std::countr_zero(node_size / min_allocation_size));
+}
+
+VkDeviceSize order_size(uint8_t order)
+{
+    return min_allocation_size << order;
+}
+
+buddy_block::buddy_block(VkDeviceMemory memory,
+                         std::byte* mapped,
+                         VkDeviceSize size)
+    : memory{memory}, mapped{mapped}, size{size},
+      max_order{order_for(size, min_allocation_size)}
+{
+    free_lists_.resize(max_order + 1);
+    free_lists_[max_order].insert(0);
+}
+
+std::optional<VkDeviceSize> buddy_block::allocate(uint8_t order,
+                                                  VkDeviceSize size)
+{
+    if (order > max_order)
+    {
+        return std::nullopt;
+    }
+
+    auto source = order;
+    while (source <= max_order and free_lists_[source].empty())
+    {
+        ++source;
+    }
+    if (source > max_order)
+    {
+        return std::nullopt;
+    }
+
+    auto offset_it = std::begin(free_lists_[source]);
+    auto offset    = *offset_it;
+    free_lists_[source].erase(offset_it);
+
+    while (source > order)
+    {
+        --source;
+        free_lists_[source].insert(offset + order_size(source));
+    }
+
+    live_.emplace(offset, live_range{order, size});
+    used += order_size(order);
+    return offset;
+}
+
+void buddy_block::free(VkDeviceSize offset, uint8_t order)
+{
+    live_.erase(offset);
+    used -= order_size(order);
+
+    while (order < max_order)
+    {
+        auto buddy    = offset ^ order_size(order);
+        auto buddy_it = free_lists_[order].find(buddy);
+        if (buddy_it == std::end(free_lists_[order]))
+        {
+            break;
+        }
+        free_lists_[order].erase(buddy_it);
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+    free_lists_[order].insert(offset);
+}
+
+const std::map<VkDeviceSize, live_range>& buddy_block::live() const
+{
+    return live_;
+}
+
+bool buddy_block::empty() const
+{
+    return live_.empty();
+}
+
+device_allocator::device_allocator(VkPhysicalDevice physical_device,
+                                   VkDevice device,
+                                   VkDeviceSize preferred_block_size)
+    : device_{device}, preferred_block_size_{std::bit_floor(
+                           std::max(preferred_block_size, min_allocation_size))}
+{
+    vkGetPhysicalDeviceMemoryProperties(physical_device,
+                                        std::addressof(memory_properties_));
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, std::addressof(properties));
+    max_allocation_count_ = properties.limits.maxMemoryAllocationCount;
+    pools_.resize(memory_properties_.memoryTypeCount);
+}
+
+device_allocator::~device_allocator()
+{
+    for (auto& pool : pools_)
+    {
+        for (auto& block : pool.blocks)
+        {
+            if (block)
+            {
+                free_device_memory_(block->memory, block->mapped);
+            }
+        }
+    }
+}
+
+uint32_t device_allocator::find_memory_type_(
+    uint32_t type_filter,
+    VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; ++i)
+    {
+        std::bitset<32> bitset{type_filter};
+        bool matching_properties =
+            (memory_properties_.memoryTypes[i].propertyFlags & properties) ==
+            properties;
+        if (bitset.test(i) and matching_properties)
+        {
+            return i;
+        }
+    }
+    throw std::runtime_error{"failed to find suitable memory type!"};
+}
+
+VkDeviceSize device_allocator::block_size_(uint32_t memory_type) const
+{
+    auto heap_index = memory_properties_.memoryTypes[memory_type].heapIndex;
+    auto heap_size  = memory_properties_.memoryHeaps[heap_index].size;
+    return std::clamp(std::bit_floor(heap_size / 8),
+                      min_allocation_size,
+                      preferred_block_size_);
+}
+
+VkDeviceMemory device_allocator::allocate_device_memory_(uint32_t memory_type,
+                                                         VkDeviceSize size,
+                                                         std::byte** mapped)
+{
+    if (device_allocations_ >= max_allocation_count_)
+    {
+        throw std::runtime_error{"exceeded maxMemoryAllocationCount!"};
+    }
+
+    VkMemoryAllocateInfo alloc_info{};
+    alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize  = size;
+    alloc_info.memoryTypeIndex = memory_type;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(device_,
+                         std::addressof(alloc_info),
+                         nullptr,
+                         std::addressof(memory)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to allocate device memory!"};
+    }
+    ++device_allocations_;
+
+    *mapped = nullptr;
+    if (memory_properties_.memoryTypes[memory_type].propertyFlags &
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        void* data = nullptr;
+        vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, std::addressof(data));
+        *mapped = static_cast<std::byte*>(data);
+    }
+    return memory;
+}
+
+void device_allocator::free_device_memory_(VkDeviceMemory memory,
+                                           std::byte* mapped)
+{
+    if (mapped)
+    {
+        vkUnmapMemory(device_, memory);
+    }
+    vkFreeMemory(device_, memory, nullptr);
+    --device_allocations_;
+}
+
+std::optional<allocation> device_allocator::allocate_from_block_(
+    uint32_t memory_type,
+    uint32_t block,
+    uint8_t order,
+    VkDeviceSize size)
+{
+    auto& source = pools_[memory_type].blocks[block];
+    if (not source)
+    {
+        return std::nullopt;
+    }
+    auto offset = source->allocate(order, size);
+    if (not offset)
+    {
+        return std::nullopt;
+    }
+    return allocation{
+        .memory      = source->memory,
+        .offset      = *offset,
+        .size        = size,
+        .mapped      = source->mapped ? source->mapped + *offset : nullptr,
+        .memory_type = memory_type,
+        .block       = block,
+        .order       = order,
+    };
+}
+
+std::optional<allocation> device_allocator::allocate_from_blocks_(
+    uint32_t memory_type,
+    uint8_t order,
+    VkDeviceSize size)
+{
+    auto block_count = to<uint32_t>(pools_[memory_type].blocks.size());
+    for (uint32_t i = 0; i < block_count; ++i)
+    {
+        if (auto result = allocate_from_block_(memory_type, i, order, size))
+        {
+            return result;
+        }
+    }
+    return std::nullopt;
+}
+
+allocation device_allocator::allocate(const VkMemoryRequirements& requirements,
+                                      VkMemoryPropertyFlags properties)
+{
+    std::scoped_lock lock{mutex_};
+    auto memory_type =
+        find_memory_type_(requirements.memoryTypeBits, properties);
+    auto& pool       = pools_[memory_type];
+    auto block_size  = block_size_(memory_type);
+    auto order       = order_for(requirements.size, requirements.alignment);
+
+    ++pool.allocation_count;
+    pool.requested_bytes += requirements.size;
+
+    if (order_size(order) > block_size / 2)
+    {
+        allocation dedicated{
+            .size        = requirements.size,
+            .memory_type = memory_type,
+        };
+        dedicated.memory = allocate_device_memory_(
+            memory_type, requirements.size, std::addressof(dedicated.mapped));
+        pool.dedicated_bytes += requirements.size;
+        ++pool.dedicated_count;
+        return dedicated;
+    }
+
+    auto sub_allocation =
+        allocate_from_blocks_(memory_type, order, requirements.size);
+    if (not sub_allocation)
+    {
+        std::byte* mapped = nullptr;
+        auto memory       = allocate_device_memory_(
+            memory_type, block_size, std::addressof(mapped));
+        auto block = std::make_unique<buddy_block>(memory, mapped, block_size);
+
+        auto free_slot = std::ranges::find_if(
+            pool.blocks, [](const auto& slot) { return not slot; });
+        if (free_slot != std::end(pool.blocks))
+        {
+            *free_slot = std::move(block);
+        }
+        else
+        {
+            pool.blocks.push_back(std::move(block));
+        }
+        sub_allocation =
+            allocate_from_blocks_(memory_type, order, requirements.size);
+    }
+    return *sub_allocation;
+}
+
+void device_allocator::free(const allocation& alloc)
+{
+    if (alloc.memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    std::scoped_lock lock{mutex_};
+    auto& pool = pools_[alloc.memory_type];
+    --pool.allocation_count;
+    pool.requested_bytes -= alloc.size;
+
+    if (alloc.is_dedicated())
+    {
+        pool.dedicated_bytes -= alloc.size;
+        --pool.dedicated_count;
+        free_device_memory_(alloc.memory, alloc.mapped);
+        return;
+    }
+    pool.blocks[alloc.block]->free(alloc.offset, alloc.order);
+}
+
+void device_allocator::release_empty_blocks_()
+{
+    for (auto& pool : pools_)
+    {
+        for (auto& block : pool.blocks)
+        {
+            if (block and block->empty())
+            {
+                free_device_memory_(block->memory, block->mapped);
+                block.reset();
+            }
+        }
+        while (not pool.blocks.empty() and not pool.blocks.back())
+        {
+            pool.blocks.pop_back();
+        }
+    }
+}
+
+void device_allocator::trim()
+{
+    std::scoped_lock lock{mutex_};
+    release_empty_blocks_();
+}
+
+std::vector<relocation> device_allocator::defragment(
+    std::span<const allocation> movable)
+{
+    std::scoped_lock lock{mutex_};
+    std::vector<relocation> relocations;
+    for (uint32_t memory_type = 0; memory_type < pools_.size(); ++memory_type)
+    {
+        auto& pool   = pools_[memory_type];
+        auto& blocks = pool.blocks;
+        auto owned   = [&](uint32_t block, VkDeviceSize offset) {
+            return std::ranges::find_if(movable, [&](const allocation& alloc) {
+                return alloc.memory_type == memory_type and
+                       alloc.block == block and alloc.offset == offset;
+            });
+        };
+
+        std::vector<uint32_t> candidates(blocks.size());
+        std::iota(std::begin(candidates), std::end(candidates), 0u);
+        std::erase_if(candidates, [&](uint32_t i) {
+            return not blocks[i] or blocks[i]->empty();
+        });
+        if (candidates.size() < 2)
+        {
+            continue;
+        }
+        std::ranges::sort(candidates, {}, [&](uint32_t i) {
+            return blocks[i]->used;
+        });
+
+        // evacuated blocks are a prefix of the sparsest ones, ending at the
+        // first block which holds something its owner cannot move
+        auto sources = candidates.size() - 1;
+        for (size_t i = 0; i < sources; ++i)
+        {
+            auto pinned = std::ranges::any_of(
+                blocks[candidates[i]]->live(), [&](const auto& live) {
+                    return owned(candidates[i], live.first) ==
+                           std::end(movable);
+                });
+            if (pinned)
+            {
+                sources = i;
+            }
+        }
+
+        // the sparsest blocks whose data fits into the free space of the
+        // denser rest are evacuated, the rest only receive. fixing both sets
+        // up front keeps data from moving into a block emptied earlier in
+        // the pass or due to be emptied later
+        auto source_bytes = [&](size_t count) {
+            VkDeviceSize bytes = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                bytes += blocks[candidates[i]]->used;
+            }
+            return bytes;
+        };
+        auto free_bytes = [&](size_t count) {
+            VkDeviceSize bytes = 0;
+            for (auto i = count; i < candidates.size(); ++i)
+            {
+                const auto& block = *blocks[candidates[i]];
+                bytes += block.size - block.used;
+            }
+            return bytes;
+        };
+        while (sources > 0 and source_bytes(sources) > free_bytes(sources))
+        {
+            --sources;
+        }
+        std::span<const uint32_t> receivers{
+            std::begin(candidates) + sources, std::end(candidates)};
+
+        for (auto candidate : std::span{candidates}.first(sources))
+        {
+            const auto& source = *blocks[candidate];
+            std::vector<relocation> plan;
+            for (const auto& [offset, range] : source.live())
+            {
+                std::optional<allocation> target;
+                for (auto receiver : receivers)
+                {
+                    target = allocate_from_block_(
+                        memory_type, receiver, range.order, range.size);
+                    if (target)
+                    {
+                        break;
+                    }
+                }
+                if (not target)
+                {
+                    break;
+                }
+                plan.push_back({*owned(candidate, offset), *target});
+            }
+
+            // a block left half evacuated frees nothing, so either every
+            // range moves or none does
+            if (plan.size() != source.live().size())
+            {
+                for (const auto& [from, to] : plan)
+                {
+                    blocks[to.block]->free(to.offset, to.order);
+                }
+                continue;
+            }
+
+            // the reserved ranges count as allocations until the owner frees
+            // the ones they replace
+            for (const auto& move : plan)
+            {
+                ++pool.allocation_count;
+                pool.requested_bytes += move.to.size;
+                relocations.push_back(move);
+            }
+        }
+    }
+    return relocations;
+}
+
+std::vector<heap_statistics> device_allocator::statistics() const
+{
+    std::scoped_lock lock{mutex_};
+    std::vector<heap_statistics> heaps(memory_properties_.memoryHeapCount);
+    for (uint32_t i = 0; i < heaps.size(); ++i)
+    {
+        heaps[i].heap_index = i;
+        heaps[i].heap_size  = memory_properties_.memoryHeaps[i].size;
+    }
+
+    for (uint32_t memory_type = 0; memory_type < pools_.size(); ++memory_type)
+    {
+        const auto& pool = pools_[memory_type];
+        auto& heap =
+            heaps[memory_properties_.memoryTypes[memory_type].heapIndex];
+        heap.reserved_bytes += pool.dedicated_bytes;
+        heap.used_bytes += pool.requested_bytes;
+        heap.dedicated_count += pool.dedicated_count;
+        heap.allocation_count += pool.allocation_count;
+        for (const auto& block : pool.blocks)
+        {
+            if (block)
+            {
+                heap.reserved_bytes += block->size;
+                ++heap.block_count;
+            }
+        }
+    }
+    return heaps;
+}
+} // namespace wf::vk
@@ -0,0 +1,142 @@
+module;
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+export module vk:allocator;
+
+import utils;
+
+namespace wf::vk
+{
+constexpr VkDeviceSize min_allocation_size = 256;
+constexpr VkDeviceSize default_block_size  = VkDeviceSize{64} << 20;
+constexpr uint32_t dedicated_block         = UINT32_MAX;
+
+struct allocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset   = 0;
+    VkDeviceSize size     = 0;
+    std::byte* mapped     = nullptr;
+    uint32_t memory_type  = 0;
+    uint32_t block        = dedicated_block;
+    uint8_t order         = 0;
+
+    bool is_dedicated() const
+    {
+        return block == dedicated_block;
+    }
+};
+
+struct relocation
+{
+    allocation from;
+    allocation to;
+};
+
+struct heap_statistics
+{
+    uint32_t heap_index         = 0;
+    VkDeviceSize heap_size      = 0;
+    VkDeviceSize reserved_bytes = 0;
+    VkDeviceSize used_bytes     = 0;
+    uint32_t block_count        = 0;
+    uint32_t dedicated_count    = 0;
+    uint32_t allocation_count   = 0;
+};
+
+struct live_range
+{
+    uint8_t order;
+    VkDeviceSize size;
+};
+
+// power-of-two buddy system over a single VkDeviceMemory, every node of
+// order n is (min_allocation_size << n) bytes and aligned to its own size
+class buddy_block : non_copyable
+{
+  private:
+    std::vector<std::set<VkDeviceSize>> free_lists_;
+    std::map<VkDeviceSize, live_range> live_;
+
+  public:
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    std::byte* mapped     = nullptr;
+    VkDeviceSize size     = 0;
+    VkDeviceSize used     = 0;
+    uint8_t max_order     = 0;
+
+    buddy_block(VkDeviceMemory memory, std::byte* mapped, VkDeviceSize size);
+    std::optional<VkDeviceSize> allocate(uint8_t order, VkDeviceSize size);
+    void free(VkDeviceSize offset, uint8_t order);
+    const std::map<VkDeviceSize, live_range>& live() const;
+    bool empty() const;
+};
+
+struct memory_type_pool
+{
+    std::vector<std::unique_ptr<buddy_block>> blocks;
+    VkDeviceSize dedicated_bytes = 0;
+    uint32_t dedicated_count     = 0;
+    uint32_t allocation_count    = 0;
+    VkDeviceSize requested_bytes = 0;
+};
+
+class device_allocator : non_copyable
+{
+  private:
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memory_properties_{};
+    uint32_t max_allocation_count_ = 0;
+    uint32_t device_allocations_   = 0;
+    VkDeviceSize preferred_block_size_;
+    std::vector<memory_type_pool> pools_;
+    mutable std::mutex mutex_;
+
+    uint32_t find_memory_type_(uint32_t type_filter,
+                               VkMemoryPropertyFlags properties) const;
+    VkDeviceSize block_size_(uint32_t memory_type) const;
+    VkDeviceMemory allocate_device_memory_(uint32_t memory_type,
+                                           VkDeviceSize size,
+                                           std::byte** mapped);
+    void free_device_memory_(VkDeviceMemory memory, std::byte* mapped);
+    std::optional<allocation> allocate_from_block_(uint32_t memory_type,
+                                                   uint32_t block,
+                                                   uint8_t order,
+                                                   VkDeviceSize size);
+    std::optional<allocation> allocate_from_blocks_(uint32_t memory_type,
+                                                    uint8_t order,
+                                                    VkDeviceSize size);
+    void release_empty_blocks_();
+
+  public:
+    device_allocator(VkPhysicalDevice physical_device,
+                     VkDevice device,
+                     VkDeviceSize preferred_block_size = default_block_size);
+    ~device_allocator();
+
+    allocation allocate(const VkMemoryRequirements& requirements,
+                        VkMemoryPropertyFlags properties);
+    void free(const allocation& alloc);
+
+    // releases blocks which no longer hold any allocation
+    void trim();
+
+    // plans moves out of sparsely used blocks into denser ones, only blocks
+    // holding nothing but `movable` allocations are evacuated. the `to` ranges
+    // are already reserved, the owner copies the contents, recreates its
+    // resources on them and frees every `from`, trim() then releases the
+    // emptied blocks
+    std::vector<relocation> defragment(std::span<const allocation> movable);
+
+    std::vector<heap_statistics> statistics() const;
+};
+} // namespace wf::vk
@@ -0,0 +1,270 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+module vk;
+
+namespace wf::vk
+{
+bool bindless_heap::request_features(VkPhysicalDevice physical_device,
+                                     VkPhysicalDeviceFeatures& features,
+                                     VkPhysicalDeviceVulkan12Features& vulkan12)
+{
+    VkPhysicalDeviceVulkan12Features available12{};
+    available12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 available{};
+    available.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    available.pNext = std::addressof(available12);
+    vkGetPhysicalDeviceFeatures2(physical_device, std::addressof(available));
+
+    // indices come from push constants, so they are dynamically uniform and
+    // the non uniform indexing features are not needed
+    auto supported =
+        available.features.shaderStorageBufferArrayDynamicIndexing and
+        available.features.shaderSampledImageArrayDynamicIndexing and
+        available12.runtimeDescriptorArray and
+        available12.descriptorBindingPartiallyBound and
+        available12.descriptorBindingUpdateUnusedWhilePending and
+        available12.descriptorBindingStorageBufferUpdateAfterBind and
+        available12.descriptorBindingSampledImageUpdateAfterBind;
+    if (not supported)
+    {
+        return false;
+    }
+
+    features.shaderStorageBufferArrayDynamicIndexing       = VK_TRUE;
+    features.shaderSampledImageArrayDynamicIndexing        = VK_TRUE;
+    vulkan12.runtimeDescriptorArray                        = VK_TRUE;
+    vulkan12.descriptorBindingPartiallyBound               = VK_TRUE;
+    vulkan12.descriptorBindingUpdateUnusedWhilePending     = VK_TRUE;
+    vulkan12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    vulkan12.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+    return true;
+}
+
+bindless_heap::bindless_heap(VkPhysicalDevice physical_device,
+                             VkDevice device)
+    : device_{device}
+{
+    VkPhysicalDeviceVulkan12Properties properties12{};
+    properties12.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = std::addressof(properties12);
+    vkGetPhysicalDeviceProperties2(physical_device,
+                                   std::addressof(properties));
+    buffers_.capacity = std::min(
+        {max_buffers,
+         properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+         properties12.maxDescriptorSetUpdateAfterBindStorageBuffers});
+    images_.capacity = std::min(
+        {max_images,
+         properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+         properties12.maxDescriptorSetUpdateAfterBindSampledImages});
+
+    constexpr auto stages = VK_SHADER_STAGE_VERTEX_BIT |
+                            VK_SHADER_STAGE_FRAGMENT_BIT |
+                            VK_SHADER_STAGE_COMPUTE_BIT;
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding         = buffer_binding;
+    bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = buffers_.capacity;
+    bindings[0].stageFlags      = stages;
+    bindings[1].binding         = image_binding;
+    bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    bindings[1].descriptorCount = images_.capacity;
+    bindings[1].stageFlags      = stages;
+
+    // slots that were never written or have been removed are fine as long
+    // as no shader reads them
+    constexpr VkDescriptorBindingFlags binding_flag =
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    std::array binding_flags = {binding_flag, binding_flag};
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info{};
+    flags_info.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flags_info.bindingCount  = to<uint32_t>(binding_flags.size());
+    flags_info.pBindingFlags = binding_flags.data();
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.pNext = std::addressof(flags_info);
+    layout_info.flags =
+        VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layout_info.bindingCount = to<uint32_t>(bindings.size());
+    layout_info.pBindings    = bindings.data();
+    if (vkCreateDescriptorSetLayout(device_,
+                                    std::addressof(layout_info),
+                                    nullptr,
+                                    std::addressof(layout_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create bindless set layout!"};
+    }
+
+    std::array<VkDescriptorPoolSize, 2> pool_sizes{};
+    pool_sizes[0].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_sizes[0].descriptorCount = buffers_.capacity;
+    pool_sizes[1].type            = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    pool_sizes[1].descriptorCount = images_.capacity;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    pool_info.poolSizeCount = to<uint32_t>(pool_sizes.size());
+    pool_info.pPoolSizes    = pool_sizes.data();
+    pool_info.maxSets       = 1;
+    if (vkCreateDescriptorPool(device_,
+                               std::addressof(pool_info),
+                               nullptr,
+                               std::addressof(pool_)) != VK_SUCCESS)
+    {
+        vkDestroyDescriptorSetLayout(device_, layout_, nullptr);
+        throw std::runtime_error{"failed to create bindless pool!"};
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType          = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = pool_;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts        = std::addressof(layout_);
+    if (vkAllocateDescriptorSets(
+            device_, std::addressof(alloc_info), std::addressof(set_)) !=
+        VK_SUCCESS)
+    {
+        vkDestroyDescriptorPool(device_, pool_, nullptr);
+        vkDestroyDescriptorSetLayout(device_, layout_, nullptr);
+        throw std::runtime_error{"failed to allocate bindless set!"};
+    }
+}
+
+bindless_heap::~bindless_heap()
+{
+    vkDestroyDescriptorPool(device_, pool_, nullptr);
+    vkDestroyDescriptorSetLayout(device_, layout_, nullptr);
+}
+
+uint32_t bindless_heap::acquire_(slots& array)
+{
+    if (not array.free.empty())
+    {
+        auto index = array.free.back();
+        array.free.pop_back();
+        return index;
+    }
+    if (array.next == array.capacity)
+    {
+        throw std::runtime_error{"bindless heap is full!"};
+    }
+    return array.next++;
+}
+
+void bindless_heap::retire_(slots& array, uint32_t index)
+{
+    array.retired.emplace_back(frame_, index);
+}
+
+void bindless_heap::write_buffer_(uint32_t index,
+                                  VkBuffer buffer,
+                                  VkDeviceSize offset,
+                                  VkDeviceSize range)
+{
+    VkDescriptorBufferInfo buffer_info{};
+    buffer_info.buffer = buffer;
+    buffer_info.offset = offset;
+    buffer_info.range  = range;
+
+    VkWriteDescriptorSet write{};
+    write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet          = set_;
+    write.dstBinding      = buffer_binding;
+    write.dstArrayElement = index;
+    write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo     = std::addressof(buffer_info);
+    vkUpdateDescriptorSets(device_, 1, std::addressof(write), 0, nullptr);
+}
+
+uint32_t bindless_heap::add_buffer(VkBuffer buffer,
+                                   VkDeviceSize offset,
+                                   VkDeviceSize range)
+{
+    auto index = acquire_(buffers_);
+    write_buffer_(index, buffer, offset, range);
+    return index;
+}
+
+void bindless_heap::update_buffer(uint32_t index,
+                                  VkBuffer buffer,
+                                  VkDeviceSize offset,
+                                  VkDeviceSize range)
+{
+    write_buffer_(index, buffer, offset, range);
+}
+
+uint32_t bindless_heap::add_image(VkImageView view, VkImageLayout layout)
+{
+    auto index = acquire_(images_);
+
+    VkDescriptorImageInfo image_info{};
+    image_info.imageView   = view;
+    image_info.imageLayout = layout;
+
+    VkWriteDescriptorSet write{};
+    write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet          = set_;
+    write.dstBinding      = image_binding;
+    write.dstArrayElement = index;
+    write.descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.descriptorCount = 1;
+    write.pImageInfo      = std::addressof(image_info);
+    vkUpdateDescriptorSets(device_, 1, std::addressof(write), 0, nullptr);
+    return index;
+}
+
+void bindless_heap::remove_buffer(uint32_t index)
+{
+    retire_(buffers_, index);
+}
+
+void bindless_heap::remove_image(uint32_t index)
+{
+    retire_(images_, index);
+}
+
+void bindless_heap::next_frame(uint32_t frames_in_flight)
+{
+    ++frame_;
+    for (auto* array : {std::addressof(buffers_), std::addressof(images_)})
+    {
+        auto expired = [&](const auto& retired) {
+            return retired.first + frames_in_flight <= frame_;
+        };
+        for (const auto& retired : array->retired)
+        {
+            if (expired(retired))
+            {
+                array->free.push_back(retired.second);
+            }
+        }
+        std::erase_if(array->retired, expired);
+    }
+}
+
+VkDescriptorSetLayout bindless_heap::layout() const
+{
+    return layout_;
+}
+
+VkDescriptorSet bindless_heap::set() const
+{
+    return set_;
+}
+} // namespace wf::vk
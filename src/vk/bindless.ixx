@@ -0,0 +1,79 @@
+module;
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+export module vk:bindless;
+
+import utils;
+
+namespace wf::vk
+{
+// one descriptor set holding large arrays of storage buffers and sampled
+// images, shaders reach a resource through the index it was added at, so
+// draws pass indices in push constants instead of binding sets per frame
+class bindless_heap : non_copyable
+{
+  private:
+    // stable indices into one array, freed ones come back after a delay
+    struct slots
+    {
+        uint32_t capacity;
+        uint32_t next = 0;
+        std::vector<uint32_t> free;
+        std::vector<std::pair<uint64_t, uint32_t>> retired; // frame, index
+    };
+
+    VkDevice device_;
+    VkDescriptorSetLayout layout_ = VK_NULL_HANDLE;
+    VkDescriptorPool pool_        = VK_NULL_HANDLE;
+    VkDescriptorSet set_          = VK_NULL_HANDLE;
+    slots buffers_;
+    slots images_;
+    uint64_t frame_ = 0;
+
+    uint32_t acquire_(slots& array);
+    void retire_(slots& array, uint32_t index);
+    void write_buffer_(uint32_t index,
+                       VkBuffer buffer,
+                       VkDeviceSize offset,
+                       VkDeviceSize range);
+
+  public:
+    static constexpr uint32_t buffer_binding = 0;
+    static constexpr uint32_t image_binding  = 1;
+    // upper bounds, lowered to what the device allows per stage
+    static constexpr uint32_t max_buffers = 1u << 14;
+    static constexpr uint32_t max_images  = 1u << 14;
+
+    // turns on the descriptor indexing features the heap relies on when the
+    // device has all of them, the caller falls back to plain sets otherwise
+    static bool request_features(VkPhysicalDevice physical_device,
+                                 VkPhysicalDeviceFeatures& features,
+                                 VkPhysicalDeviceVulkan12Features& vulkan12);
+
+    bindless_heap(VkPhysicalDevice physical_device, VkDevice device);
+    ~bindless_heap();
+
+    // update after bind lets slots change while other frames that never
+    // read them are still executing
+    uint32_t add_buffer(VkBuffer buffer,
+                        VkDeviceSize offset = 0,
+                        VkDeviceSize range  = VK_WHOLE_SIZE);
+    void update_buffer(uint32_t index,
+                       VkBuffer buffer,
+                       VkDeviceSize offset = 0,
+                       VkDeviceSize range  = VK_WHOLE_SIZE);
+    uint32_t add_image(VkImageView view, VkImageLayout layout);
+    // the slot is handed out again only once every frame that could have
+    // been recorded against it has retired
+    void remove_buffer(uint32_t index);
+    void remove_image(uint32_t index);
+    // called once the oldest frame's fence has signaled
+    void next_frame(uint32_t frames_in_flight);
+
+    VkDescriptorSetLayout layout() const;
+    VkDescriptorSet set() const;
+};
+} // namespace wf::vk
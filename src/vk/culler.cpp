@@ -0,0 +1,320 @@
+module;
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+module vk;
+
+import culling;
+
+namespace wf::vk
+{
+namespace
+{
+VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// instances, draws, counts, commands, visible
+constexpr uint32_t cull_bindings = 5;
+} // namespace
+
+gpu_culler::gpu_culler(VkPhysicalDevice physical_device,
+                       VkDevice device,
+                       device_allocator& allocator,
+                       VkPipelineCache cache,
+                       VkBuffer instances,
+                       uint32_t instance_count,
+                       VkBuffer draws,
+                       uint32_t draw_count,
+                       uint32_t frame_count)
+    : device_{device}, allocator_{allocator}, instance_count_{instance_count},
+      draw_count_{draw_count}
+{
+    create_pipeline_(cache);
+    create_frames_(physical_device, instances, draws, frame_count);
+}
+
+gpu_culler::~gpu_culler()
+{
+    for (const auto& frame : frames_)
+    {
+        vkDestroyBuffer(device_, frame.buffer, nullptr);
+        allocator_.free(frame.storage);
+    }
+    vkDestroyDescriptorPool(device_, pool_, nullptr);
+    vkDestroyPipeline(device_, pipeline_, nullptr);
+    vkDestroyPipelineLayout(device_, layout_, nullptr);
+    vkDestroyDescriptorSetLayout(device_, set_layout_, nullptr);
+}
+
+void gpu_culler::create_pipeline_(VkPipelineCache cache)
+{
+    std::array<VkDescriptorSetLayoutBinding, cull_bindings> bindings{};
+    for (uint32_t binding = 0; binding < bindings.size(); ++binding)
+    {
+        bindings[binding].binding         = binding;
+        bindings[binding].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[binding].descriptorCount = 1;
+        bindings[binding].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = to<uint32_t>(bindings.size());
+    layout_info.pBindings    = bindings.data();
+    if (vkCreateDescriptorSetLayout(device_,
+                                    std::addressof(layout_info),
+                                    nullptr,
+                                    std::addressof(set_layout_)) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create cull set layout!"};
+    }
+
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset     = 0;
+    push_constant_range.size       = sizeof(cull_constants);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts    = std::addressof(set_layout_);
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges =
+        std::addressof(push_constant_range);
+    if (vkCreatePipelineLayout(device_,
+                               std::addressof(pipeline_layout_info),
+                               nullptr,
+                               std::addressof(layout_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create cull pipeline layout!"};
+    }
+
+    mapped_file comp_code{"../shaders/cull.comp.spv"};
+    vk_shader_module comp_shader_module(device_, comp_code.bytes());
+
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = comp_shader_module.module;
+    pipeline_info.stage.pName  = "main";
+    pipeline_info.layout       = layout_;
+    if (vkCreateComputePipelines(device_,
+                                 cache,
+                                 1,
+                                 std::addressof(pipeline_info),
+                                 nullptr,
+                                 std::addressof(pipeline_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create cull pipeline!"};
+    }
+}
+
+void gpu_culler::create_frames_(VkPhysicalDevice physical_device,
+                                VkBuffer instances,
+                                VkBuffer draws,
+                                uint32_t frame_count)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device,
+                                  std::addressof(properties));
+    auto alignment = properties.limits.minStorageBufferOffsetAlignment;
+
+    // draw count followed by one visible count per draw
+    counts_size_     = sizeof(uint32_t) * (VkDeviceSize{draw_count_} + 1);
+    commands_offset_ = align_up(counts_size_, alignment);
+    visible_offset_  = align_up(
+        commands_offset_ + sizeof(culling::draw_command) * draw_count_,
+        alignment);
+    auto buffer_size = visible_offset_ + sizeof(uint32_t) * instance_count_;
+
+    VkDescriptorPoolSize pool_size{};
+    pool_size.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_size.descriptorCount = cull_bindings * frame_count;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes    = std::addressof(pool_size);
+    pool_info.maxSets       = frame_count;
+    if (vkCreateDescriptorPool(device_,
+                               std::addressof(pool_info),
+                               nullptr,
+                               std::addressof(pool_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create cull descriptor pool!"};
+    }
+
+    frames_.resize(frame_count);
+    for (auto& frame : frames_)
+    {
+        VkBufferCreateInfo buffer_info{};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size  = buffer_size;
+        buffer_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                            VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(device_,
+                           std::addressof(buffer_info),
+                           nullptr,
+                           std::addressof(frame.buffer)) != VK_SUCCESS)
+        {
+            throw std::runtime_error{"failed to create cull buffer!"};
+        }
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(
+            device_, frame.buffer, std::addressof(requirements));
+        frame.storage = allocator_.allocate(
+            requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        vkBindBufferMemory(
+            device_, frame.buffer, frame.storage.memory, frame.storage.offset);
+
+        VkDescriptorSetAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool     = pool_;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts        = std::addressof(set_layout_);
+        if (vkAllocateDescriptorSets(device_,
+                                     std::addressof(alloc_info),
+                                     std::addressof(frame.set)) != VK_SUCCESS)
+        {
+            throw std::runtime_error{"failed to allocate cull descriptor set!"};
+        }
+
+        std::array<VkDescriptorBufferInfo, cull_bindings> buffer_infos{{
+            {instances, 0, VK_WHOLE_SIZE},
+            {draws, 0, VK_WHOLE_SIZE},
+            {frame.buffer, 0, counts_size_},
+            {frame.buffer,
+             commands_offset_,
+             sizeof(culling::draw_command) * draw_count_},
+            {frame.buffer, visible_offset_, VK_WHOLE_SIZE},
+        }};
+        std::array<VkWriteDescriptorSet, cull_bindings> descriptor_writes{};
+        for (uint32_t binding = 0; binding < descriptor_writes.size();
+             ++binding)
+        {
+            auto& write           = descriptor_writes[binding];
+            write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet          = frame.set;
+            write.dstBinding      = binding;
+            write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.descriptorCount = 1;
+            write.pBufferInfo     = std::addressof(buffer_infos[binding]);
+        }
+        vkUpdateDescriptorSets(device_,
+                               to<uint32_t>(descriptor_writes.size()),
+                               descriptor_writes.data(),
+                               0,
+                               nullptr);
+    }
+}
+
+void gpu_culler::record(VkCommandBuffer command_buffer,
+                        uint32_t frame,
+                        const culling::view& view)
+{
+    const auto& output = frames_[frame];
+    vkCmdFillBuffer(command_buffer, output.buffer, 0, counts_size_, 0);
+
+    auto barrier = [&](VkPipelineStageFlags src_stage,
+                       VkAccessFlags src_access,
+                       VkPipelineStageFlags dst_stage,
+                       VkAccessFlags dst_access) {
+        VkMemoryBarrier memory_barrier{};
+        memory_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.srcAccessMask = src_access;
+        memory_barrier.dstAccessMask = dst_access;
+        vkCmdPipelineBarrier(command_buffer,
+                             src_stage,
+                             dst_stage,
+                             0,
+                             1,
+                             std::addressof(memory_barrier),
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+    };
+    barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    vkCmdBindPipeline(
+        command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+    vkCmdBindDescriptorSets(command_buffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            layout_,
+                            0,
+                            1,
+                            std::addressof(output.set),
+                            0,
+                            nullptr);
+
+    // the first pass appends visible instances to their draw, the second
+    // one compacts the draws which kept any
+    cull_constants constants{.view           = view,
+                             .instance_count = instance_count_,
+                             .draw_count     = draw_count_,
+                             .pass           = 0};
+    for (auto invocations : {instance_count_, draw_count_})
+    {
+        vkCmdPushConstants(command_buffer,
+                           layout_,
+                           VK_SHADER_STAGE_COMPUTE_BIT,
+                           0,
+                           sizeof(constants),
+                           std::addressof(constants));
+        vkCmdDispatch(command_buffer,
+                      (invocations + cull_workgroup_size - 1) /
+                          cull_workgroup_size,
+                      1,
+                      1);
+        barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                constants.pass == 0 ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                    : VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                constants.pass == 0 ? VK_ACCESS_SHADER_READ_BIT |
+                                          VK_ACCESS_SHADER_WRITE_BIT
+                                    : VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+                                          VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+        ++constants.pass;
+    }
+}
+
+VkBuffer gpu_culler::buffer(uint32_t frame) const
+{
+    return frames_[frame].buffer;
+}
+
+VkDeviceSize gpu_culler::count_offset() const
+{
+    return 0;
+}
+
+VkDeviceSize gpu_culler::commands_offset() const
+{
+    return commands_offset_;
+}
+
+VkDeviceSize gpu_culler::visible_offset() const
+{
+    return visible_offset_;
+}
+
+uint32_t gpu_culler::max_draws() const
+{
+    return draw_count_;
+}
+} // namespace wf::vk
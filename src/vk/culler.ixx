@@ -0,0 +1,87 @@
+module;
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+export module vk:culler;
+
+import culling;
+import utils;
+import :allocator;
+
+namespace wf::vk
+{
+// push constants of shaders/cull.comp
+struct cull_constants
+{
+    culling::view view;
+    uint32_t instance_count;
+    uint32_t draw_count;
+    uint32_t pass;
+};
+static_assert(sizeof(cull_constants) <= 128,
+              "cull constants exceed the guaranteed push constant size");
+
+constexpr uint32_t cull_workgroup_size = 64;
+
+// culls the scene instances on the gpu, every frame in flight owns one
+// buffer holding the draw count and visible counts, the compacted indirect
+// commands and the visible instance indices, which the mesh pipeline reads
+// as a per instance vertex attribute
+class gpu_culler : non_copyable
+{
+  private:
+    struct frame_output
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        allocation storage;
+        VkDescriptorSet set = VK_NULL_HANDLE;
+    };
+
+    VkDevice device_;
+    device_allocator& allocator_;
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout layout_          = VK_NULL_HANDLE;
+    VkPipeline pipeline_              = VK_NULL_HANDLE;
+    VkDescriptorPool pool_            = VK_NULL_HANDLE;
+    std::vector<frame_output> frames_;
+    uint32_t instance_count_;
+    uint32_t draw_count_;
+    VkDeviceSize counts_size_;
+    VkDeviceSize commands_offset_;
+    VkDeviceSize visible_offset_;
+
+    void create_pipeline_(VkPipelineCache cache);
+    void create_frames_(VkPhysicalDevice physical_device,
+                        VkBuffer instances,
+                        VkBuffer draws,
+                        uint32_t frame_count);
+
+  public:
+    // instances and draws are the scene's static culling::instance_bounds
+    // and culling::draw_command arrays, already on the device
+    gpu_culler(VkPhysicalDevice physical_device,
+               VkDevice device,
+               device_allocator& allocator,
+               VkPipelineCache cache,
+               VkBuffer instances,
+               uint32_t instance_count,
+               VkBuffer draws,
+               uint32_t draw_count,
+               uint32_t frame_count);
+    ~gpu_culler();
+
+    // records outside a render pass, leaves the output ready for indirect
+    // draws and vertex input
+    void record(VkCommandBuffer command_buffer,
+                uint32_t frame,
+                const culling::view& view);
+
+    VkBuffer buffer(uint32_t frame) const;
+    // the draw count is the first word of the buffer
+    VkDeviceSize count_offset() const;
+    VkDeviceSize commands_offset() const;
+    VkDeviceSize visible_offset() const;
+    uint32_t max_draws() const;
+};
+} // namespace wf::vk
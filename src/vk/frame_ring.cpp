@@ -0,0 +1,131 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+module vk;
+
+namespace wf::vk
+{
+namespace
+{
+VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+frame_ring::frame_ring(VkPhysicalDevice physical_device,
+                       VkDevice device,
+                       device_allocator& allocator,
+                       VkDeviceSize bytes_per_frame,
+                       uint32_t frame_count,
+                       VkBufferUsageFlags usage)
+    : device_{device}, allocator_{allocator}
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device,
+                                  std::addressof(properties));
+    const auto& limits = properties.limits;
+    // every allocation may be bound as any of the buffer kinds
+    alignment_ = std::max({limits.minUniformBufferOffsetAlignment,
+                           limits.minStorageBufferOffsetAlignment,
+                           VkDeviceSize{16}});
+    atom_size_ = limits.nonCoherentAtomSize;
+    // segments start on a flushable boundary so frames never share an atom
+    segment_size_ = align_up(bytes_per_frame, std::max(alignment_, atom_size_));
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size        = segment_size_ * frame_count;
+    buffer_info.usage       = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(device_,
+                       std::addressof(buffer_info),
+                       nullptr,
+                       std::addressof(buffer_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create frame ring buffer!"};
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(
+        device_, buffer_, std::addressof(requirements));
+    allocation_ = allocator_.allocate(requirements,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    vkBindBufferMemory(
+        device_, buffer_, allocation_.memory, allocation_.offset);
+
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device,
+                                        std::addressof(memory_properties));
+    coherent_ = memory_properties.memoryTypes[allocation_.memory_type]
+                    .propertyFlags &
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+frame_ring::~frame_ring()
+{
+    vkDestroyBuffer(device_, buffer_, nullptr);
+    allocator_.free(allocation_);
+}
+
+void frame_ring::begin_frame(uint32_t frame)
+{
+    frame_ = frame;
+    head_.store(0, std::memory_order_relaxed);
+}
+
+ring_allocation frame_ring::allocate(VkDeviceSize size)
+{
+    auto aligned = align_up(size, alignment_);
+    auto offset  = head_.fetch_add(aligned, std::memory_order_relaxed);
+    if (offset + aligned > segment_size_)
+    {
+        throw std::runtime_error{"frame ring segment exhausted!"};
+    }
+    auto begin = segment_size_ * frame_ + offset;
+    return {begin,
+            std::span{allocation_.mapped + begin, static_cast<size_t>(size)}};
+}
+
+void frame_ring::flush()
+{
+    if (coherent_)
+    {
+        return;
+    }
+    // ranges are relative to the memory object and rounded out to whole
+    // atoms, the segment itself starts on an atom boundary of the buffer
+    auto first = allocation_.offset + segment_size_ * frame_;
+    auto used  = std::min(head_.load(std::memory_order_relaxed), segment_size_);
+    if (used == 0)
+    {
+        return;
+    }
+    VkMappedMemoryRange range{};
+    range.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation_.memory;
+    range.offset = first / atom_size_ * atom_size_;
+    range.size   = align_up(first + used, atom_size_) - range.offset;
+    vkFlushMappedMemoryRanges(device_, 1, std::addressof(range));
+}
+
+VkBuffer frame_ring::buffer() const
+{
+    return buffer_;
+}
+
+VkDeviceSize frame_ring::used() const
+{
+    return std::min(head_.load(std::memory_order_relaxed), segment_size_);
+}
+
+VkDeviceSize frame_ring::segment_size() const
+{
+    return segment_size_;
+}
+} // namespace wf::vk
@@ -0,0 +1,72 @@
+module;
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vulkan/vulkan.h>
+
+export module vk:frame_ring;
+
+import utils;
+import :allocator;
+
+namespace wf::vk
+{
+struct ring_allocation
+{
+    // relative to the start of the buffer, what a dynamic offset takes
+    VkDeviceSize offset;
+    std::span<std::byte> data;
+};
+
+// one persistently mapped buffer split into a segment per frame in flight,
+// each frame bump allocates its transient data from the start of its own
+// segment, the frame fence guarantees the gpu is done with what was there
+class frame_ring : non_copyable
+{
+  private:
+    VkDevice device_;
+    device_allocator& allocator_;
+    VkBuffer buffer_ = VK_NULL_HANDLE;
+    allocation allocation_;
+    VkDeviceSize segment_size_;
+    VkDeviceSize alignment_;
+    VkDeviceSize atom_size_;
+    bool coherent_;
+    uint32_t frame_ = 0;
+    // bytes handed out in the current segment, bumped from any thread
+    std::atomic<VkDeviceSize> head_{0};
+
+  public:
+    frame_ring(VkPhysicalDevice physical_device,
+               VkDevice device,
+               device_allocator& allocator,
+               VkDeviceSize bytes_per_frame,
+               uint32_t frame_count,
+               VkBufferUsageFlags usage);
+    ~frame_ring();
+
+    // starts the frame's segment over, only once its fence has signaled
+    void begin_frame(uint32_t frame);
+    ring_allocation allocate(VkDeviceSize size);
+    template <typename T> ring_allocation push(const T& value)
+    {
+        auto result = allocate(sizeof(T));
+        std::memcpy(result.data.data(), std::addressof(value), sizeof(T));
+        return result;
+    }
+    template <typename T> ring_allocation push(std::span<T> values)
+    {
+        auto result = allocate(values.size_bytes());
+        std::memcpy(result.data.data(), values.data(), values.size_bytes());
+        return result;
+    }
+    // makes host writes visible to the device, a no-op on coherent memory
+    void flush();
+
+    VkBuffer buffer() const;
+    VkDeviceSize used() const;
+    VkDeviceSize segment_size() const;
+};
+} // namespace wf::vk
@@ -0,0 +1,140 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+module vk;
+
+namespace wf::vk
+{
+gpu_timer::gpu_timer(VkDevice device,
+                     VkPhysicalDevice physical_device,
+                     uint32_t valid_bits,
+                     uint32_t frame_count)
+    : device_{device},
+      valid_mask_{valid_bits >= 64 ? std::numeric_limits<uint64_t>::max()
+                                   : (uint64_t{1} << valid_bits) - 1},
+      frames_(frame_count)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device,
+                                  std::addressof(properties));
+    period_ = properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo create_info{};
+    create_info.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    create_info.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+    create_info.queryCount = 2 * zones_per_frame * frame_count;
+    if (vkCreateQueryPool(device_,
+                          std::addressof(create_info),
+                          nullptr,
+                          std::addressof(pool_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create timestamp query pool!"};
+    }
+    vkResetQueryPool(device_, pool_, 0, create_info.queryCount);
+}
+
+gpu_timer::~gpu_timer()
+{
+    vkDestroyQueryPool(device_, pool_, nullptr);
+}
+
+uint32_t gpu_timer::first_query_(uint32_t frame) const
+{
+    return 2 * zones_per_frame * frame;
+}
+
+uint32_t gpu_timer::begin(VkCommandBuffer command_buffer,
+                          uint32_t frame,
+                          const char* name)
+{
+    auto& zones = frames_[frame];
+    if (zones.names.size() == zones_per_frame)
+    {
+        throw std::runtime_error{"too many gpu zones in one frame!"};
+    }
+    auto zone = to<uint32_t>(zones.names.size());
+    zones.names.push_back(name);
+    vkCmdWriteTimestamp(command_buffer,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        pool_,
+                        first_query_(frame) + 2 * zone);
+    return zone;
+}
+
+void gpu_timer::end(VkCommandBuffer command_buffer,
+                    uint32_t frame,
+                    uint32_t zone)
+{
+    vkCmdWriteTimestamp(command_buffer,
+                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        pool_,
+                        first_query_(frame) + 2 * zone + 1);
+}
+
+void gpu_timer::submitted(uint32_t frame,
+                          uint64_t time,
+                          uint32_t profiler_frame)
+{
+    frames_[frame].submitted = time;
+    frames_[frame].frame     = profiler_frame;
+}
+
+void gpu_timer::collect(uint32_t frame, profiler::profiler& profiler)
+{
+    auto& zones = frames_[frame];
+    if (zones.names.empty())
+    {
+        return;
+    }
+
+    // value and availability pairs
+    std::array<uint64_t, 4 * zones_per_frame> results{};
+    auto query_count = to<uint32_t>(2 * zones.names.size());
+    vkGetQueryPoolResults(device_,
+                          pool_,
+                          first_query_(frame),
+                          query_count,
+                          sizeof(results),
+                          results.data(),
+                          2 * sizeof(uint64_t),
+                          VK_QUERY_RESULT_64_BIT |
+                              VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    // timestamps only order within a frame, so the earliest one is pinned
+    // to the moment the frame was submitted
+    auto origin = std::numeric_limits<uint64_t>::max();
+    for (uint32_t query = 0; query < query_count; ++query)
+    {
+        if (results[2 * query + 1] != 0)
+        {
+            origin = std::min(origin, results[2 * query] & valid_mask_);
+        }
+    }
+    for (uint32_t zone = 0; zone < zones.names.size(); ++zone)
+    {
+        auto begin = 4 * zone;
+        if (results[begin + 1] == 0 or results[begin + 3] == 0)
+        {
+            continue;
+        }
+        auto to_time = [&](uint64_t ticks) {
+            auto elapsed = ((ticks & valid_mask_) - origin) * period_;
+            return zones.submitted + static_cast<uint64_t>(elapsed);
+        };
+        profiler.record({.name   = zones.names[zone],
+                         .begin  = to_time(results[begin]),
+                         .end    = to_time(results[begin + 2]),
+                         .frame  = zones.frame,
+                         .thread = 0,
+                         .gpu    = true});
+    }
+
+    vkResetQueryPool(device_, pool_, first_query_(frame), query_count);
+    zones.names.clear();
+}
+} // namespace wf::vk
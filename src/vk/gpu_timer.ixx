@@ -0,0 +1,52 @@
+module;
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+export module vk:gpu_timer;
+
+import profiler;
+import utils;
+
+namespace wf::vk
+{
+// timestamp pairs around gpu work, a fixed block of zones per frame in flight
+// read back once that frame's fence has signaled so nothing ever waits
+class gpu_timer : non_copyable
+{
+  private:
+    struct frame_zones
+    {
+        std::vector<const char*> names; // zone i owns queries 2i and 2i + 1
+        uint64_t submitted = 0;         // profiler time of the submission
+        uint32_t frame     = 0;
+    };
+
+    VkDevice device_;
+    VkQueryPool pool_ = VK_NULL_HANDLE;
+    double period_;
+    uint64_t valid_mask_;
+    std::vector<frame_zones> frames_;
+
+    uint32_t first_query_(uint32_t frame) const;
+
+  public:
+    static constexpr uint32_t zones_per_frame = 4;
+
+    gpu_timer(VkDevice device,
+              VkPhysicalDevice physical_device,
+              uint32_t valid_bits,
+              uint32_t frame_count);
+    ~gpu_timer();
+
+    uint32_t begin(VkCommandBuffer command_buffer,
+                   uint32_t frame,
+                   const char* name);
+    void end(VkCommandBuffer command_buffer, uint32_t frame, uint32_t zone);
+    void submitted(uint32_t frame, uint64_t time, uint32_t profiler_frame);
+
+    // turns the finished zones of the frame into gpu samples, which are
+    // placed on the cpu timeline relative to the frame's submission
+    void collect(uint32_t frame, profiler::profiler& profiler);
+};
+} // namespace wf::vk
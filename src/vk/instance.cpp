@@ -5,13 +5,17 @@ module;
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <algorithm>
-#include <bitset>
 #include <chrono>
+#include <filesystem>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <limits>
 #include <print>
 #include <ranges>
 #include <set>
+#include <span>
+#include <thread>
+#include <utility>
 module vk;
 
 namespace wf::vk
@@ -173,14 +177,14 @@ void instance::set_debug_messenger_()
 void instance::create_surface_()
 {
     if (glfwCreateWindowSurface(
-            instance_, window_.get(), nullptr, std::addressof(surface_)) !=
+            instance_, window_->get(), nullptr, std::addressof(surface_)) !=
         VK_SUCCESS)
     {
         throw std::runtime_error{"failed to create window surface!"};
     }
 }
 
-std::vector<const char*> get_required_extensions()
+std::vector<const char*> get_required_extensions(bool windowed)
 {
     uint32_t extension_count = 0;
     vkEnumerateInstanceExtensionProperties(
@@ -200,11 +204,15 @@ std::vector<const char*> get_required_extensions()
     std::ranges::for_each(available_ext_range,
                           [](std::string_view v) { std::println("{}", v); });
 
-    uint32_t glfw_extension_count{};
-    const char** glfw_extensions =
-        glfwGetRequiredInstanceExtensions(std::addressof(glfw_extension_count));
-    std::vector<const char*> required_extensions(
-        glfw_extensions, glfw_extensions + glfw_extension_count);
+    std::vector<const char*> required_extensions;
+    if (windowed)
+    {
+        uint32_t glfw_extension_count{};
+        const char** glfw_extensions = glfwGetRequiredInstanceExtensions(
+            std::addressof(glfw_extension_count));
+        required_extensions.assign(glfw_extensions,
+                                   glfw_extensions + glfw_extension_count);
+    }
     if (validation_layers_enabled)
     {
         required_extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -222,6 +230,15 @@ std::vector<const char*> get_required_extensions()
     return required_extensions;
 }
 
+static frame_settings validated(const frame_settings& frames)
+{
+    if (frames.frames_in_flight == 0)
+    {
+        throw std::runtime_error{"at least one frame must be in flight!"};
+    }
+    return frames;
+}
+
 static void framebuffer_resize_callback(GLFWwindow* window,
                                         int width,
                                         int height)
@@ -230,10 +247,17 @@ static void framebuffer_resize_callback(GLFWwindow* window,
     app->framebuffer_resized = true;
 }
 
-instance::instance(window& window) : window_{window}
+instance::instance(window& window,
+                   const surface_layout& surface,
+                   const frame_settings& frames,
+                   const lod::settings& lod_settings)
+    : window_{window}, frames_{validated(frames)},
+      surface_resolution_{surface.resolution},
+      surface_patch_size_{surface.patch_size}, lod_{lod_settings}
 {
-    glfwSetWindowUserPointer(window_.get(), this);
-    glfwSetFramebufferSizeCallback(window_.get(), framebuffer_resize_callback);
+    glfwSetWindowUserPointer(window_->get(), this);
+    glfwSetFramebufferSizeCallback(window_->get(),
+                                   framebuffer_resize_callback);
     create_instance_();
     set_debug_messenger_();
     create_surface_();
@@ -241,18 +265,52 @@ instance::instance(window& window) : window_{window}
     create_logical_device_();
     create_swap_chain_();
     create_image_views_();
+    initialize_();
+}
+
+instance::instance(VkExtent2D offscreen_extent,
+                   const surface_layout& surface,
+                   const frame_settings& frames,
+                   const lod::settings& lod_settings)
+    : frames_{validated(frames)}, surface_resolution_{surface.resolution},
+      surface_patch_size_{surface.patch_size}, lod_{lod_settings}
+{
+    create_instance_();
+    set_debug_messenger_();
+    pick_physical_device_();
+    create_logical_device_();
+    create_offscreen_targets_(offscreen_extent);
+    create_image_views_();
+    initialize_();
+}
+
+bool instance::headless_() const
+{
+    return not window_.has_value();
+}
+
+std::span<const char* const> instance::required_device_extensions_() const
+{
+    if (headless_())
+    {
+        return {};
+    }
+    return device_extensions;
+}
+
+void instance::initialize_()
+{
     create_render_pass_();
     create_descriptor_set_layout_();
+    auto pipelines_start = std::chrono::steady_clock::now();
     create_grahpics_pipeline_();
+    pipeline_creation_ += std::chrono::steady_clock::now() - pipelines_start;
     create_framebuffers_();
     create_command_pool_();
-    create_vertex_buffer_();
-    create_index_buffer_();
-    create_uniform_buffers_();
-    create_descriptor_pool_();
-    create_descriptor_sets_();
-    create_command_buffers_();
-    create_sync_objects_();
+    create_patch_buffers_();
+    uploader_->flush();
+    create_frame_resources_();
+    log_memory_statistics_();
 }
 
 void instance::create_instance_()
@@ -272,7 +330,7 @@ void instance::create_instance_()
             "validation layers requested, but not available!"};
     }
 
-    auto required_extensions = get_required_extensions();
+    auto required_extensions = get_required_extensions(not headless_());
 
     VkInstanceCreateInfo create_info{
         .sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
@@ -306,62 +364,149 @@ instance::operator VkInstance()
     return instance_;
 }
 
-void instance::draw_frame()
+std::optional<uint32_t> instance::begin_frame_()
 {
-    vkWaitForFences(logical_device_,
-                    1,
-                    std::addressof(in_flight_fences_[current_frame_]),
-                    VK_TRUE,
-                    UINT64_MAX);
-
-    uint32_t image_index;
-    VkResult result =
-        vkAcquireNextImageKHR(logical_device_,
-                              swap_chain_,
-                              UINT64_MAX,
-                              image_available_semaphores_[current_frame_],
-                              VK_NULL_HANDLE,
-                              std::addressof(image_index));
-    if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
-        recreate_swap_chain_();
-        return;
+        profiler::scope wait{profiler_, "frame wait"};
+        vkWaitForFences(logical_device_,
+                        1,
+                        std::addressof(in_flight_fences_[current_frame_]),
+                        VK_TRUE,
+                        UINT64_MAX);
+    }
+    if (gpu_timer_)
+    {
+        gpu_timer_->collect(current_frame_, *profiler_);
+    }
+    frame_ring_->begin_frame(current_frame_);
+    if (bindless_)
+    {
+        bindless_->next_frame(frames_.frames_in_flight);
     }
-    else if (result != VK_SUCCESS and result != VK_SUBOPTIMAL_KHR)
+
+    // offscreen targets form a ring indexed by frame, so the fence above
+    // already guarantees the image is no longer in use
+    uint32_t image_index = current_frame_;
+    if (not headless_())
     {
-        throw std::runtime_error{"failed to acquire swap chain image!"};
+        profiler::scope acquire{profiler_, "acquire"};
+        auto result = vkAcquireNextImageKHR(
+            logical_device_,
+            swap_chain_,
+            UINT64_MAX,
+            image_available_semaphores_[current_frame_],
+            VK_NULL_HANDLE,
+            std::addressof(image_index));
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            recreate_swap_chain_();
+            return std::nullopt;
+        }
+        else if (result != VK_SUCCESS and result != VK_SUBOPTIMAL_KHR)
+        {
+            throw std::runtime_error{"failed to acquire swap chain image!"};
+        }
     }
     vkResetFences(
         logical_device_, 1, std::addressof(in_flight_fences_[current_frame_]));
+    return image_index;
+}
+
+void instance::submit_frame_(uint32_t image_index,
+                             const std::optional<surface_dispatch>& dispatch)
+{
+    uniform_buffer_object ubo;
+    {
+        profiler::scope update{profiler_, "uniform update"};
+        ubo = update_uniform_buffer_();
+        update_patches_(ubo);
+    }
+    {
+        profiler::scope cull{profiler_, "scene cull"};
+        cull_scene_(ubo);
+    }
+    if (overlay_)
+    {
+        profiler::scope overlay{profiler_, "overlay"};
+        overlay_->prepare(*frame_ring_);
+    }
+    {
+        profiler::scope record{profiler_, "record"};
+        vkResetCommandBuffer(command_buffers_[current_frame_], 0);
+        record_command_buffer_(
+            command_buffers_[current_frame_], image_index, dispatch);
+    }
+    frame_ring_->flush();
+
+    uint64_t upload_value = 0;
+    {
+        profiler::scope upload{profiler_, "upload"};
+        upload_value = uploader_->flush();
+    }
 
-    vkResetCommandBuffer(command_buffers_[current_frame_], 0);
-    record_command_buffer_(command_buffers_[current_frame_], image_index);
+    // the frame waits for pending uploads on the GPU, never on the host,
+    // the scene cull already reads uploaded bounds ahead of vertex input
+    std::vector<VkSemaphore> wait_semaphores      = {uploader_->semaphore()};
+    std::vector<VkPipelineStageFlags> wait_stages = {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT};
+    std::vector<uint64_t> wait_values             = {upload_value};
+    if (dispatch and async_compute_())
+    {
+        wait_semaphores.push_back(compute_timeline_);
+        wait_stages.push_back(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+        wait_values.push_back(compute_value_);
+    }
+    if (not headless_())
+    {
+        wait_semaphores.push_back(image_available_semaphores_[current_frame_]);
+        wait_stages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        wait_values.push_back(0);
+    }
 
-    update_uniform_buffer_(current_frame_);
+    VkTimelineSemaphoreSubmitInfo timeline_info{};
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.waitSemaphoreValueCount = to<uint32_t>(wait_values.size());
+    timeline_info.pWaitSemaphoreValues    = wait_values.data();
 
     VkSubmitInfo submit_info{};
-    submit_info.sType          = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    std::array wait_semaphores = {image_available_semaphores_[current_frame_]};
-    std::array<VkPipelineStageFlags, 1> wait_stages = {
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submit_info.waitSemaphoreCount = 1;
+    submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext              = std::addressof(timeline_info);
+    submit_info.waitSemaphoreCount = to<uint32_t>(wait_semaphores.size());
     submit_info.pWaitSemaphores    = wait_semaphores.data();
     submit_info.pWaitDstStageMask  = wait_stages.data();
+
+    std::array signal_semaphores = {
+        render_finished_semaphores_[current_frame_]};
+    if (not headless_())
+    {
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores    = signal_semaphores.data();
+    }
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers =
         std::addressof(command_buffers_[current_frame_]);
 
-    std::array signal_semaphores = {
-        render_finished_semaphores_[current_frame_]};
-    submit_info.signalSemaphoreCount = 1;
-    submit_info.pSignalSemaphores    = signal_semaphores.data();
+    if (gpu_timer_)
+    {
+        gpu_timer_->submitted(
+            current_frame_, profiler_->get().now(), profiler_->get().frame());
+    }
+    {
+        profiler::scope submit{profiler_, "submit"};
+        if (vkQueueSubmit(graphics_queue_,
+                          1,
+                          std::addressof(submit_info),
+                          in_flight_fences_[current_frame_]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+    }
 
-    if (vkQueueSubmit(graphics_queue_,
-                      1,
-                      std::addressof(submit_info),
-                      in_flight_fences_[current_frame_]) != VK_SUCCESS)
+    if (headless_())
     {
-        throw std::runtime_error("failed to submit draw command buffer!");
+        current_frame_ = (current_frame_ + 1) % frames_.frames_in_flight;
+        return;
     }
 
     VkPresentInfoKHR present_info{};
@@ -373,7 +518,12 @@ void instance::draw_frame()
     present_info.swapchainCount = 1;
     present_info.pSwapchains    = swap_chains.data();
     present_info.pImageIndices  = std::addressof(image_index);
-    result = vkQueuePresentKHR(present_queue_, std::addressof(present_info));
+    VkResult result;
+    {
+        profiler::scope present{profiler_, "present"};
+        result =
+            vkQueuePresentKHR(present_queue_, std::addressof(present_info));
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR or result == VK_SUBOPTIMAL_KHR or
         framebuffer_resized)
@@ -386,7 +536,58 @@ void instance::draw_frame()
         throw std::runtime_error{"failed to present swap chain image!"};
     }
 
-    current_frame_ = (current_frame_ + 1) % max_frames_in_flight;
+    current_frame_ = (current_frame_ + 1) % frames_.frames_in_flight;
+}
+
+void instance::draw_frame(const surface_writer& write_surface)
+{
+    auto image_index = begin_frame_();
+    if (not image_index)
+    {
+        return;
+    }
+
+    {
+        profiler::scope write{profiler_, "surface write"};
+        write_surface(std::span{
+            reinterpret_cast<vertex*>(
+                surface_vertex_allocations_[current_frame_].mapped),
+            size_t{surface_resolution_} * surface_resolution_});
+    }
+    submit_frame_(*image_index, std::nullopt);
+}
+
+void instance::draw_frame(gerstner::wave_field& field, float time)
+{
+    if (not compute_surface_)
+    {
+        throw std::runtime_error{"compute surface is not enabled!"};
+    }
+    if (field.resolution() != surface_resolution_)
+    {
+        throw std::runtime_error{"wave field resolution mismatch!"};
+    }
+
+    auto image_index = begin_frame_();
+    if (not image_index)
+    {
+        return;
+    }
+
+    std::span constants{reinterpret_cast<gerstner::wave_constants*>(
+                            wave_allocations_[current_frame_].mapped),
+                        max_surface_waves_};
+    surface_dispatch dispatch{
+        .resolution = surface_resolution_,
+        .wave_count = field.write_constants(time, constants),
+        .cell_size  = field.patch_size() / surface_resolution_,
+        .origin     = -0.5f * field.patch_size(),
+    };
+    if (async_compute_())
+    {
+        submit_surface_dispatch_(dispatch);
+    }
+    submit_frame_(*image_index, dispatch);
 }
 
 void instance::wait_device_idle()
@@ -398,37 +599,29 @@ instance::~instance()
 {
     cleanup_swap_chain_();
 
-    std::ranges::for_each(
-        std::views::zip(uniform_buffers_, uniform_buffers_memory_),
-        [this](auto&& uniform) {
-            const auto& [buffer, memory] = uniform;
-            vkDestroyBuffer(logical_device_, buffer, nullptr);
-            vkFreeMemory(logical_device_, memory, nullptr);
-        });
-    vkDestroyDescriptorPool(logical_device_, descriptor_pool_, nullptr);
+    if (compute_surface_)
+    {
+        destroy_compute_surface_();
+    }
+
+    destroy_frame_resources_();
+    overlay_.reset();
     vkDestroyDescriptorSetLayout(
         logical_device_, descriptor_set_layout_, nullptr);
-    vkDestroyBuffer(logical_device_, index_buffer_, nullptr);
-    vkFreeMemory(logical_device_, index_buffer_memory_, nullptr);
-    vkDestroyBuffer(logical_device_, vertex_buffer_, nullptr);
-    vkFreeMemory(logical_device_, vertex_buffer_memory_, nullptr);
+    destroy_buffer_(index_buffer_, index_buffer_allocation_);
+    destroy_buffer_(patch_vertex_buffer_, patch_vertex_allocation_);
 
-    vkDestroyPipeline(logical_device_, graphics_pipeline_, nullptr);
+    destroy_scene_();
+    pipelines_.reset();
     vkDestroyPipelineLayout(logical_device_, pipeline_layout_, nullptr);
     vkDestroyRenderPass(logical_device_, render_pass_, nullptr);
 
-    std::ranges::for_each(render_finished_semaphores_, [this](auto semaphore) {
-        vkDestroySemaphore(logical_device_, semaphore, nullptr);
-    });
-    std::ranges::for_each(image_available_semaphores_, [this](auto semaphore) {
-        vkDestroySemaphore(logical_device_, semaphore, nullptr);
-    });
-    std::ranges::for_each(in_flight_fences_, [this](auto fence) {
-        vkDestroyFence(logical_device_, fence, nullptr);
-    });
-
     vkDestroyCommandPool(logical_device_, command_pool_, nullptr);
 
+    uploader_.reset();
+    pipeline_cache_.reset();
+    bindless_.reset();
+    allocator_.reset();
     vkDestroyDevice(logical_device_, nullptr);
 
     if (validation_layers_enabled)
@@ -460,20 +653,56 @@ queue_family_indices instance::find_queue_families_(VkPhysicalDevice device)
         }
 
         VkBool32 present_support = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(
-            device, i, surface_, std::addressof(present_support));
+        if (not headless_())
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(
+                device, i, surface_, std::addressof(present_support));
+        }
         if (present_support)
         {
             indices.present_family = i;
         }
 
-        if (indices.is_complete())
+        if (indices.is_complete(not headless_()))
         {
             break;
         }
         ++i;
     }
 
+    constexpr VkQueueFlags non_transfer_flags =
+        VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+    for (uint32_t family = 0; family < queue_families.size(); ++family)
+    {
+        const auto& flags = queue_families[family].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) and
+            not(flags & non_transfer_flags))
+        {
+            indices.transfer_family = family;
+            break;
+        }
+    }
+    if (not indices.transfer_family)
+    {
+        indices.transfer_family = indices.graphics_family;
+    }
+
+    // a compute only family runs alongside graphics instead of inside it
+    for (uint32_t family = 0; family < queue_families.size(); ++family)
+    {
+        const auto& flags = queue_families[family].queueFlags;
+        if ((flags & VK_QUEUE_COMPUTE_BIT) and
+            not(flags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            indices.compute_family = family;
+            break;
+        }
+    }
+    if (not indices.compute_family)
+    {
+        indices.compute_family = indices.graphics_family;
+    }
+
     return indices;
 }
 
@@ -482,6 +711,11 @@ bool instance::is_physical_device_suitable_(VkPhysicalDevice device)
     auto qf_indices           = find_queue_families_(device);
     auto extensions_supported = check_device_extension_support_(device);
 
+    if (headless_())
+    {
+        return qf_indices.is_complete(false) and extensions_supported;
+    }
+
     bool swap_chain_adequate = false;
     if (extensions_supported)
     {
@@ -508,15 +742,29 @@ VkSurfaceFormatKHR choose_swap_surface_format(
 }
 
 VkPresentModeKHR choose_swap_present_mode(
-    const std::vector<VkPresentModeKHR>& available_present_modes)
+    const std::vector<VkPresentModeKHR>& available_present_modes,
+    present_mode preferred)
 {
-    for (const auto& mode : available_present_modes)
+    auto mode = VK_PRESENT_MODE_FIFO_KHR;
+    switch (preferred)
     {
-        if (mode == VK_PRESENT_MODE_MAILBOX_KHR)
-        {
-            return mode;
-        }
+    case present_mode::fifo:
+        return mode;
+    case present_mode::mailbox:
+        mode = VK_PRESENT_MODE_MAILBOX_KHR;
+        break;
+    case present_mode::immediate:
+        mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        break;
+    }
+    if (std::ranges::find(available_present_modes, mode) !=
+        std::end(available_present_modes))
+    {
+        return mode;
     }
+    // fifo is the one mode every surface supports
+    wf::log(fmt::format("{} present mode unsupported, falling back to fifo",
+                        magic_enum::enum_name(preferred)));
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -532,7 +780,7 @@ VkExtent2D instance::choose_swap_extent_(
     {
         int width, height;
         glfwGetFramebufferSize(
-            window_.get(), std::addressof(width), std::addressof(height));
+            window_->get(), std::addressof(width), std::addressof(height));
         VkExtent2D actual_extent = {
             static_cast<uint32_t>(width),
             static_cast<uint32_t>(height),
@@ -564,6 +812,7 @@ bool instance::check_device_extension_support_(VkPhysicalDevice device)
 {
     auto available_extensions = get_available_device_extensions(device);
 
+    auto device_extensions = required_device_extensions_();
     std::set<std::string> required_extensions(std::begin(device_extensions),
                                               std::end(device_extensions));
 
@@ -580,15 +829,19 @@ void instance::create_swap_chain_()
 
     auto surface_format =
         choose_swap_surface_format(swap_chain_support.formats);
-    auto present_mode =
-        choose_swap_present_mode(swap_chain_support.present_modes);
+    auto present_mode = choose_swap_present_mode(
+        swap_chain_support.present_modes, frames_.present);
     auto extent = choose_swap_extent_(swap_chain_support.capabilities);
 
-    uint32_t image_count = swap_chain_support.capabilities.minImageCount + 1;
-    if (swap_chain_support.capabilities.maxImageCount > 0 and
-        image_count > swap_chain_support.capabilities.maxImageCount)
+    const auto& capabilities = swap_chain_support.capabilities;
+    uint32_t image_count     = frames_.swap_chain_images == 0
+                                   ? capabilities.minImageCount + 1
+                                   : std::max(frames_.swap_chain_images,
+                                              capabilities.minImageCount);
+    if (capabilities.maxImageCount > 0 and
+        image_count > capabilities.maxImageCount)
     {
-        image_count = swap_chain_support.capabilities.maxImageCount;
+        image_count = capabilities.maxImageCount;
     }
 
     VkSwapchainCreateInfoKHR create_info{
@@ -673,158 +926,27 @@ void instance::create_image_views_()
     }
 }
 
-struct vk_shader_module
-{
-    VkShaderModule module;
-    VkDevice device;
-    vk_shader_module(VkDevice device, const std::vector<std::byte>& code)
-        : device{device}
-    {
-        VkShaderModuleCreateInfo create_info{};
-        create_info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        create_info.codeSize = code.size();
-        create_info.pCode    = reinterpret_cast<const uint32_t*>(code.data());
-
-        if (vkCreateShaderModule(device,
-                                 std::addressof(create_info),
-                                 nullptr,
-                                 std::addressof(module)) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create shader module!");
-        }
-    }
-
-    ~vk_shader_module()
-    {
-        vkDestroyShaderModule(device, module, nullptr);
-    }
-};
+// constant_id of morphEnabled in shader.vert
+constexpr uint32_t morph_constant_id = 0;
 
 void instance::create_grahpics_pipeline_()
 {
-    vk_shader_module vert_shader_module(
-        logical_device_, load_binary_from_file("../shaders/shader.vert.spv"));
-    vk_shader_module frag_shader_module(
-        logical_device_, load_binary_from_file("../shaders/shader.frag.spv"));
-
-    VkPipelineShaderStageCreateInfo vert_shader_stage_info{};
-    vert_shader_stage_info.sType =
-        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vert_shader_stage_info.stage  = VK_SHADER_STAGE_VERTEX_BIT;
-    vert_shader_stage_info.module = vert_shader_module.module;
-    vert_shader_stage_info.pName  = "main";
-
-    VkPipelineShaderStageCreateInfo frag_shader_stage_info{};
-    frag_shader_stage_info.sType =
-        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    frag_shader_stage_info.stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
-    frag_shader_stage_info.module = frag_shader_module.module;
-    frag_shader_stage_info.pName  = "main";
-
-    std::array shader_stages = {vert_shader_stage_info, frag_shader_stage_info};
-
-    std::array dynamic_states = {VK_DYNAMIC_STATE_VIEWPORT,
-                                 VK_DYNAMIC_STATE_SCISSOR};
-
-    VkPipelineDynamicStateCreateInfo dynamic_state{};
-    dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamic_state.dynamicStateCount = to<uint32_t>(dynamic_states.size());
-    dynamic_state.pDynamicStates    = dynamic_states.data();
-
-    VkPipelineVertexInputStateCreateInfo vertex_input_info{};
-    vertex_input_info.sType =
-        VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-    auto binding_description    = vertex::get_binding_description();
-    auto attribute_descriptions = vertex::get_attribute_descriptions();
-    vertex_input_info.vertexBindingDescriptionCount = 1;
-    vertex_input_info.vertexAttributeDescriptionCount =
-        wf::to<uint32_t>(attribute_descriptions.size());
-    vertex_input_info.pVertexBindingDescriptions =
-        std::addressof(binding_description);
-    vertex_input_info.pVertexAttributeDescriptions =
-        attribute_descriptions.data();
-
-    VkPipelineInputAssemblyStateCreateInfo input_assembly{};
-    input_assembly.sType =
-        VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    input_assembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    input_assembly.primitiveRestartEnable = VK_FALSE;
-
-    VkViewport viewport{};
-    viewport.x        = 0.f;
-    viewport.y        = 0.f;
-    viewport.width    = static_cast<float>(swap_chain_extent_.width);
-    viewport.height   = static_cast<float>(swap_chain_extent_.height);
-    viewport.minDepth = 0.f;
-    viewport.maxDepth = 1.f;
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = swap_chain_extent_;
-
-    VkPipelineViewportStateCreateInfo viewport_state{};
-    viewport_state.sType =
-        VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewport_state.viewportCount = 1;
-    viewport_state.pViewports    = std::addressof(viewport);
-    viewport_state.scissorCount  = 1;
-    viewport_state.pScissors     = std::addressof(scissor);
-
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType =
-        VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable        = VK_FALSE;
-    rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth               = 1.f;
-    rasterizer.cullMode                = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizer.depthBiasEnable         = VK_FALSE;
-    rasterizer.depthBiasConstantFactor = 0.f;
-    rasterizer.depthBiasClamp          = 0.f;
-    rasterizer.depthBiasSlopeFactor    = 0.f;
-
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType =
-        VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable   = VK_FALSE;
-    multisampling.rasterizationSamples  = VK_SAMPLE_COUNT_1_BIT;
-    multisampling.minSampleShading      = 1.0;
-    multisampling.pSampleMask           = nullptr;
-    multisampling.alphaToCoverageEnable = VK_FALSE;
-    multisampling.alphaToOneEnable      = VK_FALSE;
-
-    VkPipelineColorBlendAttachmentState color_blend_attachment{};
-    color_blend_attachment.colorWriteMask =
-        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-
-    color_blend_attachment.blendEnable         = VK_FALSE;
-    color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-    color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-    color_blend_attachment.colorBlendOp        = VK_BLEND_OP_ADD;
-    color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    color_blend_attachment.alphaBlendOp        = VK_BLEND_OP_ADD;
-
-    VkPipelineColorBlendStateCreateInfo color_blending{};
-    color_blending.sType =
-        VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    color_blending.logicOpEnable     = VK_FALSE;
-    color_blending.logicOp           = VK_LOGIC_OP_COPY;
-    color_blending.attachmentCount   = 1;
-    color_blending.pAttachments      = std::addressof(color_blend_attachment);
-    color_blending.blendConstants[0] = 0.f;
-    color_blending.blendConstants[1] = 0.f;
-    color_blending.blendConstants[2] = 0.f;
-    color_blending.blendConstants[3] = 0.f;
+    // set 1 and the push constants only exist with the bindless heap
+    std::array set_layouts = {descriptor_set_layout_,
+                              bindless_ ? bindless_->layout()
+                                        : VK_NULL_HANDLE};
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push_constant_range.offset     = 0;
+    push_constant_range.size       = sizeof(draw_resources);
 
     VkPipelineLayoutCreateInfo pipeline_layout_info{};
     pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeline_layout_info.setLayoutCount = 1;
-    pipeline_layout_info.pSetLayouts = std::addressof(descriptor_set_layout_);
-    pipeline_layout_info.pushConstantRangeCount = 0;
-    pipeline_layout_info.pPushConstantRanges    = nullptr;
+    pipeline_layout_info.setLayoutCount = bindless_ ? 2 : 1;
+    pipeline_layout_info.pSetLayouts    = set_layouts.data();
+    pipeline_layout_info.pushConstantRangeCount = bindless_ ? 1 : 0;
+    pipeline_layout_info.pPushConstantRanges =
+        std::addressof(push_constant_range);
 
     if (vkCreatePipelineLayout(logical_device_,
                                std::addressof(pipeline_layout_info),
@@ -834,38 +956,39 @@ void instance::create_grahpics_pipeline_()
         throw std::runtime_error("failed to create pipeline layout!");
     }
 
-    VkGraphicsPipelineCreateInfo pipeline_info{};
-    pipeline_info.sType      = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipeline_info.stageCount = 2;
-    pipeline_info.pStages    = shader_stages.data();
-    pipeline_info.pVertexInputState   = std::addressof(vertex_input_info);
-    pipeline_info.pInputAssemblyState = std::addressof(input_assembly);
-    pipeline_info.pViewportState      = std::addressof(viewport_state);
-    pipeline_info.pRasterizationState = std::addressof(rasterizer);
-    pipeline_info.pMultisampleState   = std::addressof(multisampling);
-    pipeline_info.pDepthStencilState  = nullptr;
-    pipeline_info.pColorBlendState    = std::addressof(color_blending);
-    pipeline_info.pDynamicState       = std::addressof(dynamic_state);
-    pipeline_info.layout              = pipeline_layout_;
-    pipeline_info.renderPass          = render_pass_;
-    pipeline_info.subpass             = 0;
-    pipeline_info.basePipelineHandle  = VK_NULL_HANDLE;
-    pipeline_info.basePipelineIndex   = -1;
-
-    if (vkCreateGraphicsPipelines(logical_device_,
-                                  VK_NULL_HANDLE,
-                                  1,
-                                  std::addressof(pipeline_info),
-                                  nullptr,
-                                  std::addressof(graphics_pipeline_)) !=
-        VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create graphics pipeline!");
-    }
+    pipelines_.emplace(
+        logical_device_, *pipeline_cache_, pipeline_layout_, render_pass_);
+
+    pipeline_description surface{
+        .vertex_shader   = bindless_ ? "../shaders/shader_bindless.vert.spv"
+                                     : "../shaders/shader.vert.spv",
+        .fragment_shader = "../shaders/shader.frag.spv",
+        .vertex          = patch_format::layout(),
+        // nodes only morph when the range leaves room before its end
+        .constants   = {{morph_constant_id,
+                         lod_.parameters().morph_start < 1.f}},
+        .depth_test  = true,
+        .depth_write = true,
+    };
+    surface_pipeline_ = pipelines_->request(surface);
+
+    pipeline_description mesh{
+        .vertex_shader   = bindless_ ? "../shaders/mesh_bindless.vert.spv"
+                                     : "../shaders/mesh.vert.spv",
+        .fragment_shader = "../shaders/shader.frag.spv",
+        .vertex          = mesh_format::layout(),
+        .depth_test      = true,
+        .depth_write     = true,
+    };
+    mesh_pipeline_ = pipelines_->request(mesh);
+
+    pipelines_->compile(std::max(1u, std::thread::hardware_concurrency()));
 }
 
 void instance::create_render_pass_()
 {
+    depth_format_ = find_depth_format_();
+
     VkAttachmentDescription color_attachment{};
     color_attachment.format         = swap_chain_image_format_;
     color_attachment.samples        = VK_SAMPLE_COUNT_1_BIT;
@@ -874,29 +997,56 @@ void instance::create_render_pass_()
     color_attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     color_attachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    color_attachment.finalLayout    = headless_()
+                                          ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                          : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    // only needed within the frame, nothing reads it after the pass
+    VkAttachmentDescription depth_attachment{};
+    depth_attachment.format         = depth_format_;
+    depth_attachment.samples        = VK_SAMPLE_COUNT_1_BIT;
+    depth_attachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depth_attachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+    depth_attachment.finalLayout =
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference color_attachment_ref{};
     color_attachment_ref.attachment = 0;
     color_attachment_ref.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentReference depth_attachment_ref{};
+    depth_attachment_ref.attachment = 1;
+    depth_attachment_ref.layout =
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments    = std::addressof(color_attachment_ref);
+    subpass.pDepthStencilAttachment = std::addressof(depth_attachment_ref);
 
+    // the depth image is shared between frames in flight, so the clear of
+    // one frame waits for the depth writes of the one before
     VkSubpassDependency dependency{};
-    dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass    = 0;
-    dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-
+    dependency.srcSubpass   = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass   = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                              VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                              VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                               VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                               VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    std::array attachments = {color_attachment, depth_attachment};
     VkRenderPassCreateInfo render_pass_info{};
     render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_info.attachmentCount = 1;
-    render_pass_info.pAttachments    = std::addressof(color_attachment);
+    render_pass_info.attachmentCount = to<uint32_t>(attachments.size());
+    render_pass_info.pAttachments    = attachments.data();
     render_pass_info.subpassCount    = 1;
     render_pass_info.pSubpasses      = std::addressof(subpass);
     render_pass_info.dependencyCount = 1;
@@ -911,17 +1061,21 @@ void instance::create_render_pass_()
     }
 }
 
+// the depth target follows the swap chain extent, so it is created along
+// with the framebuffers and destroyed with the swap chain
 void instance::create_framebuffers_()
 {
+    create_depth_target_();
     swap_chain_framebuffers_.resize(swap_chain_image_views_.size());
     for (size_t i = 0; i < swap_chain_image_views_.size(); i++)
     {
-        std::array attachments = {swap_chain_image_views_[i]};
+        std::array attachments = {swap_chain_image_views_[i],
+                                  depth_image_view_};
 
         VkFramebufferCreateInfo framebuffer_info{};
         framebuffer_info.sType      = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebuffer_info.renderPass = render_pass_;
-        framebuffer_info.attachmentCount = 1;
+        framebuffer_info.attachmentCount = to<uint32_t>(attachments.size());
         framebuffer_info.pAttachments    = attachments.data();
         framebuffer_info.width           = swap_chain_extent_.width;
         framebuffer_info.height          = swap_chain_extent_.height;
@@ -959,7 +1113,7 @@ void instance::create_command_pool_()
 
 void instance::create_command_buffers_()
 {
-    command_buffers_.resize(max_frames_in_flight);
+    command_buffers_.resize(frames_.frames_in_flight);
     VkCommandBufferAllocateInfo alloc_info{};
     alloc_info.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     alloc_info.commandPool = command_pool_;
@@ -974,8 +1128,10 @@ void instance::create_command_buffers_()
     }
 }
 
-void instance::record_command_buffer_(VkCommandBuffer command_buffer,
-                                      uint32_t image_index)
+void instance::record_command_buffer_(
+    VkCommandBuffer command_buffer,
+    uint32_t image_index,
+    const std::optional<surface_dispatch>& dispatch)
 {
     VkCommandBufferBeginInfo begin_info{};
     begin_info.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -988,30 +1144,116 @@ void instance::record_command_buffer_(VkCommandBuffer command_buffer,
         throw std::runtime_error("failed to begin recording command buffer!");
     }
 
+    if (dispatch and async_compute_())
+    {
+        // acquire half of the ownership transfer released by the compute queue
+        VkBufferMemoryBarrier acquire{};
+        acquire.sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        acquire.srcAccessMask = 0;
+        acquire.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        acquire.srcQueueFamilyIndex = queue_families_.compute_family.value();
+        acquire.dstQueueFamilyIndex = queue_families_.graphics_family.value();
+        acquire.buffer              = compute_surface_buffers_[current_frame_];
+        acquire.offset              = 0;
+        acquire.size                = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(command_buffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             1,
+                             std::addressof(acquire),
+                             0,
+                             nullptr);
+    }
+    else if (dispatch)
+    {
+        record_surface_dispatch_(command_buffer, *dispatch);
+    }
+
+    if (culler_)
+    {
+        auto cull_zone = begin_gpu_zone_(command_buffer, "scene cull");
+        culler_->record(command_buffer, current_frame_, scene_view_);
+        end_gpu_zone_(command_buffer, cull_zone);
+    }
+    if (overlay_)
+    {
+        overlay_->record_upload(command_buffer, frame_ring_->buffer());
+    }
+
     VkRenderPassBeginInfo render_pass_info{};
     render_pass_info.sType       = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     render_pass_info.renderPass  = render_pass_;
     render_pass_info.framebuffer = swap_chain_framebuffers_[image_index];
     render_pass_info.renderArea.offset = {0, 0};
     render_pass_info.renderArea.extent = swap_chain_extent_;
-    VkClearValue clear_color           = {0.f, 0.f, 0.f, 1.f};
+    std::array<VkClearValue, 2> clear_values{};
+    clear_values[0].color        = {{0.f, 0.f, 0.f, 1.f}};
+    clear_values[1].depthStencil = {1.f, 0};
+
+    render_pass_info.clearValueCount = to<uint32_t>(clear_values.size());
+    render_pass_info.pClearValues    = clear_values.data();
+    auto render_zone = begin_gpu_zone_(command_buffer, "render pass");
+    auto partitions  = recording_partitions_();
+    if (partitions == 1)
+    {
+        vkCmdBeginRenderPass(command_buffer,
+                             std::addressof(render_pass_info),
+                             VK_SUBPASS_CONTENTS_INLINE);
+        record_partition_(command_buffer, 0, 1);
+    }
+    else
+    {
+        vkCmdBeginRenderPass(command_buffer,
+                             std::addressof(render_pass_info),
+                             VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        VkCommandBufferInheritanceInfo inheritance{};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass  = render_pass_;
+        inheritance.subpass     = 0;
+        inheritance.framebuffer = swap_chain_framebuffers_[image_index];
+        auto secondaries        = recorder_->record(
+            current_frame_,
+            inheritance,
+            partitions,
+            [&](VkCommandBuffer secondary, uint32_t partition) {
+                profiler::scope zone{profiler_, "record partition"};
+                record_partition_(secondary, partition, partitions);
+            });
+        vkCmdExecuteCommands(command_buffer,
+                             to<uint32_t>(secondaries.size()),
+                             secondaries.data());
+    }
+    vkCmdEndRenderPass(command_buffer);
+    end_gpu_zone_(command_buffer, render_zone);
 
-    render_pass_info.clearValueCount = 1;
-    render_pass_info.pClearValues    = std::addressof(clear_color);
-    vkCmdBeginRenderPass(command_buffer,
-                         std::addressof(render_pass_info),
-                         VK_SUBPASS_CONTENTS_INLINE);
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
 
-    vkCmdBindPipeline(
-        command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_);
+// a secondary thread only pays off for a few hundred draws
+constexpr uint32_t draws_per_recording_thread = 256;
 
-    std::array vertex_buffers           = {vertex_buffer_};
-    std::array<VkDeviceSize, 1> offsets = {0};
-    vkCmdBindVertexBuffers(
-        command_buffer, 0, 1, vertex_buffers.data(), offsets.data());
-    vkCmdBindIndexBuffer(
-        command_buffer, index_buffer_, 0, VK_INDEX_TYPE_UINT16);
+uint32_t instance::recording_partitions_() const
+{
+    // an indirect submission is one call however many draws survive
+    auto draws = submission_ == scene_submission::direct
+                     ? scene_draw_count_ + 1
+                     : 1;
+    return std::clamp(
+        draws / draws_per_recording_thread, 1u, recorder_->workers());
+}
 
+// state is not inherited by secondaries, so every partition binds its own,
+// the first one draws the ocean ahead of its share of the scene batches
+void instance::record_partition_(VkCommandBuffer command_buffer,
+                                 uint32_t partition,
+                                 uint32_t partitions)
+{
     VkViewport viewport{};
     viewport.x        = 0.f;
     viewport.y        = 0.f;
@@ -1026,30 +1268,66 @@ void instance::record_command_buffer_(VkCommandBuffer command_buffer,
     scissor.extent = swap_chain_extent_;
     vkCmdSetScissor(command_buffer, 0, 1, std::addressof(scissor));
 
+    auto uniform_offset = to<uint32_t>(uniform_offset_);
+    std::array descriptor_sets = {
+        frame_descriptor_set_(),
+        bindless_ ? bindless_->set() : VK_NULL_HANDLE};
     vkCmdBindDescriptorSets(command_buffer,
                             VK_PIPELINE_BIND_POINT_GRAPHICS,
                             pipeline_layout_,
                             0,
+                            bindless_ ? 2 : 1,
+                            descriptor_sets.data(),
                             1,
-                            std::addressof(descriptor_sets_[current_frame_]),
-                            0,
-                            nullptr);
-    vkCmdDrawIndexed(
-        command_buffer, wf::to<uint32_t>(indices.size()), 1, 0, 0, 0);
+                            std::addressof(uniform_offset));
+    if (bindless_)
+    {
+        draw_resources resources{
+            .surface    = surface_slots_[current_frame_],
+            .transforms = instance_transform_slot_,
+        };
+        vkCmdPushConstants(command_buffer,
+                           pipeline_layout_,
+                           VK_SHADER_STAGE_VERTEX_BIT,
+                           0,
+                           sizeof(resources),
+                           std::addressof(resources));
+    }
 
-    vkCmdEndRenderPass(command_buffer);
+    if (partition == 0)
+    {
+        vkCmdBindPipeline(command_buffer,
+                          VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipelines_->get(surface_pipeline_));
+        std::array vertex_buffers = {patch_vertex_buffer_,
+                                     frame_ring_->buffer()};
+        std::array<VkDeviceSize, 2> offsets = {0, patch_instance_offset_};
+        vkCmdBindVertexBuffers(command_buffer,
+                               0,
+                               to<uint32_t>(vertex_buffers.size()),
+                               vertex_buffers.data(),
+                               offsets.data());
+        vkCmdBindIndexBuffer(
+            command_buffer, index_buffer_, 0, VK_INDEX_TYPE_UINT16);
+        vkCmdDrawIndexed(
+            command_buffer, patch_index_count_, patch_count_, 0, 0, 0);
+    }
 
-    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+    record_scene_(command_buffer, partition, partitions);
+
+    // secondaries execute in partition order, so the last one draws on top
+    if (overlay_ and partition + 1 == partitions)
     {
-        throw std::runtime_error("failed to record command buffer!");
+        overlay_->record_draw(
+            command_buffer, frame_ring_->buffer(), swap_chain_extent_);
     }
 }
 
 void instance::create_sync_objects_()
 {
-    image_available_semaphores_.resize(max_frames_in_flight);
-    render_finished_semaphores_.resize(max_frames_in_flight);
-    in_flight_fences_.resize(max_frames_in_flight);
+    image_available_semaphores_.resize(frames_.frames_in_flight);
+    render_finished_semaphores_.resize(frames_.frames_in_flight);
+    in_flight_fences_.resize(frames_.frames_in_flight);
 
     VkSemaphoreCreateInfo semaphore_info{};
     semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1085,47 +1363,1165 @@ void instance::create_sync_objects_()
     }
 }
 
-void instance::recreate_swap_chain_()
+// every resource indexed by current_frame_, sized by the frames in flight
+void instance::create_frame_resources_()
 {
-    int width = 0, height = 0;
-    glfwGetFramebufferSize(
-        window_.get(), std::addressof(width), std::addressof(height));
-    while (width = 0 || height == 0)
+    create_surface_vertex_buffers_();
+    create_frame_ring_();
+    create_descriptor_pool_();
+    create_descriptor_sets_();
+    create_command_buffers_();
+    create_sync_objects_();
+    recorder_.emplace(logical_device_,
+                      queue_families_.graphics_family.value(),
+                      frames_.frames_in_flight,
+                      record_threads_);
+    write_scene_descriptors_();
+    create_culler_();
+    if (compute_surface_)
     {
-        glfwGetFramebufferSize(
-            window_.get(), std::addressof(width), std::addressof(height));
-        glfwWaitEvents();
+        create_compute_frames_();
     }
-    vkDeviceWaitIdle(logical_device_);
-
-    cleanup_swap_chain_();
-
-    create_swap_chain_();
-    create_image_views_();
-    create_framebuffers_();
+    create_gpu_timer_();
 }
 
-void instance::cleanup_swap_chain_()
+void instance::destroy_frame_resources_()
 {
-    std::ranges::for_each(swap_chain_framebuffers_, [this](auto framebuffer) {
-        vkDestroyFramebuffer(logical_device_, framebuffer, nullptr);
+    gpu_timer_.reset();
+    culler_.reset();
+    recorder_.reset();
+    if (compute_surface_)
+    {
+        destroy_compute_frames_();
+    }
+    frame_ring_.reset();
+    vkDestroyDescriptorPool(logical_device_, descriptor_pool_, nullptr);
+    if (bindless_)
+    {
+        std::ranges::for_each(surface_slots_, [this](auto slot) {
+            bindless_->remove_buffer(slot);
+        });
+        surface_slots_.clear();
+    }
+    std::ranges::for_each(
+        std::views::zip(surface_vertex_buffers_, surface_vertex_allocations_),
+        [this](auto&& surface) {
+            const auto& [buffer, allocation] = surface;
+            destroy_buffer_(buffer, allocation);
+        });
+    vkFreeCommandBuffers(logical_device_,
+                         command_pool_,
+                         to<uint32_t>(command_buffers_.size()),
+                         command_buffers_.data());
+
+    std::ranges::for_each(render_finished_semaphores_, [this](auto semaphore) {
+        vkDestroySemaphore(logical_device_, semaphore, nullptr);
     });
-    std::ranges::for_each(swap_chain_image_views_, [this](auto image_view) {
-        vkDestroyImageView(logical_device_, image_view, nullptr);
+    std::ranges::for_each(image_available_semaphores_, [this](auto semaphore) {
+        vkDestroySemaphore(logical_device_, semaphore, nullptr);
     });
-    vkDestroySwapchainKHR(logical_device_, swap_chain_, nullptr);
-}
+    std::ranges::for_each(in_flight_fences_, [this](auto fence) {
+        vkDestroyFence(logical_device_, fence, nullptr);
+    });
+}
+
+void instance::apply(const frame_settings& frames)
+{
+    auto settings = validated(frames);
+    if (settings == frames_)
+    {
+        return;
+    }
+
+    vkDeviceWaitIdle(logical_device_);
+    auto previous = std::exchange(frames_, settings);
+    if (previous.frames_in_flight != frames_.frames_in_flight)
+    {
+        destroy_frame_resources_();
+        current_frame_ = 0;
+        create_frame_resources_();
+        // offscreen targets form a ring indexed by frame
+        if (headless_())
+        {
+            cleanup_swap_chain_();
+            create_offscreen_targets_(swap_chain_extent_);
+            create_image_views_();
+            create_framebuffers_();
+        }
+    }
+
+    // a swap chain only depends on the present mode and image count
+    previous.frames_in_flight = frames_.frames_in_flight;
+    if (not headless_() and previous != frames_)
+    {
+        recreate_swap_chain_();
+    }
+    wf::log(fmt::format("frames: {} in flight, {} present, {} images",
+                        frames_.frames_in_flight,
+                        magic_enum::enum_name(frames_.present),
+                        swap_chain_images_.size()));
+}
+
+const frame_settings& instance::frames() const
+{
+    return frames_;
+}
+
+static uint32_t timestamp_valid_bits(VkPhysicalDevice device, uint32_t family)
+{
+    uint32_t family_count{};
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        device, std::addressof(family_count), nullptr);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        device, std::addressof(family_count), families.data());
+    return families[family].timestampValidBits;
+}
+
+void instance::create_gpu_timer_()
+{
+    compute_timestamps_ = false;
+    if (not profiler_)
+    {
+        return;
+    }
+    auto valid_bits = timestamp_valid_bits(
+        physical_device_, queue_families_.graphics_family.value());
+    if (valid_bits == 0)
+    {
+        wf::log("graphics queue has no timestamps, profiling cpu zones only");
+        return;
+    }
+    gpu_timer_.emplace(logical_device_,
+                       physical_device_,
+                       valid_bits,
+                       frames_.frames_in_flight);
+    compute_timestamps_ =
+        timestamp_valid_bits(physical_device_,
+                             queue_families_.compute_family.value()) > 0;
+}
+
+std::optional<uint32_t> instance::begin_gpu_zone_(
+    VkCommandBuffer command_buffer,
+    const char* name)
+{
+    if (not gpu_timer_)
+    {
+        return std::nullopt;
+    }
+    return gpu_timer_->begin(command_buffer, current_frame_, name);
+}
+
+void instance::end_gpu_zone_(VkCommandBuffer command_buffer,
+                             std::optional<uint32_t> zone)
+{
+    if (zone)
+    {
+        gpu_timer_->end(command_buffer, current_frame_, *zone);
+    }
+}
+
+void instance::attach_profiler(profiler::profiler& profiler)
+{
+    vkDeviceWaitIdle(logical_device_);
+    profiler_ = profiler;
+    create_gpu_timer_();
+}
+
+void instance::recreate_swap_chain_()
+{
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(
+        window_->get(), std::addressof(width), std::addressof(height));
+    while (width = 0 || height == 0)
+    {
+        glfwGetFramebufferSize(
+            window_->get(), std::addressof(width), std::addressof(height));
+        glfwWaitEvents();
+    }
+    vkDeviceWaitIdle(logical_device_);
+
+    cleanup_swap_chain_();
+
+    create_swap_chain_();
+    create_image_views_();
+    create_framebuffers_();
+}
+
+void instance::cleanup_swap_chain_()
+{
+    std::ranges::for_each(swap_chain_framebuffers_, [this](auto framebuffer) {
+        vkDestroyFramebuffer(logical_device_, framebuffer, nullptr);
+    });
+    std::ranges::for_each(swap_chain_image_views_, [this](auto image_view) {
+        vkDestroyImageView(logical_device_, image_view, nullptr);
+    });
+    vkDestroyImageView(logical_device_, depth_image_view_, nullptr);
+    vkDestroyImage(logical_device_, depth_image_, nullptr);
+    allocator_->free(depth_image_allocation_);
+    if (headless_())
+    {
+        std::ranges::for_each(
+            std::views::zip(swap_chain_images_, offscreen_image_allocations_),
+            [this](auto&& target) {
+                const auto& [image, image_allocation] = target;
+                vkDestroyImage(logical_device_, image, nullptr);
+                allocator_->free(image_allocation);
+            });
+        return;
+    }
+    vkDestroySwapchainKHR(logical_device_, swap_chain_, nullptr);
+}
+
+void instance::create_offscreen_targets_(VkExtent2D extent)
+{
+    swap_chain_image_format_ = VK_FORMAT_B8G8R8A8_SRGB;
+    swap_chain_extent_       = extent;
+    swap_chain_images_.resize(frames_.frames_in_flight);
+    offscreen_image_allocations_.resize(frames_.frames_in_flight);
+
+    for (auto&& [image, image_allocation] :
+         std::views::zip(swap_chain_images_, offscreen_image_allocations_))
+    {
+        VkImageCreateInfo image_info{};
+        image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType     = VK_IMAGE_TYPE_2D;
+        image_info.format        = swap_chain_image_format_;
+        image_info.extent        = {extent.width, extent.height, 1};
+        image_info.mipLevels     = 1;
+        image_info.arrayLayers   = 1;
+        image_info.samples       = VK_SAMPLE_COUNT_1_BIT;
+        image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage         = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                           VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(logical_device_,
+                          std::addressof(image_info),
+                          nullptr,
+                          std::addressof(image)) != VK_SUCCESS)
+        {
+            throw std::runtime_error{"failed to create offscreen image!"};
+        }
+
+        VkMemoryRequirements mem_requirements;
+        vkGetImageMemoryRequirements(
+            logical_device_, image, std::addressof(mem_requirements));
+        image_allocation = allocator_->allocate(
+            mem_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        vkBindImageMemory(logical_device_,
+                          image,
+                          image_allocation.memory,
+                          image_allocation.offset);
+    }
+}
+
+VkFormat instance::find_depth_format_()
+{
+    // the first one is required of every device except for the stencil bits
+    constexpr std::array candidates = {VK_FORMAT_D32_SFLOAT,
+                                       VK_FORMAT_D32_SFLOAT_S8_UINT,
+                                       VK_FORMAT_D24_UNORM_S8_UINT};
+    for (auto format : candidates)
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(
+            physical_device_, format, std::addressof(properties));
+        if (properties.optimalTilingFeatures &
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+        {
+            return format;
+        }
+    }
+    throw std::runtime_error{"failed to find a depth format!"};
+}
+
+void instance::create_depth_target_()
+{
+    VkImageCreateInfo image_info{};
+    image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType     = VK_IMAGE_TYPE_2D;
+    image_info.format        = depth_format_;
+    image_info.extent        = {swap_chain_extent_.width,
+                                swap_chain_extent_.height,
+                                1};
+    image_info.mipLevels     = 1;
+    image_info.arrayLayers   = 1;
+    image_info.samples       = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage         = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(logical_device_,
+                      std::addressof(image_info),
+                      nullptr,
+                      std::addressof(depth_image_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create depth image!"};
+    }
+
+    VkMemoryRequirements mem_requirements;
+    vkGetImageMemoryRequirements(
+        logical_device_, depth_image_, std::addressof(mem_requirements));
+    depth_image_allocation_ = allocator_->allocate(
+        mem_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    vkBindImageMemory(logical_device_,
+                      depth_image_,
+                      depth_image_allocation_.memory,
+                      depth_image_allocation_.offset);
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image    = depth_image_;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format   = depth_format_;
+    view_info.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT;
+    view_info.subresourceRange.baseMipLevel   = 0;
+    view_info.subresourceRange.levelCount     = 1;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount     = 1;
+    if (vkCreateImageView(logical_device_,
+                          std::addressof(view_info),
+                          nullptr,
+                          std::addressof(depth_image_view_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create depth image view!"};
+    }
+}
+
+void instance::create_patch_buffers_()
+{
+    // every selected node draws this same grid, scaled and offset per instance
+    auto quads  = lod_.parameters().patch_quads;
+    auto stride = quads + 1;
+    if (size_t{stride} * stride > std::numeric_limits<uint16_t>::max())
+    {
+        throw std::runtime_error{"lod patch does not fit 16 bit indices!"};
+    }
+
+    // fitting 16 bit indices keeps the lattice well within 8 bits
+    std::vector<patch_vertex> vertices;
+    vertices.reserve(size_t{stride} * stride);
+    for (uint32_t y = 0; y <= quads; ++y)
+    {
+        for (uint32_t x = 0; x <= quads; ++x)
+        {
+            vertices.push_back(
+                {{static_cast<uint8_t>(x), static_cast<uint8_t>(y)}});
+        }
+    }
+
+    std::vector<uint16_t> indices;
+    indices.reserve(size_t{quads} * quads * 6);
+    for (uint32_t y = 0; y < quads; ++y)
+    {
+        for (uint32_t x = 0; x < quads; ++x)
+        {
+            auto i = static_cast<uint16_t>(y * stride + x);
+            auto n = static_cast<uint16_t>(stride);
+            indices.insert(std::end(indices),
+                           {i,
+                            static_cast<uint16_t>(i + 1),
+                            static_cast<uint16_t>(i + n + 1),
+                            static_cast<uint16_t>(i + n + 1),
+                            static_cast<uint16_t>(i + n),
+                            i});
+        }
+    }
+    patch_index_count_ = to<uint32_t>(indices.size());
+
+    // transfer sources so compact_memory_ can move them between blocks
+    create_buffer_(sizeof(vertices[0]) * vertices.size(),
+                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                   patch_vertex_buffer_,
+                   patch_vertex_allocation_);
+    uploader_->enqueue(std::as_bytes(std::span{vertices}),
+                       patch_vertex_buffer_);
+
+    create_buffer_(sizeof(indices[0]) * indices.size(),
+                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                   index_buffer_,
+                   index_buffer_allocation_);
+    uploader_->enqueue(std::as_bytes(std::span{indices}), index_buffer_);
+}
+
+void instance::create_descriptor_set_layout_()
+{
+    VkDescriptorSetLayoutBinding ubo_layout_binding{};
+    ubo_layout_binding.binding = 0;
+    ubo_layout_binding.descriptorType =
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    ubo_layout_binding.descriptorCount    = 1;
+    ubo_layout_binding.stageFlags         = VK_SHADER_STAGE_VERTEX_BIT;
+    ubo_layout_binding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding surface_layout_binding{};
+    surface_layout_binding.binding         = 1;
+    surface_layout_binding.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    surface_layout_binding.descriptorCount = 1;
+    surface_layout_binding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutBinding instances_layout_binding{};
+    instances_layout_binding.binding        = 2;
+    instances_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    instances_layout_binding.descriptorCount = 1;
+    instances_layout_binding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+
+    // the heap takes over the storage buffers when it exists
+    std::array bindings = {
+        ubo_layout_binding, surface_layout_binding, instances_layout_binding};
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = bindless_ ? 1 : to<uint32_t>(bindings.size());
+    layout_info.pBindings    = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(logical_device_,
+                                    std::addressof(layout_info),
+                                    nullptr,
+                                    std::addressof(descriptor_set_layout_)) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+}
+
+// uniforms and lod patch instances of a frame, with room left for the
+// per draw data pushed while recording
+constexpr VkDeviceSize frame_ring_headroom = VkDeviceSize{256} << 10;
+
+void instance::create_frame_ring_()
+{
+    auto bytes_per_frame =
+        sizeof(uniform_buffer_object) +
+        sizeof(lod::patch_instance) * lod_.parameters().max_patches +
+        frame_ring_headroom;
+    // the cpu cull writes the visible instances and the commands here, the
+    // multi draw path reads those commands as its indirect buffer
+    if (submission_ != scene_submission::gpu_culled)
+    {
+        bytes_per_frame +=
+            sizeof(uint32_t) * scene_bounds_.size() +
+            sizeof(culling::draw_command) * scene_draws_.size();
+    }
+    // the overlay's instances and the atlas rows it copies from here
+    if (overlay_)
+    {
+        bytes_per_frame += overlay_->frame_bytes();
+    }
+    frame_ring_.emplace(physical_device_,
+                        logical_device_,
+                        *allocator_,
+                        bytes_per_frame,
+                        frames_.frames_in_flight,
+                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+}
+
+uniform_buffer_object instance::update_uniform_buffer_()
+{
+    float time = std::chrono::duration<float>(
+                     std::chrono::steady_clock::now() - start_time_)
+                     .count();
+
+    auto orbit = time * glm::radians(3.f);
+    glm::vec3 eye{180.f * std::cos(orbit), 180.f * std::sin(orbit), 60.f};
+    uniform_buffer_object ubo{};
+    ubo.model = glm::mat4(1.f);
+    ubo.view =
+        glm::lookAt(eye, glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, 0.f, 1.f));
+    // depth in [0, 1] as vulkan clips it, the depth buffer uses all of it
+    ubo.proj =
+        glm::perspectiveRH_ZO(glm::radians(45.f),
+                              swap_chain_extent_.width /
+                                  static_cast<float>(swap_chain_extent_.height),
+                              0.1f,
+                              20000.f);
+    ubo.proj[1][1] *= -1;
+    ubo.camera  = glm::vec4{eye, 1.f};
+    ubo.surface = {surface_patch_size_,
+                   static_cast<float>(surface_resolution_),
+                   static_cast<float>(lod_.parameters().patch_quads),
+                   0.f};
+    uniform_offset_ = frame_ring_->push(ubo).offset;
+    return ubo;
+}
+
+void instance::update_patches_(const uniform_buffer_object& ubo)
+{
+    auto patches = lod_.select(ubo.proj * ubo.view * ubo.model,
+                               glm::vec3{ubo.camera});
+    patch_instance_offset_ = frame_ring_->push(patches).offset;
+    patch_count_ = to<uint32_t>(patches.size());
+}
+
+pipeline_timings instance::pipeline_startup() const
+{
+    return {pipeline_creation_, pipeline_cache_->warm()};
+}
+
+void instance::set_record_threads(uint32_t threads)
+{
+    vkDeviceWaitIdle(logical_device_);
+    record_threads_ = std::max(threads, 1u);
+    recorder_.emplace(logical_device_,
+                      queue_families_.graphics_family.value(),
+                      frames_.frames_in_flight,
+                      record_threads_);
+}
+
+// scene instances are counted before culling
+uint32_t instance::drawn_triangles() const
+{
+    auto triangles = patch_count_ * lod_.triangles_per_patch();
+    for (const auto& draw : scene_draws_)
+    {
+        triangles += draw.index_count / 3 * draw.instance_count;
+    }
+    return triangles;
+}
+
+uint32_t instance::drawn_batches() const
+{
+    // the gpu culled count never comes back, every draw may survive
+    auto scene = submission_ == scene_submission::gpu_culled
+                     ? to<uint32_t>(scene_draws_.size())
+                     : scene_draw_count_;
+    return 1 + scene + (overlay_ ? 1 : 0);
+}
+
+void instance::enable_overlay(const std::filesystem::path& font,
+                              uint32_t pixel_size)
+{
+    vkDeviceWaitIdle(logical_device_);
+    // the frame ring is sized by the overlay
+    destroy_frame_resources_();
+    overlay_.reset();
+    auto pipelines_start = std::chrono::steady_clock::now();
+    overlay_.emplace(logical_device_,
+                     *allocator_,
+                     *pipeline_cache_,
+                     render_pass_,
+                     font,
+                     pixel_size);
+    pipeline_creation_ += std::chrono::steady_clock::now() - pipelines_start;
+    create_frame_resources_();
+}
+
+void instance::overlay_text(std::string_view text)
+{
+    if (overlay_)
+    {
+        overlay_->set_text(text);
+    }
+}
+
+std::vector<stream_report> instance::vertex_streams() const
+{
+    auto lattice = uint64_t{lod_.parameters().patch_quads} + 1;
+    uint64_t scene_fetches   = 0;
+    uint64_t scene_instances = 0;
+    for (const auto& draw : scene_draws_)
+    {
+        scene_fetches += uint64_t{draw.index_count} * draw.instance_count;
+        scene_instances += draw.instance_count;
+    }
+    return {report<patch_format::stream<0>>(
+                "patch grid",
+                lattice * lattice,
+                uint64_t{patch_index_count_} * patch_count_),
+            report<patch_format::stream<1>>(
+                "patch nodes", patch_count_, patch_count_),
+            report<mesh_format::stream<0>>(
+                "scene vertices", scene_vertex_count_, scene_fetches),
+            report<mesh_format::stream<1>>(
+                "scene instances", scene_instances, scene_instances)};
+}
+
+void instance::create_descriptor_pool_()
+{
+    // a single set suffices with the heap, the uniforms move by offset
+    auto set_count = bindless_ ? 1 : frames_.frames_in_flight;
+    std::array<VkDescriptorPoolSize, 2> pool_sizes{};
+    pool_sizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    pool_sizes[0].descriptorCount = set_count;
+    pool_sizes[1].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_sizes[1].descriptorCount = 2 * set_count;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = bindless_ ? 1 : to<uint32_t>(pool_sizes.size());
+    pool_info.pPoolSizes    = pool_sizes.data();
+    pool_info.maxSets       = set_count;
+    if (vkCreateDescriptorPool(logical_device_,
+                               std::addressof(pool_info),
+                               nullptr,
+                               std::addressof(descriptor_pool_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+}
+
+void instance::create_descriptor_sets_()
+{
+    auto set_count = bindless_ ? 1 : frames_.frames_in_flight;
+    std::vector<VkDescriptorSetLayout> layouts(set_count,
+                                               descriptor_set_layout_);
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType          = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = descriptor_pool_;
+    alloc_info.descriptorSetCount = set_count;
+    alloc_info.pSetLayouts        = layouts.data();
+
+    descriptor_sets_.resize(set_count);
+    if (vkAllocateDescriptorSets(logical_device_,
+                                 std::addressof(alloc_info),
+                                 descriptor_sets_.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+
+    if (bindless_)
+    {
+        surface_slots_.clear();
+        for (auto buffer : surface_vertex_buffers_)
+        {
+            surface_slots_.push_back(bindless_->add_buffer(buffer));
+        }
+    }
+
+    for (uint32_t i = 0; i < set_count; ++i)
+    {
+        VkDescriptorBufferInfo buffer_info{};
+        buffer_info.buffer = frame_ring_->buffer();
+        buffer_info.offset = 0;
+        buffer_info.range  = sizeof(uniform_buffer_object);
+
+        VkDescriptorBufferInfo surface_info{};
+        surface_info.buffer = surface_vertex_buffers_[i];
+        surface_info.offset = 0;
+        surface_info.range  = VK_WHOLE_SIZE;
+
+        std::array<VkWriteDescriptorSet, 2> descriptor_writes{};
+        descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[0].dstSet          = descriptor_sets_[i];
+        descriptor_writes[0].dstBinding      = 0;
+        descriptor_writes[0].dstArrayElement = 0;
+        descriptor_writes[0].descriptorType =
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        descriptor_writes[0].descriptorCount = 1;
+        descriptor_writes[0].pBufferInfo     = std::addressof(buffer_info);
+
+        descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[1].dstSet          = descriptor_sets_[i];
+        descriptor_writes[1].dstBinding      = 1;
+        descriptor_writes[1].dstArrayElement = 0;
+        descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptor_writes[1].descriptorCount = 1;
+        descriptor_writes[1].pBufferInfo     = std::addressof(surface_info);
+        vkUpdateDescriptorSets(logical_device_,
+                               bindless_ ? 1
+                                         : to<uint32_t>(
+                                               descriptor_writes.size()),
+                               descriptor_writes.data(),
+                               0,
+                               nullptr);
+    }
+}
+
+VkDescriptorSet instance::frame_descriptor_set_() const
+{
+    return bindless_ ? descriptor_sets_.front()
+                     : descriptor_sets_[current_frame_];
+}
+
+void instance::create_surface_vertex_buffers_()
+{
+    // rewritten by the host every frame, so each frame in flight gets its own
+    // persistently mapped copy which the vertex stage samples directly
+    [this](auto&... vectors) {
+        (vectors.resize(frames_.frames_in_flight), ...);
+    }(surface_vertex_buffers_, surface_vertex_allocations_);
+
+    VkDeviceSize buffer_size =
+        sizeof(vertex) * surface_resolution_ * surface_resolution_;
+    for (auto&& [buffer, allocation] : std::views::zip(
+             surface_vertex_buffers_, surface_vertex_allocations_))
+    {
+        create_buffer_(buffer_size,
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       buffer,
+                       allocation);
+    }
+}
+
+bool instance::async_compute_() const
+{
+    return queue_families_.compute_family != queue_families_.graphics_family;
+}
+
+bool instance::enable_compute_surface(uint32_t max_waves)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device_,
+                                  std::addressof(properties));
+    auto point_count = size_t{surface_resolution_} * surface_resolution_;
+    auto group_count =
+        (point_count + surface_workgroup_size - 1) / surface_workgroup_size;
+    if (group_count > properties.limits.maxComputeWorkGroupCount[0] or
+        sizeof(vertex) * point_count > properties.limits.maxStorageBufferRange)
+    {
+        wf::log("surface does not fit in a single compute dispatch, keeping "
+                "it on the cpu");
+        return false;
+    }
+
+    if (compute_surface_)
+    {
+        vkDeviceWaitIdle(logical_device_);
+        destroy_compute_surface_();
+    }
+    max_surface_waves_   = std::max(max_waves, 1u);
+    auto pipelines_start = std::chrono::steady_clock::now();
+    create_compute_pipeline_();
+    pipeline_creation_ += std::chrono::steady_clock::now() - pipelines_start;
+    create_compute_commands_();
+    create_compute_frames_();
+    compute_surface_ = true;
+
+    wf::log(fmt::format("surface evaluated by compute on {} queue",
+                        async_compute_() ? "a dedicated" : "the graphics"));
+    log_memory_statistics_();
+    return true;
+}
+
+void instance::create_compute_pipeline_()
+{
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    for (uint32_t binding = 0; binding < bindings.size(); ++binding)
+    {
+        bindings[binding].binding         = binding;
+        bindings[binding].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[binding].descriptorCount = 1;
+        bindings[binding].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = to<uint32_t>(bindings.size());
+    layout_info.pBindings    = bindings.data();
+    if (vkCreateDescriptorSetLayout(
+            logical_device_,
+            std::addressof(layout_info),
+            nullptr,
+            std::addressof(compute_descriptor_set_layout_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error(
+            "failed to create compute descriptor set layout!");
+    }
+
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset     = 0;
+    push_constant_range.size       = sizeof(surface_dispatch);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts =
+        std::addressof(compute_descriptor_set_layout_);
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges =
+        std::addressof(push_constant_range);
+    if (vkCreatePipelineLayout(logical_device_,
+                               std::addressof(pipeline_layout_info),
+                               nullptr,
+                               std::addressof(compute_pipeline_layout_)) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create compute pipeline layout!");
+    }
+
+    mapped_file comp_code{"../shaders/waves.comp.spv"};
+    vk_shader_module comp_shader_module(logical_device_, comp_code.bytes());
+
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = comp_shader_module.module;
+    pipeline_info.stage.pName  = "main";
+    pipeline_info.layout       = compute_pipeline_layout_;
+
+    if (vkCreateComputePipelines(logical_device_,
+                                 *pipeline_cache_,
+                                 1,
+                                 std::addressof(pipeline_info),
+                                 nullptr,
+                                 std::addressof(compute_pipeline_)) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+}
+
+void instance::create_compute_buffers_()
+{
+    [this](auto&... vectors) {
+        (vectors.resize(frames_.frames_in_flight), ...);
+    }(compute_surface_buffers_,
+      compute_surface_allocations_,
+      wave_buffers_,
+      wave_allocations_);
+
+    // one surface per frame in flight so compute fills the next frame while
+    // the vertex stage still samples the previous one
+    VkDeviceSize surface_size =
+        sizeof(vertex) * surface_resolution_ * surface_resolution_;
+    VkDeviceSize waves_size =
+        sizeof(gerstner::wave_constants) * max_surface_waves_;
+    for (auto&& [surface, surface_allocation, waves, waves_allocation] :
+         std::views::zip(compute_surface_buffers_,
+                         compute_surface_allocations_,
+                         wave_buffers_,
+                         wave_allocations_))
+    {
+        create_buffer_(surface_size,
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       surface,
+                       surface_allocation);
+        create_buffer_(waves_size,
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       waves,
+                       waves_allocation);
+    }
+}
+
+void instance::create_compute_descriptor_sets_()
+{
+    VkDescriptorPoolSize pool_size{};
+    pool_size.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_size.descriptorCount = 2 * frames_.frames_in_flight;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes    = std::addressof(pool_size);
+    pool_info.maxSets       = frames_.frames_in_flight;
+    if (vkCreateDescriptorPool(logical_device_,
+                               std::addressof(pool_info),
+                               nullptr,
+                               std::addressof(compute_descriptor_pool_)) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create compute descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(frames_.frames_in_flight,
+                                               compute_descriptor_set_layout_);
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType          = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = compute_descriptor_pool_;
+    alloc_info.descriptorSetCount = frames_.frames_in_flight;
+    alloc_info.pSetLayouts        = layouts.data();
+
+    compute_descriptor_sets_.resize(frames_.frames_in_flight);
+    if (vkAllocateDescriptorSets(logical_device_,
+                                 std::addressof(alloc_info),
+                                 compute_descriptor_sets_.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate compute descriptor sets!");
+    }
+
+    for (uint32_t i = 0; i < frames_.frames_in_flight; ++i)
+    {
+        std::array<VkDescriptorBufferInfo, 2> buffer_infos{};
+        buffer_infos[0].buffer = wave_buffers_[i];
+        buffer_infos[0].range  = VK_WHOLE_SIZE;
+        buffer_infos[1].buffer = compute_surface_buffers_[i];
+        buffer_infos[1].range  = VK_WHOLE_SIZE;
+
+        std::array<VkWriteDescriptorSet, 2> descriptor_writes{};
+        for (uint32_t binding = 0; binding < descriptor_writes.size();
+             ++binding)
+        {
+            auto& write = descriptor_writes[binding];
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet          = compute_descriptor_sets_[i];
+            write.dstBinding      = binding;
+            write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.descriptorCount = 1;
+            write.pBufferInfo     = std::addressof(buffer_infos[binding]);
+        }
+        vkUpdateDescriptorSets(logical_device_,
+                               to<uint32_t>(descriptor_writes.size()),
+                               descriptor_writes.data(),
+                               0,
+                               nullptr);
+    }
+}
+
+void instance::create_compute_commands_()
+{
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = queue_families_.compute_family.value();
+    if (vkCreateCommandPool(logical_device_,
+                            std::addressof(pool_info),
+                            nullptr,
+                            std::addressof(compute_command_pool_)) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create compute command pool!");
+    }
+
+    VkSemaphoreTypeCreateInfo timeline_info{};
+    timeline_info.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timeline_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timeline_info.initialValue  = compute_value_;
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = std::addressof(timeline_info);
+    if (vkCreateSemaphore(logical_device_,
+                          std::addressof(semaphore_info),
+                          nullptr,
+                          std::addressof(compute_timeline_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error(
+            "failed to create compute timeline semaphore!");
+    }
+}
+
+// everything compute keeps per frame in flight, rebuilt on its own when the
+// frame count changes while the pipeline and pool stay
+void instance::create_compute_frames_()
+{
+    create_compute_buffers_();
+    create_compute_descriptor_sets_();
+
+    compute_command_buffers_.resize(frames_.frames_in_flight);
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = compute_command_pool_;
+    alloc_info.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount =
+        to<uint32_t>(compute_command_buffers_.size());
+    if (vkAllocateCommandBuffers(logical_device_,
+                                 std::addressof(alloc_info),
+                                 compute_command_buffers_.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate compute command buffers!");
+    }
+    write_surface_descriptors_();
+}
+
+void instance::destroy_compute_frames_()
+{
+    std::ranges::for_each(
+        std::views::zip(compute_surface_buffers_,
+                        compute_surface_allocations_),
+        [this](auto&& surface) {
+            const auto& [buffer, allocation] = surface;
+            destroy_buffer_(buffer, allocation);
+        });
+    std::ranges::for_each(std::views::zip(wave_buffers_, wave_allocations_),
+                          [this](auto&& waves) {
+                              const auto& [buffer, allocation] = waves;
+                              destroy_buffer_(buffer, allocation);
+                          });
+    vkFreeCommandBuffers(logical_device_,
+                         compute_command_pool_,
+                         to<uint32_t>(compute_command_buffers_.size()),
+                         compute_command_buffers_.data());
+    vkDestroyDescriptorPool(logical_device_, compute_descriptor_pool_, nullptr);
+}
+
+// points the vertex stage at the compute written surfaces
+void instance::write_surface_descriptors_()
+{
+    if (bindless_)
+    {
+        for (auto&& [slot, buffer] :
+             std::views::zip(surface_slots_, compute_surface_buffers_))
+        {
+            bindless_->update_buffer(slot, buffer);
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < frames_.frames_in_flight; ++i)
+    {
+        VkDescriptorBufferInfo surface_info{};
+        surface_info.buffer = compute_surface_buffers_[i];
+        surface_info.offset = 0;
+        surface_info.range  = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet descriptor_write{};
+        descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write.dstSet          = descriptor_sets_[i];
+        descriptor_write.dstBinding      = 1;
+        descriptor_write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptor_write.descriptorCount = 1;
+        descriptor_write.pBufferInfo     = std::addressof(surface_info);
+        vkUpdateDescriptorSets(
+            logical_device_, 1, std::addressof(descriptor_write), 0, nullptr);
+    }
+}
+
+void instance::record_surface_dispatch_(VkCommandBuffer command_buffer,
+                                        const surface_dispatch& dispatch)
+{
+    vkCmdBindPipeline(
+        command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline_);
+    vkCmdBindDescriptorSets(
+        command_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        compute_pipeline_layout_,
+        0,
+        1,
+        std::addressof(compute_descriptor_sets_[current_frame_]),
+        0,
+        nullptr);
+    vkCmdPushConstants(command_buffer,
+                       compute_pipeline_layout_,
+                       VK_SHADER_STAGE_COMPUTE_BIT,
+                       0,
+                       sizeof(dispatch),
+                       std::addressof(dispatch));
+    // a dedicated compute family may not support timestamps at all
+    auto zone        = not async_compute_() or compute_timestamps_
+                           ? begin_gpu_zone_(command_buffer, "surface dispatch")
+                           : std::nullopt;
+    auto point_count = dispatch.resolution * dispatch.resolution;
+    vkCmdDispatch(command_buffer,
+                  (point_count + surface_workgroup_size - 1) /
+                      surface_workgroup_size,
+                  1,
+                  1);
+    end_gpu_zone_(command_buffer, zone);
+
+    // on a dedicated queue this is the release half of the ownership
+    // transfer, the graphics frame records the matching acquire
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = compute_surface_buffers_[current_frame_];
+    barrier.offset              = 0;
+    barrier.size                = VK_WHOLE_SIZE;
+    VkPipelineStageFlags dst_stage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+    if (async_compute_())
+    {
+        barrier.dstAccessMask       = 0;
+        barrier.srcQueueFamilyIndex = queue_families_.compute_family.value();
+        barrier.dstQueueFamilyIndex = queue_families_.graphics_family.value();
+        dst_stage                   = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    }
+    vkCmdPipelineBarrier(command_buffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         dst_stage,
+                         0,
+                         0,
+                         nullptr,
+                         1,
+                         std::addressof(barrier),
+                         0,
+                         nullptr);
+}
+
+void instance::submit_surface_dispatch_(const surface_dispatch& dispatch)
+{
+    // the previous use of this command buffer finished before the frame
+    // fence signalled, since graphics waited on its timeline value
+    profiler::scope submit{profiler_, "compute submit"};
+    auto command_buffer = compute_command_buffers_[current_frame_];
+    vkResetCommandBuffer(command_buffer, 0);
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(command_buffer, std::addressof(begin_info)) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording compute commands!");
+    }
+    record_surface_dispatch_(command_buffer, dispatch);
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record compute commands!");
+    }
+
+    auto signal_value = compute_value_ + 1;
+    VkTimelineSemaphoreSubmitInfo timeline_info{};
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.signalSemaphoreValueCount = 1;
+    timeline_info.pSignalSemaphoreValues    = std::addressof(signal_value);
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext                = std::addressof(timeline_info);
+    submit_info.commandBufferCount   = 1;
+    submit_info.pCommandBuffers      = std::addressof(command_buffer);
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores    = std::addressof(compute_timeline_);
+    if (vkQueueSubmit(compute_queue_,
+                      1,
+                      std::addressof(submit_info),
+                      VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit compute command buffer!");
+    }
+    compute_value_ = signal_value;
+}
 
-void instance::copy_buffer_(VkBuffer src_buffer,
-                            VkBuffer dst_buffer,
-                            VkDeviceSize size)
+std::vector<vertex> instance::read_compute_surface()
 {
+    if (not compute_surface_)
+    {
+        throw std::runtime_error{"compute surface is not enabled!"};
+    }
+    vkDeviceWaitIdle(logical_device_);
+
+    // the last submitted frame, already acquired by the graphics family
+    auto frame = (current_frame_ + frames_.frames_in_flight - 1) %
+                 frames_.frames_in_flight;
+    std::vector<vertex> vertices(size_t{surface_resolution_} *
+                                 surface_resolution_);
+    VkDeviceSize size = sizeof(vertex) * vertices.size();
+
+    VkBuffer readback_buffer;
+    allocation readback_allocation;
+    create_buffer_(size,
+                   VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                   readback_buffer,
+                   readback_allocation);
+
     VkCommandBufferAllocateInfo alloc_info{};
     alloc_info.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     alloc_info.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     alloc_info.commandPool = command_pool_;
     alloc_info.commandBufferCount = 1;
-
     VkCommandBuffer command_buffer;
     vkAllocateCommandBuffers(logical_device_,
                              std::addressof(alloc_info),
@@ -1135,238 +2531,508 @@ void instance::copy_buffer_(VkBuffer src_buffer,
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     vkBeginCommandBuffer(command_buffer, std::addressof(begin_info));
-
-    VkBufferCopy copy_region{};
-    copy_region.srcOffset = 0;
-    copy_region.dstOffset = 0;
-    copy_region.size      = size;
-    vkCmdCopyBuffer(
-        command_buffer, src_buffer, dst_buffer, 1, std::addressof(copy_region));
-
+    VkBufferCopy region{0, 0, size};
+    vkCmdCopyBuffer(command_buffer,
+                    compute_surface_buffers_[frame],
+                    readback_buffer,
+                    1,
+                    std::addressof(region));
     vkEndCommandBuffer(command_buffer);
 
     VkSubmitInfo submit_info{};
     submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers    = std::addressof(command_buffer);
-
     vkQueueSubmit(
         graphics_queue_, 1, std::addressof(submit_info), VK_NULL_HANDLE);
     vkQueueWaitIdle(graphics_queue_);
 
+    std::memcpy(vertices.data(), readback_allocation.mapped, size);
     vkFreeCommandBuffers(
         logical_device_, command_pool_, 1, std::addressof(command_buffer));
+    destroy_buffer_(readback_buffer, readback_allocation);
+    return vertices;
 }
 
-void instance::create_index_buffer_()
+void instance::destroy_compute_surface_()
 {
-    VkDeviceSize buffer_size = sizeof(indices[0]) * indices.size();
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    create_buffer_(buffer_size,
-                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                   staging_buffer,
-                   staging_buffer_memory);
-
-    void* data = nullptr;
-    vkMapMemory(logical_device_,
-                staging_buffer_memory,
-                0,
-                buffer_size,
-                0,
-                std::addressof(data));
-    std::copy(
-        std::begin(indices), std::end(indices), static_cast<uint16_t*>(data));
-    vkUnmapMemory(logical_device_, staging_buffer_memory);
-
-    create_buffer_(buffer_size,
-                   VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                   index_buffer_,
-                   index_buffer_memory_);
-
-    copy_buffer_(staging_buffer, index_buffer_, buffer_size);
-
-    vkDestroyBuffer(logical_device_, staging_buffer, nullptr);
-    vkFreeMemory(logical_device_, staging_buffer_memory, nullptr);
+    destroy_compute_frames_();
+    vkDestroySemaphore(logical_device_, compute_timeline_, nullptr);
+    vkDestroyCommandPool(logical_device_, compute_command_pool_, nullptr);
+    vkDestroyPipeline(logical_device_, compute_pipeline_, nullptr);
+    vkDestroyPipelineLayout(logical_device_, compute_pipeline_layout_, nullptr);
+    vkDestroyDescriptorSetLayout(
+        logical_device_, compute_descriptor_set_layout_, nullptr);
+    compute_surface_ = false;
 }
 
-void instance::create_descriptor_set_layout_()
+void present_device(VkPhysicalDevice device)
 {
-    VkDescriptorSetLayoutBinding ubo_layout_binding{};
-    ubo_layout_binding.binding            = 0;
-    ubo_layout_binding.descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    ubo_layout_binding.descriptorCount    = 1;
-    ubo_layout_binding.stageFlags         = VK_SHADER_STAGE_VERTEX_BIT;
-    ubo_layout_binding.pImmutableSamplers = nullptr;
+    VkPhysicalDeviceProperties device_properties;
+    VkPhysicalDeviceFeatures device_features;
+    vkGetPhysicalDeviceProperties(device, std::addressof(device_properties));
+    vkGetPhysicalDeviceFeatures(device, std::addressof(device_features));
 
-    VkDescriptorSetLayoutCreateInfo layout_info{};
-    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layout_info.bindingCount = 1;
-    layout_info.pBindings    = std::addressof(ubo_layout_binding);
+    auto tag = fmt::format(fg(fmt::color::cyan), "vk physical device");
+    fmt::println("[{}] {}", tag, device_properties.deviceName);
+}
 
-    if (vkCreateDescriptorSetLayout(logical_device_,
-                                    std::addressof(layout_info),
-                                    nullptr,
-                                    std::addressof(descriptor_set_layout_)) !=
-        VK_SUCCESS)
+void instance::load_scene(const scene::description& scene)
+{
+    vkDeviceWaitIdle(logical_device_);
+    // the frame ring and the culler are sized by the scene
+    destroy_frame_resources_();
+    destroy_scene_();
+    compact_memory_();
+    if (not scene.transforms.empty())
     {
-        throw std::runtime_error("failed to create descriptor set layout!");
+        upload_scene_(scene);
     }
+    create_frame_resources_();
+    if (scene_draws_.empty())
+    {
+        return;
+    }
+
+    wf::log(fmt::format("scene: {} instances of {} meshes in {} draws, {} "
+                        "bounds culled per frame",
+                        scene.instance_count(),
+                        scene.meshes.size(),
+                        scene_draws_.size(),
+                        scene_bounds_.size()));
+    wf::log(fmt::format("scene: {} vertices packed into {} bytes from {}",
+                        scene_vertex_count_,
+                        sizeof(quantize::mesh_vertex) * scene_vertex_count_,
+                        sizeof(assets::vertex) * scene_vertex_count_));
 }
 
-void instance::create_uniform_buffers_()
+// meshes with fewer meshlets are culled whole, their clusters would cost
+// more draws than they could save
+constexpr uint32_t min_clustered_meshlets = 16;
+
+void instance::upload_scene_(const scene::description& scene)
 {
-    [](auto&... vectors) {
-        (vectors.resize(max_frames_in_flight), ...);
-    }(uniform_buffers_, uniform_buffers_memory_, uniform_buffers_mapped_);
+    uint32_t index_count = 0;
+    scene_vertex_count_  = 0;
+    for (const auto& mesh : scene.meshes)
+    {
+        scene_vertex_count_ += mesh.vertex_count();
+        index_count += mesh.index_count();
+    }
+    create_buffer_(sizeof(quantize::mesh_vertex) * scene_vertex_count_,
+                   VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                   scene_vertex_buffer_,
+                   scene_vertex_allocation_);
+    create_buffer_(sizeof(uint32_t) * index_count,
+                   VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                   scene_index_buffer_,
+                   scene_index_allocation_);
+
+    // meshes are packed back to back, 16 bit indices are widened so one
+    // index type covers every mesh of an indirect call. vertices are
+    // quantized against their mesh's bounds, the instance transforms undo it
+    std::vector<culling::draw_command> mesh_draws;
+    std::vector<glm::vec4> mesh_spheres;
+    std::vector<glm::mat4> mesh_dequantize;
+    std::vector<quantize::mesh_vertex> packed;
+    std::vector<uint32_t> widened;
+    int32_t first_vertex = 0;
+    uint32_t first_index = 0;
+    for (const auto& mesh : scene.meshes)
+    {
+        std::span vertices{
+            reinterpret_cast<const assets::vertex*>(mesh.vertex_bytes().data()),
+            mesh.vertex_count()};
+        auto range = quantize::fit_positions(vertices);
+        packed.resize(vertices.size());
+        quantize::pack_mesh(vertices, range, packed);
+        uploader_->enqueue(std::as_bytes(std::span{packed}),
+                           scene_vertex_buffer_,
+                           sizeof(quantize::mesh_vertex) * first_vertex);
+        mesh_dequantize.push_back(quantize::dequantize(range));
+        auto indices = mesh.index_bytes();
+        if (mesh.indices_type == assets::index_type::uint16)
+        {
+            widened.resize(mesh.index_count());
+            std::ranges::copy(
+                std::span{reinterpret_cast<const uint16_t*>(indices.data()),
+                          widened.size()},
+                widened.begin());
+            indices = std::as_bytes(std::span{widened});
+        }
+        uploader_->enqueue(
+            indices, scene_index_buffer_, sizeof(uint32_t) * first_index);
+
+        mesh_draws.push_back({.index_count    = mesh.index_count(),
+                              .instance_count = 0,
+                              .first_index    = first_index,
+                              .vertex_offset  = first_vertex,
+                              .first_instance = 0});
+        mesh_spheres.push_back(culling::bounding_sphere(vertices));
+        first_vertex += to<int32_t>(mesh.vertex_count());
+        first_index += mesh.index_count();
+    }
 
-    auto uniforms = std::views::zip(
-        uniform_buffers_, uniform_buffers_memory_, uniform_buffers_mapped_);
+    // large meshes draw one meshlet per command, so each cluster is culled
+    // against the frustum and its normal cone on its own. every draw gets
+    // its own run of bounds, which hold the transform to draw with
+    std::vector<glm::mat4> transforms(scene.transforms.size());
+    uint32_t slot = 0;
+    for (const auto& batch : scene.batches)
+    {
+        const auto& mesh = scene.meshes[batch.mesh];
+        std::span meshlets{reinterpret_cast<const meshopt::meshlet*>(
+                               mesh.meshlet_bytes().data()),
+                           mesh.meshlet_count()};
+        if (meshlets.size() < min_clustered_meshlets)
+        {
+            meshlets = {};
+        }
+        auto add_draw = [&](const culling::draw_command& command,
+                            glm::vec4 sphere,
+                            glm::vec4 cone) {
+            auto draw   = to<uint32_t>(scene_draws_.size());
+            auto& added = scene_draws_.emplace_back(command);
+            added.instance_count = batch.instance_count;
+            added.first_instance = slot;
+            for (auto i = batch.first_instance;
+                 i < batch.first_instance + batch.instance_count;
+                 ++i)
+            {
+                const auto& model = scene.transforms[i];
+                scene_bounds_.push_back(
+                    {.sphere   = culling::transform_sphere(sphere, model),
+                     .cone     = culling::transform_cone(cone, model),
+                     .draw     = draw,
+                     .instance = i});
+            }
+            slot += batch.instance_count;
+        };
+        for (const auto& meshlet : meshlets)
+        {
+            auto command        = mesh_draws[batch.mesh];
+            command.index_count = 3 * meshlet.triangle_count;
+            command.first_index += 3 * meshlet.first_triangle;
+            add_draw(command,
+                     glm::vec4{meshlet.center, meshlet.radius},
+                     glm::vec4{meshlet.cone_axis, meshlet.cone_cutoff});
+        }
+        if (meshlets.empty())
+        {
+            add_draw(mesh_draws[batch.mesh],
+                     mesh_spheres[batch.mesh],
+                     culling::no_cone);
+        }
+        for (auto i = batch.first_instance;
+             i < batch.first_instance + batch.instance_count;
+             ++i)
+        {
+            transforms[i] = scene.transforms[i] * mesh_dequantize[batch.mesh];
+        }
+    }
+    scene_commands_.resize(scene_draws_.size());
 
-    std::ranges::for_each(uniforms, [this](auto&& uniform) {
-        auto& [buffer, memory, map] = uniform;
-        size_t buffer_size          = sizeof(uniform_buffer_object);
-        create_buffer_(buffer_size,
-                       VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       buffer,
-                       memory);
-        vkMapMemory(
-            logical_device_, memory, 0, buffer_size, 0, std::addressof(map));
-    });
+    create_buffer_(sizeof(transforms[0]) * transforms.size(),
+                   VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                   instance_transform_buffer_,
+                   instance_transform_allocation_);
+    uploader_->enqueue(std::as_bytes(std::span{transforms}),
+                       instance_transform_buffer_);
+    if (bindless_)
+    {
+        instance_transform_slot_ =
+            bindless_->add_buffer(instance_transform_buffer_);
+    }
+
+    // the gpu cull reads the bounds and draws from device local copies
+    if (submission_ == scene_submission::gpu_culled)
+    {
+        auto bounds = std::as_bytes(std::span{scene_bounds_});
+        create_buffer_(bounds.size(),
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       scene_bounds_buffer_,
+                       scene_bounds_allocation_);
+        uploader_->enqueue(bounds, scene_bounds_buffer_);
+        auto draws = std::as_bytes(std::span{scene_draws_});
+        create_buffer_(draws.size(),
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       scene_draw_buffer_,
+                       scene_draw_allocation_);
+        uploader_->enqueue(draws, scene_draw_buffer_);
+    }
 }
 
-void instance::update_uniform_buffer_(uint32_t current_image)
+void instance::write_scene_descriptors_()
 {
-    static auto start_time = std::chrono::high_resolution_clock::now();
-    auto current_time      = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration<float, std::chrono::seconds::period>(
-                     current_time - start_time)
-                     .count();
+    if (instance_transform_buffer_ == VK_NULL_HANDLE or bindless_)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < frames_.frames_in_flight; ++i)
+    {
+        VkDescriptorBufferInfo instances_info{};
+        instances_info.buffer = instance_transform_buffer_;
+        instances_info.offset = 0;
+        instances_info.range  = VK_WHOLE_SIZE;
 
-    uniform_buffer_object ubo{};
-    ubo.model = glm::rotate(
-        glm::mat4(1.f), time * glm::radians(90.f), glm::vec3(0.f, 0.f, 1.f));
-    ubo.view = glm::lookAt(glm::vec3(2.f, 2.f, 2.f),
-                           glm::vec3(0.f, 0.f, 0.f),
-                           glm::vec3(0.f, 0.f, 1.f));
-    ubo.proj =
-        glm::perspective(glm::radians(45.f),
-                         swap_chain_extent_.width /
-                             static_cast<float>(swap_chain_extent_.height),
-                         0.1f,
-                         10.f);
-    ubo.proj[1][1] *= -1;
-    std::memcpy(uniform_buffers_mapped_[current_image],
-                std::addressof(ubo),
-                sizeof(ubo));
+        VkWriteDescriptorSet descriptor_write{};
+        descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write.dstSet          = descriptor_sets_[i];
+        descriptor_write.dstBinding      = 2;
+        descriptor_write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptor_write.descriptorCount = 1;
+        descriptor_write.pBufferInfo     = std::addressof(instances_info);
+        vkUpdateDescriptorSets(
+            logical_device_, 1, std::addressof(descriptor_write), 0, nullptr);
+    }
 }
 
-void instance::create_descriptor_pool_()
+void instance::create_culler_()
 {
-    VkDescriptorPoolSize pool_size{};
-    pool_size.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    pool_size.descriptorCount = wf::to<uint32_t>(max_frames_in_flight);
-
-    VkDescriptorPoolCreateInfo pool_info{};
-    pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    pool_info.poolSizeCount = 1;
-    pool_info.pPoolSizes    = std::addressof(pool_size);
-    pool_info.maxSets       = wf::to<uint32_t>(max_frames_in_flight);
-    if (vkCreateDescriptorPool(logical_device_,
-                               std::addressof(pool_info),
-                               nullptr,
-                               std::addressof(descriptor_pool_)) != VK_SUCCESS)
+    if (submission_ != scene_submission::gpu_culled or scene_draws_.empty())
     {
-        throw std::runtime_error("failed to create descriptor pool!");
+        return;
     }
+    culler_.emplace(physical_device_,
+                    logical_device_,
+                    *allocator_,
+                    *pipeline_cache_,
+                    scene_bounds_buffer_,
+                    to<uint32_t>(scene_bounds_.size()),
+                    scene_draw_buffer_,
+                    to<uint32_t>(scene_draws_.size()),
+                    frames_.frames_in_flight);
 }
 
-void instance::create_descriptor_sets_()
+// an instance further away is culled whatever the frustum says
+constexpr float scene_draw_distance = 4096.f;
+
+void instance::cull_scene_(const uniform_buffer_object& ubo)
 {
-    std::vector<VkDescriptorSetLayout> layouts(max_frames_in_flight,
-                                               descriptor_set_layout_);
-    VkDescriptorSetAllocateInfo alloc_info{};
-    alloc_info.sType          = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    alloc_info.descriptorPool = descriptor_pool_;
-    alloc_info.descriptorSetCount = wf::to<uint32_t>(max_frames_in_flight);
-    alloc_info.pSetLayouts        = layouts.data();
+    if (scene_draws_.empty())
+    {
+        return;
+    }
+    scene_view_ = culling::make_view(
+        ubo.proj * ubo.view, glm::vec3{ubo.camera}, scene_draw_distance);
+    if (submission_ == scene_submission::gpu_culled)
+    {
+        return; // recorded ahead of the render pass instead
+    }
 
-    descriptor_sets_.resize(max_frames_in_flight);
-    if (vkAllocateDescriptorSets(logical_device_,
-                                 std::addressof(alloc_info),
-                                 descriptor_sets_.data()) != VK_SUCCESS)
+    auto visible = frame_ring_->allocate(sizeof(uint32_t) *
+                                         scene_bounds_.size());
+    scene_draw_count_ = culling::cull(
+        scene_view_,
+        scene_bounds_,
+        scene_draws_,
+        {reinterpret_cast<uint32_t*>(visible.data.data()),
+         scene_bounds_.size()},
+        scene_commands_);
+    scene_visible_offset_ = visible.offset;
+    if (submission_ == scene_submission::multi_draw)
     {
-        throw std::runtime_error("failed to allocate descriptor sets!");
+        scene_commands_offset_ =
+            frame_ring_
+                ->push(std::span{scene_commands_}.first(scene_draw_count_))
+                .offset;
     }
+}
 
-    for (size_t i = 0; i < max_frames_in_flight; ++i)
+void instance::record_scene_(VkCommandBuffer command_buffer,
+                             uint32_t partition,
+                             uint32_t partitions)
+{
+    if (scene_draws_.empty())
     {
-        VkDescriptorBufferInfo buffer_info{};
-        buffer_info.buffer = uniform_buffers_[i];
-        buffer_info.offset = 0;
-        buffer_info.range  = sizeof(uniform_buffer_object);
+        return;
+    }
 
-        VkWriteDescriptorSet descriptor_write{};
-        descriptor_write.sType      = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_write.dstSet     = descriptor_sets_[i];
-        descriptor_write.dstBinding = 0;
-        descriptor_write.dstArrayElement = 0;
-        descriptor_write.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptor_write.descriptorCount = 1;
-        descriptor_write.pBufferInfo     = std::addressof(buffer_info);
-        vkUpdateDescriptorSets(
-            logical_device_, 1, std::addressof(descriptor_write), 0, nullptr);
+    // contiguous shares keep the draw order of a single threaded frame,
+    // the gpu culled scene is a single call
+    auto gpu_culled = submission_ == scene_submission::gpu_culled;
+    auto count      = gpu_culled ? 1 : scene_draw_count_;
+    auto share      = (count + partitions - 1) / partitions;
+    auto first      = std::min(count, share * partition);
+    auto last       = std::min(count, first + share);
+    if (first == last)
+    {
+        return;
+    }
+
+    // shares the pipeline layout, so the bound descriptor sets stay valid
+    vkCmdBindPipeline(command_buffer,
+                      VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      pipelines_->get(mesh_pipeline_));
+    std::array vertex_buffers = {
+        scene_vertex_buffer_,
+        gpu_culled ? culler_->buffer(current_frame_) : frame_ring_->buffer()};
+    std::array offsets = {
+        VkDeviceSize{0},
+        gpu_culled ? culler_->visible_offset() : scene_visible_offset_};
+    vkCmdBindVertexBuffers(command_buffer,
+                           0,
+                           to<uint32_t>(vertex_buffers.size()),
+                           vertex_buffers.data(),
+                           offsets.data());
+    vkCmdBindIndexBuffer(
+        command_buffer, scene_index_buffer_, 0, VK_INDEX_TYPE_UINT32);
+
+    constexpr auto stride = uint32_t{sizeof(culling::draw_command)};
+    switch (submission_)
+    {
+    case scene_submission::gpu_culled:
+        vkCmdDrawIndexedIndirectCount(command_buffer,
+                                      culler_->buffer(current_frame_),
+                                      culler_->commands_offset(),
+                                      culler_->buffer(current_frame_),
+                                      culler_->count_offset(),
+                                      culler_->max_draws(),
+                                      stride);
+        break;
+    case scene_submission::multi_draw:
+        vkCmdDrawIndexedIndirect(command_buffer,
+                                 frame_ring_->buffer(),
+                                 scene_commands_offset_ + stride * first,
+                                 last - first,
+                                 stride);
+        break;
+    case scene_submission::direct:
+        for (const auto& command :
+             std::span{scene_commands_}.subspan(first, last - first))
+        {
+            vkCmdDrawIndexed(command_buffer,
+                             command.index_count,
+                             command.instance_count,
+                             command.first_index,
+                             command.vertex_offset,
+                             command.first_instance);
+        }
+        break;
     }
 }
 
-void instance::create_vertex_buffer_()
+void instance::destroy_scene_()
 {
-    VkDeviceSize buffer_size = sizeof(vertices[0]) * vertices.size();
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    create_buffer_(buffer_size,
-                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                   staging_buffer,
-                   staging_buffer_memory);
-
-    void* data = nullptr;
-    vkMapMemory(logical_device_,
-                staging_buffer_memory,
-                0,
-                buffer_size,
-                0,
-                std::addressof(data));
-    std::copy(
-        std::begin(vertices), std::end(vertices), static_cast<vertex*>(data));
-    vkUnmapMemory(logical_device_, staging_buffer_memory);
-    create_buffer_(buffer_size,
-                   VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                   vertex_buffer_,
-                   vertex_buffer_memory_);
-    copy_buffer_(staging_buffer, vertex_buffer_, buffer_size);
-    vkDestroyBuffer(logical_device_, staging_buffer, nullptr);
-    vkFreeMemory(logical_device_, staging_buffer_memory, nullptr);
+    auto destroy = [this](VkBuffer& buffer, const allocation& memory) {
+        if (buffer != VK_NULL_HANDLE)
+        {
+            destroy_buffer_(buffer, memory);
+            buffer = VK_NULL_HANDLE;
+        }
+    };
+    destroy(scene_vertex_buffer_, scene_vertex_allocation_);
+    destroy(scene_index_buffer_, scene_index_allocation_);
+    destroy(scene_bounds_buffer_, scene_bounds_allocation_);
+    destroy(scene_draw_buffer_, scene_draw_allocation_);
+    scene_draws_.clear();
+    scene_bounds_.clear();
+    scene_commands_.clear();
+    scene_draw_count_   = 0;
+    scene_vertex_count_ = 0;
+    if (instance_transform_buffer_ != VK_NULL_HANDLE and bindless_)
+    {
+        bindless_->remove_buffer(instance_transform_slot_);
+    }
+    destroy(instance_transform_buffer_, instance_transform_allocation_);
 }
 
-void present_device(VkPhysicalDevice device)
+void instance::compact_memory_()
 {
-    VkPhysicalDeviceProperties device_properties;
-    VkPhysicalDeviceFeatures device_features;
-    vkGetPhysicalDeviceProperties(device, std::addressof(device_properties));
-    vkGetPhysicalDeviceFeatures(device, std::addressof(device_features));
+    // the lod patch outlives every scene and is only bound at draw time, so
+    // moving it needs no descriptor rewrites. the device is idle by now
+    struct movable_buffer
+    {
+        VkBuffer& buffer;
+        allocation& buffer_allocation;
+        VkDeviceSize size;
+        VkBufferUsageFlags usage;
+    };
+    auto stride = size_t{lod_.parameters().patch_quads} + 1;
+    std::array movable = {
+        movable_buffer{patch_vertex_buffer_,
+                       patch_vertex_allocation_,
+                       sizeof(patch_vertex) * stride * stride,
+                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                           VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                           VK_BUFFER_USAGE_VERTEX_BUFFER_BIT},
+        movable_buffer{index_buffer_,
+                       index_buffer_allocation_,
+                       sizeof(uint16_t) * patch_index_count_,
+                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                           VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                           VK_BUFFER_USAGE_INDEX_BUFFER_BIT},
+    };
+    std::array allocations = {patch_vertex_allocation_,
+                              index_buffer_allocation_};
+    auto relocations = allocator_->defragment(allocations);
+    if (relocations.empty())
+    {
+        allocator_->trim();
+        return;
+    }
 
-    auto tag = fmt::format(fg(fmt::color::cyan), "vk physical device");
-    fmt::println("[{}] {}", tag, device_properties.deviceName);
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandPool = command_pool_;
+    alloc_info.commandBufferCount = 1;
+    VkCommandBuffer command_buffer;
+    vkAllocateCommandBuffers(logical_device_,
+                             std::addressof(alloc_info),
+                             std::addressof(command_buffer));
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(command_buffer, std::addressof(begin_info));
+
+    // the old buffers stay alive until the copies out of them completed
+    std::vector<VkBuffer> old_buffers;
+    for (const auto& [from, to] : relocations)
+    {
+        auto& owner = *std::ranges::find_if(movable, [&](const auto& buffer) {
+            return buffer.buffer_allocation.memory == from.memory and
+                   buffer.buffer_allocation.offset == from.offset;
+        });
+        auto buffer = create_unbound_buffer_(owner.size, owner.usage);
+        vkBindBufferMemory(logical_device_, buffer, to.memory, to.offset);
+        VkBufferCopy region{0, 0, owner.size};
+        vkCmdCopyBuffer(
+            command_buffer, owner.buffer, buffer, 1, std::addressof(region));
+        old_buffers.push_back(owner.buffer);
+        owner.buffer            = buffer;
+        owner.buffer_allocation = to;
+    }
+    vkEndCommandBuffer(command_buffer);
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers    = std::addressof(command_buffer);
+    vkQueueSubmit(
+        graphics_queue_, 1, std::addressof(submit_info), VK_NULL_HANDLE);
+    vkQueueWaitIdle(graphics_queue_);
+    vkFreeCommandBuffers(
+        logical_device_, command_pool_, 1, std::addressof(command_buffer));
+
+    for (size_t i = 0; i < relocations.size(); ++i)
+    {
+        destroy_buffer_(old_buffers[i], relocations[i].from);
+    }
+    allocator_->trim();
+    wf::log(fmt::format("vk memory: moved {} allocations out of sparse blocks",
+                        relocations.size()));
 }
 
 void instance::pick_physical_device_()
@@ -1405,8 +3071,14 @@ void instance::create_logical_device_()
 {
     queue_family_indices indices = find_queue_families_(physical_device_);
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-    std::set<uint32_t> unique_queue_families = {indices.graphics_family.value(),
-                                                indices.present_family.value()};
+    std::set<uint32_t> unique_queue_families = {
+        indices.graphics_family.value(),
+        indices.transfer_family.value(),
+        indices.compute_family.value()};
+    if (indices.present_family)
+    {
+        unique_queue_families.insert(indices.present_family.value());
+    }
 
     float queue_priority = 1.f;
     for (uint32_t queue_family : unique_queue_families)
@@ -1414,19 +3086,53 @@ void instance::create_logical_device_()
         VkDeviceQueueCreateInfo& queue_create_info =
             queue_create_infos.emplace_back();
         queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queue_create_info.queueFamilyIndex = indices.graphics_family.value();
+        queue_create_info.queueFamilyIndex = queue_family;
         queue_create_info.queueCount       = 1;
         queue_create_info.pQueuePriorities = std::addressof(queue_priority);
     }
 
     VkPhysicalDeviceFeatures device_features{};
+    VkPhysicalDeviceVulkan12Features vulkan12_features{};
+    vulkan12_features.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12_features.timelineSemaphore = VK_TRUE;
+    // timestamp queries are recycled from the host once read back
+    vulkan12_features.hostQueryReset = VK_TRUE;
+    auto bindless = bindless_heap::request_features(
+        physical_device_, device_features, vulkan12_features);
+
+    // indirect commands carry their own first instance, several of them go
+    // in one call and their count can come from the gpu where supported
+    VkPhysicalDeviceVulkan12Features supported12{};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supported.pNext = std::addressof(supported12);
+    vkGetPhysicalDeviceFeatures2(physical_device_, std::addressof(supported));
+    device_features.drawIndirectFirstInstance =
+        supported.features.drawIndirectFirstInstance;
+    device_features.multiDrawIndirect = supported.features.multiDrawIndirect;
+    vulkan12_features.drawIndirectCount = supported12.drawIndirectCount;
+    if (not supported.features.drawIndirectFirstInstance or
+        not supported.features.multiDrawIndirect)
+    {
+        submission_ = scene_submission::direct;
+    }
+    else
+    {
+        submission_ = supported12.drawIndirectCount
+                          ? scene_submission::gpu_culled
+                          : scene_submission::multi_draw;
+    }
 
     VkDeviceCreateInfo create_info{};
     create_info.sType             = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    create_info.pNext             = std::addressof(vulkan12_features);
     create_info.pQueueCreateInfos = queue_create_infos.data();
     create_info.queueCreateInfoCount =
         static_cast<uint32_t>(queue_create_infos.size());
     create_info.pEnabledFeatures = std::addressof(device_features);
+    auto device_extensions       = required_device_extensions_();
     create_info.enabledExtensionCount =
         static_cast<uint32_t>(device_extensions.size());
     create_info.ppEnabledExtensionNames = device_extensions.data();
@@ -1455,62 +3161,42 @@ void instance::create_logical_device_()
                      0,
                      std::addressof(graphics_queue_));
     vkGetDeviceQueue(logical_device_,
-                     indices.present_family.value(),
+                     indices.transfer_family.value(),
                      0,
-                     std::addressof(present_queue_));
-}
-
-VkVertexInputBindingDescription vertex::get_binding_description()
-{
-    VkVertexInputBindingDescription binding_description{};
-    binding_description.binding   = 0;
-    binding_description.stride    = sizeof(vertex);
-    binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    return binding_description;
-}
-
-std::array<VkVertexInputAttributeDescription, 2> vertex::
-    get_attribute_descriptions()
-{
-    std::array<VkVertexInputAttributeDescription, 2> attribute_descriptions{};
-
-    attribute_descriptions[0].binding  = 0;
-    attribute_descriptions[0].location = 0;
-    attribute_descriptions[0].format   = VK_FORMAT_R32G32_SFLOAT;
-    attribute_descriptions[0].offset   = offsetof(vertex, pos);
-
-    attribute_descriptions[1].binding  = 0;
-    attribute_descriptions[1].location = 1;
-    attribute_descriptions[1].format   = VK_FORMAT_R32G32B32_SFLOAT;
-    attribute_descriptions[1].offset   = offsetof(vertex, color);
-
-    return attribute_descriptions;
-}
-
-uint32_t instance::find_memory_type_(uint32_t type_filter,
-                                     VkMemoryPropertyFlags properties)
-{
-    VkPhysicalDeviceMemoryProperties mem_properties;
-    vkGetPhysicalDeviceMemoryProperties(physical_device_,
-                                        std::addressof(mem_properties));
-    for (uint32_t i = 0; i < mem_properties.memoryTypeCount; ++i)
+                     std::addressof(transfer_queue_));
+    vkGetDeviceQueue(logical_device_,
+                     indices.compute_family.value(),
+                     0,
+                     std::addressof(compute_queue_));
+    queue_families_ = indices;
+
+    allocator_.emplace(physical_device_, logical_device_);
+    pipeline_cache_.emplace(
+        logical_device_, physical_device_, "../pipeline_cache.bin");
+    uploader_.emplace(logical_device_,
+                      *allocator_,
+                      transfer_queue_,
+                      indices.transfer_family.value());
+    if (bindless)
     {
-        std::bitset<32> bitset{type_filter};
-        bool matching_properties =
-            (mem_properties.memoryTypes[i].propertyFlags & properties) ==
-            properties;
-        if (bitset.test(i) and matching_properties)
-        {
-            return i;
-        }
+        bindless_.emplace(physical_device_, logical_device_);
+    }
+    wf::log(fmt::format("draw resources bound {}",
+                        bindless ? "through the bindless heap"
+                                 : "per frame, no descriptor indexing"));
+    wf::log(fmt::format("scene submitted as {}",
+                        magic_enum::enum_name(submission_)));
+    if (indices.present_family)
+    {
+        vkGetDeviceQueue(logical_device_,
+                         indices.present_family.value(),
+                         0,
+                         std::addressof(present_queue_));
     }
-    throw std::runtime_error{"failed to find suitable memory type!"};
 }
-void instance::create_buffer_(VkDeviceSize size,
-                              VkBufferUsageFlags usage,
-                              VkMemoryPropertyFlags properties,
-                              VkBuffer& buffer,
-                              VkDeviceMemory& buffer_memory)
+
+VkBuffer instance::create_unbound_buffer_(VkDeviceSize size,
+                                         VkBufferUsageFlags usage)
 {
     VkBufferCreateInfo buffer_info{};
     buffer_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1518,6 +3204,19 @@ void instance::create_buffer_(VkDeviceSize size,
     buffer_info.usage       = usage;
     buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    // upload destinations are written by the transfer queue and read by
+    // graphics, sharing them avoids queue family ownership transfers
+    std::array families = {queue_families_.graphics_family.value(),
+                           queue_families_.transfer_family.value()};
+    if ((usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) and
+        families[0] != families[1])
+    {
+        buffer_info.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+        buffer_info.queueFamilyIndexCount = to<uint32_t>(families.size());
+        buffer_info.pQueueFamilyIndices   = families.data();
+    }
+
+    VkBuffer buffer;
     if (vkCreateBuffer(logical_device_,
                        std::addressof(buffer_info),
                        nullptr,
@@ -1525,23 +3224,51 @@ void instance::create_buffer_(VkDeviceSize size,
     {
         throw std::runtime_error{"failed to create buffer!"};
     }
+    return buffer;
+}
 
+void instance::create_buffer_(VkDeviceSize size,
+                              VkBufferUsageFlags usage,
+                              VkMemoryPropertyFlags properties,
+                              VkBuffer& buffer,
+                              allocation& buffer_allocation)
+{
+    buffer = create_unbound_buffer_(size, usage);
     VkMemoryRequirements mem_requirements;
     vkGetBufferMemoryRequirements(
         logical_device_, buffer, std::addressof(mem_requirements));
-    VkMemoryAllocateInfo alloc_info{};
-    alloc_info.sType          = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.allocationSize = mem_requirements.size;
-    alloc_info.memoryTypeIndex =
-        find_memory_type_(mem_requirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(logical_device_,
-                         std::addressof(alloc_info),
-                         nullptr,
-                         std::addressof(buffer_memory)) != VK_SUCCESS)
+    buffer_allocation = allocator_->allocate(mem_requirements, properties);
+    vkBindBufferMemory(logical_device_,
+                       buffer,
+                       buffer_allocation.memory,
+                       buffer_allocation.offset);
+}
+
+void instance::destroy_buffer_(VkBuffer buffer,
+                               const allocation& buffer_allocation)
+{
+    vkDestroyBuffer(logical_device_, buffer, nullptr);
+    allocator_->free(buffer_allocation);
+}
+
+void instance::log_memory_statistics_() const
+{
+    for (const auto& heap : allocator_->statistics())
     {
-        throw std::runtime_error{"failed to allocate buffer memory!"};
+        if (heap.reserved_bytes == 0)
+        {
+            continue;
+        }
+        wf::log(fmt::format("vk heap {}: {} / {} bytes used in {} blocks "
+                            "and {} dedicated allocations ({} allocations, "
+                            "heap size {})",
+                            heap.heap_index,
+                            heap.used_bytes,
+                            heap.reserved_bytes,
+                            heap.block_count,
+                            heap.dedicated_count,
+                            heap.allocation_count,
+                            heap.heap_size));
     }
-    vkBindBufferMemory(logical_device_, buffer, buffer_memory, 0);
 }
 } // namespace wf::vk
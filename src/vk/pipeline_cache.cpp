@@ -0,0 +1,155 @@
+module;
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+module vk;
+
+namespace wf::vk
+{
+pipeline_cache::pipeline_cache(VkDevice device,
+                               VkPhysicalDevice physical_device,
+                               std::filesystem::path path)
+    : device_{device}, path_{std::move(path)}
+{
+    vkGetPhysicalDeviceProperties(physical_device,
+                                  std::addressof(properties_));
+
+    std::optional<mapped_file> file;
+    std::span<const std::byte> initial_data;
+    if (std::filesystem::exists(path_))
+    {
+        file.emplace(path_);
+        initial_data = validate_(file->bytes());
+    }
+    warm_ = not initial_data.empty();
+
+    VkPipelineCacheCreateInfo create_info{};
+    create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    create_info.initialDataSize = initial_data.size();
+    create_info.pInitialData    = initial_data.data();
+    if (vkCreatePipelineCache(device_,
+                              std::addressof(create_info),
+                              nullptr,
+                              std::addressof(cache_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create pipeline cache!"};
+    }
+}
+
+std::span<const std::byte> pipeline_cache::validate_(
+    std::span<const std::byte> file)
+{
+    pipeline_cache_header header;
+    if (file.size() < sizeof(header))
+    {
+        return {};
+    }
+    std::memcpy(std::addressof(header), file.data(), sizeof(header));
+    auto data = file.subspan(sizeof(header));
+    if (header.magic != pipeline_cache_magic or
+        header.version != pipeline_cache_version or
+        header.vendor_id != properties_.vendorID or
+        header.device_id != properties_.deviceID or
+        header.driver_version != properties_.driverVersion or
+        std::memcmp(header.uuid.data(),
+                    properties_.pipelineCacheUUID,
+                    VK_UUID_SIZE) != 0 or
+        header.data_size != data.size())
+    {
+        wf::log(fmt::format("pipeline cache {} is stale, starting cold",
+                            path_.string()));
+        return {};
+    }
+
+    // the driver's own header has to agree as well
+    VkPipelineCacheHeaderVersionOne driver_header;
+    if (data.size() < sizeof(driver_header))
+    {
+        return {};
+    }
+    std::memcpy(
+        std::addressof(driver_header), data.data(), sizeof(driver_header));
+    if (driver_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE or
+        std::memcmp(driver_header.pipelineCacheUUID,
+                    properties_.pipelineCacheUUID,
+                    VK_UUID_SIZE) != 0)
+    {
+        return {};
+    }
+    return data;
+}
+
+void pipeline_cache::save()
+{
+    size_t size = 0;
+    if (vkGetPipelineCacheData(
+            device_, cache_, std::addressof(size), nullptr) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to query pipeline cache size!"};
+    }
+    std::vector<std::byte> data(size);
+    if (vkGetPipelineCacheData(
+            device_, cache_, std::addressof(size), data.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to read pipeline cache!"};
+    }
+    data.resize(size);
+
+    pipeline_cache_header header{};
+    header.magic          = pipeline_cache_magic;
+    header.version        = pipeline_cache_version;
+    header.vendor_id      = properties_.vendorID;
+    header.device_id      = properties_.deviceID;
+    header.driver_version = properties_.driverVersion;
+    header.data_size      = data.size();
+    std::memcpy(
+        header.uuid.data(), properties_.pipelineCacheUUID, VK_UUID_SIZE);
+
+    // written aside and renamed over the old file so a crash mid write never
+    // leaves a truncated cache behind
+    auto temporary = path_;
+    temporary += ".tmp";
+    {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+        file.write(reinterpret_cast<const char*>(std::addressof(header)),
+                   sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()),
+                   to<std::streamsize>(data.size()));
+    }
+    std::filesystem::rename(temporary, path_);
+}
+
+pipeline_cache::~pipeline_cache()
+{
+    try
+    {
+        save();
+    }
+    catch (const std::exception& e)
+    {
+        wf::log(fmt::format("could not save pipeline cache {}: {}",
+                            path_.string(),
+                            e.what()));
+    }
+    vkDestroyPipelineCache(device_, cache_, nullptr);
+}
+
+pipeline_cache::operator VkPipelineCache() const
+{
+    return cache_;
+}
+
+bool pipeline_cache::warm() const
+{
+    return warm_;
+}
+} // namespace wf::vk
@@ -0,0 +1,58 @@
+module;
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vulkan/vulkan.h>
+
+export module vk:pipeline_cache;
+
+import utils;
+
+namespace wf::vk
+{
+// prepended to the driver's blob, vulkan's own header lacks the driver
+// version and a cache from an older driver is at best silently ignored
+struct pipeline_cache_header
+{
+    std::array<char, 4> magic;
+    uint32_t version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    std::array<uint8_t, VK_UUID_SIZE> uuid;
+    uint64_t data_size;
+};
+static_assert(sizeof(pipeline_cache_header) == 48);
+
+constexpr std::array<char, 4> pipeline_cache_magic = {'W', 'F', 'P', 'C'};
+constexpr uint32_t pipeline_cache_version          = 1;
+
+// owns the VkPipelineCache every pipeline is created through, seeded from
+// disk when the stored blob matches this device and driver and written
+// back atomically on destruction
+class pipeline_cache : non_copyable
+{
+  private:
+    VkDevice device_;
+    VkPhysicalDeviceProperties properties_;
+    std::filesystem::path path_;
+    VkPipelineCache cache_ = VK_NULL_HANDLE;
+    bool warm_             = false;
+
+    std::span<const std::byte> validate_(std::span<const std::byte> file);
+
+  public:
+    pipeline_cache(VkDevice device,
+                   VkPhysicalDevice physical_device,
+                   std::filesystem::path path);
+    ~pipeline_cache();
+
+    void save();
+    operator VkPipelineCache() const;
+
+    // whether the cache was seeded from a valid file on disk
+    bool warm() const;
+};
+} // namespace wf::vk
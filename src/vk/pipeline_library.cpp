@@ -0,0 +1,328 @@
+module;
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fmt/format.h>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+module vk;
+
+namespace wf::vk
+{
+namespace
+{
+template <typename T> void append(std::string& key, const T& value)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    key.append(reinterpret_cast<const char*>(std::addressof(value)),
+               sizeof(value));
+}
+
+void append(std::string& key, std::string_view text)
+{
+    append(key, text.size());
+    key.append(text);
+}
+
+template <typename T> void append(std::string& key, const std::vector<T>& list)
+{
+    append(key, list.size());
+    for (const auto& value : list)
+    {
+        append(key, value);
+    }
+}
+} // namespace
+
+std::string pipeline_description::key() const
+{
+    std::string result;
+    append(result, std::string_view{vertex_shader});
+    append(result, std::string_view{fragment_shader});
+    append(result, vertex.bindings);
+    append(result, vertex.attributes);
+    append(result, constants);
+    append(result, topology);
+    append(result, cull_mode);
+    append(result, blend);
+    append(result, depth_test);
+    // without the test vulkan writes no depth, so both keys are one pipeline
+    append(result, depth_test and depth_write);
+    return result;
+}
+
+pipeline_library::pipeline_library(VkDevice device,
+                                   VkPipelineCache cache,
+                                   VkPipelineLayout layout,
+                                   VkRenderPass render_pass)
+    : device_{device}, cache_{cache}, layout_{layout},
+      render_pass_{render_pass}
+{
+}
+
+pipeline_library::~pipeline_library()
+{
+    for (auto pipeline : pipelines_)
+    {
+        vkDestroyPipeline(device_, pipeline, nullptr);
+    }
+}
+
+pipeline_id pipeline_library::request(const pipeline_description& description)
+{
+    auto [it, inserted] =
+        ids_.try_emplace(description.key(), to<pipeline_id>(ids_.size()));
+    if (inserted)
+    {
+        descriptions_.push_back(description);
+    }
+    return it->second;
+}
+
+void pipeline_library::compile(uint32_t workers)
+{
+    auto first = to<uint32_t>(pipelines_.size());
+    auto count = to<uint32_t>(descriptions_.size()) - first;
+    if (count == 0)
+    {
+        return;
+    }
+
+    // every shader is loaded once, however many permutations share it
+    std::unordered_map<std::string, std::unique_ptr<vk_shader_module>> modules;
+    for (auto i = first; i < first + count; ++i)
+    {
+        for (const auto& path : {descriptions_[i].vertex_shader,
+                                 descriptions_[i].fragment_shader})
+        {
+            if (not modules.contains(path))
+            {
+                // spir-v is read straight from the mapping, which is page
+                // aligned
+                mapped_file code{path};
+                modules.emplace(
+                    path,
+                    std::make_unique<vk_shader_module>(device_, code.bytes()));
+            }
+        }
+    }
+
+    // the cache is internally synchronized, so workers only share it
+    pipelines_.resize(descriptions_.size(), VK_NULL_HANDLE);
+    std::atomic<bool> failed{false};
+    jobs::parallel_ranges(count, workers, [&](uint32_t begin, uint32_t end) {
+        for (auto i = first + begin; i < first + end; ++i)
+        {
+            const auto& description = descriptions_[i];
+            try
+            {
+                pipelines_[i] =
+                    create_(description,
+                            modules.at(description.vertex_shader)->module,
+                            modules.at(description.fragment_shader)->module);
+            }
+            catch (const std::exception& e)
+            {
+                wf::log(fmt::format("{} + {}: {}",
+                                    description.vertex_shader,
+                                    description.fragment_shader,
+                                    e.what()));
+                failed = true;
+            }
+        }
+    });
+    if (failed)
+    {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+}
+
+VkPipeline pipeline_library::get(pipeline_id id) const
+{
+    return pipelines_[id];
+}
+
+size_t pipeline_library::size() const
+{
+    return pipelines_.size();
+}
+
+VkPipeline
+pipeline_library::create_(const pipeline_description& description,
+                          VkShaderModule vertex_module,
+                          VkShaderModule fragment_module) const
+{
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint32_t> values;
+    for (const auto& constant : description.constants)
+    {
+        entries.push_back({constant.id,
+                           to<uint32_t>(values.size() * sizeof(uint32_t)),
+                           sizeof(uint32_t)});
+        values.push_back(constant.value);
+    }
+
+    // ids a stage does not declare are ignored, so both share the constants
+    VkSpecializationInfo specialization{};
+    specialization.mapEntryCount = to<uint32_t>(entries.size());
+    specialization.pMapEntries   = entries.data();
+    specialization.dataSize      = values.size() * sizeof(uint32_t);
+    specialization.pData         = values.data();
+
+    VkPipelineShaderStageCreateInfo vert_shader_stage_info{};
+    vert_shader_stage_info.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vert_shader_stage_info.stage  = VK_SHADER_STAGE_VERTEX_BIT;
+    vert_shader_stage_info.module = vertex_module;
+    vert_shader_stage_info.pName  = "main";
+    vert_shader_stage_info.pSpecializationInfo =
+        std::addressof(specialization);
+
+    VkPipelineShaderStageCreateInfo frag_shader_stage_info{};
+    frag_shader_stage_info.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    frag_shader_stage_info.stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+    frag_shader_stage_info.module = fragment_module;
+    frag_shader_stage_info.pName  = "main";
+    frag_shader_stage_info.pSpecializationInfo =
+        std::addressof(specialization);
+
+    std::array shader_stages = {vert_shader_stage_info, frag_shader_stage_info};
+
+    VkPipelineVertexInputStateCreateInfo vertex_input_info{};
+    vertex_input_info.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertex_input_info.vertexBindingDescriptionCount =
+        to<uint32_t>(description.vertex.bindings.size());
+    vertex_input_info.pVertexBindingDescriptions =
+        description.vertex.bindings.data();
+    vertex_input_info.vertexAttributeDescriptionCount =
+        to<uint32_t>(description.vertex.attributes.size());
+    vertex_input_info.pVertexAttributeDescriptions =
+        description.vertex.attributes.data();
+
+    std::array dynamic_states = {VK_DYNAMIC_STATE_VIEWPORT,
+                                 VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamic_state{};
+    dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_state.dynamicStateCount = to<uint32_t>(dynamic_states.size());
+    dynamic_state.pDynamicStates    = dynamic_states.data();
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+    input_assembly.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly.topology               = description.topology;
+    input_assembly.primitiveRestartEnable = VK_FALSE;
+
+    // viewport and scissor are dynamic, only their count is baked
+    VkPipelineViewportStateCreateInfo viewport_state{};
+    viewport_state.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state.viewportCount = 1;
+    viewport_state.scissorCount  = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable        = VK_FALSE;
+    rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth               = 1.f;
+    rasterizer.cullMode                = description.cull_mode;
+    rasterizer.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable         = VK_FALSE;
+    rasterizer.depthBiasConstantFactor = 0.f;
+    rasterizer.depthBiasClamp          = 0.f;
+    rasterizer.depthBiasSlopeFactor    = 0.f;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable   = VK_FALSE;
+    multisampling.rasterizationSamples  = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.minSampleShading      = 1.0;
+    multisampling.pSampleMask           = nullptr;
+    multisampling.alphaToCoverageEnable = VK_FALSE;
+    multisampling.alphaToOneEnable      = VK_FALSE;
+
+    VkPipelineDepthStencilStateCreateInfo depth_stencil{};
+    depth_stencil.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil.depthTestEnable  = description.depth_test;
+    depth_stencil.depthWriteEnable =
+        description.depth_test and description.depth_write;
+    depth_stencil.depthCompareOp   = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment{};
+    color_blend_attachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    if (description.blend == blend_mode::alpha)
+    {
+        color_blend_attachment.blendEnable = VK_TRUE;
+        color_blend_attachment.srcColorBlendFactor =
+            VK_BLEND_FACTOR_SRC_ALPHA;
+        color_blend_attachment.dstColorBlendFactor =
+            VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        color_blend_attachment.dstAlphaBlendFactor =
+            VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    }
+    else
+    {
+        color_blend_attachment.blendEnable         = VK_FALSE;
+        color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+        color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    }
+    color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo color_blending{};
+    color_blending.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blending.logicOpEnable   = VK_FALSE;
+    color_blending.logicOp         = VK_LOGIC_OP_COPY;
+    color_blending.attachmentCount = 1;
+    color_blending.pAttachments    = std::addressof(color_blend_attachment);
+
+    VkGraphicsPipelineCreateInfo pipeline_info{};
+    pipeline_info.sType      = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_info.stageCount = to<uint32_t>(shader_stages.size());
+    pipeline_info.pStages    = shader_stages.data();
+    pipeline_info.pVertexInputState   = std::addressof(vertex_input_info);
+    pipeline_info.pInputAssemblyState = std::addressof(input_assembly);
+    pipeline_info.pViewportState      = std::addressof(viewport_state);
+    pipeline_info.pRasterizationState = std::addressof(rasterizer);
+    pipeline_info.pMultisampleState   = std::addressof(multisampling);
+    pipeline_info.pDepthStencilState  = std::addressof(depth_stencil);
+    pipeline_info.pColorBlendState    = std::addressof(color_blending);
+    pipeline_info.pDynamicState       = std::addressof(dynamic_state);
+    pipeline_info.layout              = layout_;
+    pipeline_info.renderPass          = render_pass_;
+    pipeline_info.subpass             = 0;
+    pipeline_info.basePipelineHandle  = VK_NULL_HANDLE;
+    pipeline_info.basePipelineIndex   = -1;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(device_,
+                                  cache_,
+                                  1,
+                                  std::addressof(pipeline_info),
+                                  nullptr,
+                                  std::addressof(pipeline)) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+    return pipeline;
+}
+} // namespace wf::vk
@@ -0,0 +1,121 @@
+module;
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+export module vk:pipeline_library;
+
+import utils;
+
+namespace wf::vk
+{
+struct vk_shader_module
+{
+    VkShaderModule module;
+    VkDevice device;
+    vk_shader_module(VkDevice device, std::span<const std::byte> code)
+        : device{device}
+    {
+        VkShaderModuleCreateInfo create_info{};
+        create_info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        create_info.codeSize = code.size();
+        create_info.pCode    = reinterpret_cast<const uint32_t*>(code.data());
+
+        if (vkCreateShaderModule(device,
+                                 std::addressof(create_info),
+                                 nullptr,
+                                 std::addressof(module)) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create shader module!");
+        }
+    }
+
+    vk_shader_module(const vk_shader_module&)            = delete;
+    vk_shader_module& operator=(const vk_shader_module&) = delete;
+
+    ~vk_shader_module()
+    {
+        vkDestroyShaderModule(device, module, nullptr);
+    }
+};
+
+export enum class blend_mode
+{
+    opaque,
+    alpha
+};
+
+export struct vertex_layout
+{
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+};
+
+// 32 bit constant handed to every stage declaring its constant_id
+export struct specialization_constant
+{
+    uint32_t id;
+    uint32_t value;
+};
+
+// everything distinguishing one graphics pipeline from another, descriptions
+// with equal keys share a single compiled pipeline
+export struct pipeline_description
+{
+    std::string vertex_shader;
+    std::string fragment_shader;
+    vertex_layout vertex;
+    std::vector<specialization_constant> constants;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkCullModeFlags cull_mode    = VK_CULL_MODE_BACK_BIT;
+    blend_mode blend             = blend_mode::opaque;
+    // against the render pass depth attachment, writes only happen where
+    // the test runs
+    bool depth_test  = false;
+    bool depth_write = false;
+
+    // canonical byte string of the state above, hashed by the library
+    std::string key() const;
+};
+
+export using pipeline_id = uint32_t;
+
+// graphics pipelines sharing one layout and render pass, requested up front
+// and compiled together on worker threads through the pipeline cache
+export class pipeline_library : non_copyable
+{
+  private:
+    VkDevice device_;
+    VkPipelineCache cache_;
+    VkPipelineLayout layout_;
+    VkRenderPass render_pass_;
+    std::vector<pipeline_description> descriptions_;
+    std::vector<VkPipeline> pipelines_;
+    std::unordered_map<std::string, pipeline_id> ids_;
+
+    VkPipeline create_(const pipeline_description& description,
+                       VkShaderModule vertex_module,
+                       VkShaderModule fragment_module) const;
+
+  public:
+    pipeline_library(VkDevice device,
+                     VkPipelineCache cache,
+                     VkPipelineLayout layout,
+                     VkRenderPass render_pass);
+    ~pipeline_library();
+
+    // an equal description requested before returns its existing id
+    pipeline_id request(const pipeline_description& description);
+
+    // compiles every pipeline requested since the last call
+    void compile(uint32_t workers);
+
+    VkPipeline get(pipeline_id id) const;
+    size_t size() const;
+};
+} // namespace wf::vk
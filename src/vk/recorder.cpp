@@ -0,0 +1,125 @@
+module;
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+module vk;
+
+namespace wf::vk
+{
+parallel_recorder::parallel_recorder(VkDevice device,
+                                     uint32_t queue_family,
+                                     uint32_t frame_count,
+                                     uint32_t workers)
+    : device_{device}, workers_{std::max(workers, 1u)},
+      pools_(size_t{frame_count} * workers_, VK_NULL_HANDLE),
+      command_buffers_(pools_.size(), VK_NULL_HANDLE)
+{
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+
+    for (size_t i = 0; i < pools_.size(); ++i)
+    {
+        if (vkCreateCommandPool(device_,
+                                std::addressof(pool_info),
+                                nullptr,
+                                std::addressof(pools_[i])) != VK_SUCCESS)
+        {
+            throw std::runtime_error{"failed to create recording pool!"};
+        }
+
+        VkCommandBufferAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.commandPool        = pools_[i];
+        alloc_info.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        alloc_info.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(device_,
+                                     std::addressof(alloc_info),
+                                     std::addressof(command_buffers_[i])) !=
+            VK_SUCCESS)
+        {
+            throw std::runtime_error{
+                "failed to allocate secondary command buffers!"};
+        }
+    }
+}
+
+parallel_recorder::~parallel_recorder()
+{
+    // destroying a pool frees the buffers allocated from it
+    for (auto pool : pools_)
+    {
+        vkDestroyCommandPool(device_, pool, nullptr);
+    }
+}
+
+uint32_t parallel_recorder::workers() const
+{
+    return workers_;
+}
+
+std::span<const VkCommandBuffer> parallel_recorder::record(
+    uint32_t frame,
+    const VkCommandBufferInheritanceInfo& inheritance,
+    uint32_t partitions,
+    const partition_recorder& record_partition)
+{
+    partitions = std::clamp(partitions, 1u, workers_);
+    auto first = size_t{frame} * workers_;
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                       VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = std::addressof(inheritance);
+
+    // one partition per worker so each pool is touched by a single thread,
+    // failures are carried back to the caller instead of ending the thread
+    std::vector<std::exception_ptr> errors(partitions);
+    auto record_one = [&](uint32_t partition) {
+        auto pool           = pools_[first + partition];
+        auto command_buffer = command_buffers_[first + partition];
+        vkResetCommandPool(device_, pool, 0);
+        if (vkBeginCommandBuffer(command_buffer,
+                                 std::addressof(begin_info)) != VK_SUCCESS)
+        {
+            throw std::runtime_error{
+                "failed to begin secondary command buffer!"};
+        }
+        record_partition(command_buffer, partition);
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error{
+                "failed to record secondary command buffer!"};
+        }
+    };
+    jobs::parallel_ranges(
+        partitions, partitions, [&](uint32_t begin, uint32_t end) {
+            for (auto partition = begin; partition < end; ++partition)
+            {
+                try
+                {
+                    record_one(partition);
+                }
+                catch (...)
+                {
+                    errors[partition] = std::current_exception();
+                }
+            }
+        });
+
+    for (const auto& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    return std::span{command_buffers_}.subspan(first, partitions);
+}
+} // namespace wf::vk
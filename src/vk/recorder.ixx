@@ -0,0 +1,47 @@
+module;
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+export module vk:recorder;
+
+import utils;
+
+namespace wf::vk
+{
+using partition_recorder =
+    std::function<void(VkCommandBuffer command_buffer, uint32_t partition)>;
+
+// records one render pass as secondary command buffers on several threads,
+// a command pool must only be used by one thread at a time so every worker
+// owns a pool per frame in flight, reset whole once that frame's fence
+// signaled instead of freeing its buffers one by one
+class parallel_recorder : non_copyable
+{
+  private:
+    VkDevice device_;
+    uint32_t workers_;
+    // indexed by frame * workers_ + worker
+    std::vector<VkCommandPool> pools_;
+    std::vector<VkCommandBuffer> command_buffers_;
+
+  public:
+    parallel_recorder(VkDevice device,
+                      uint32_t queue_family,
+                      uint32_t frame_count,
+                      uint32_t workers);
+    ~parallel_recorder();
+
+    uint32_t workers() const;
+
+    // records partitions <= workers() secondaries continuing the inherited
+    // render pass, returned in partition order for vkCmdExecuteCommands
+    std::span<const VkCommandBuffer> record(
+        uint32_t frame,
+        const VkCommandBufferInheritanceInfo& inheritance,
+        uint32_t partitions,
+        const partition_recorder& record_partition);
+};
+} // namespace wf::vk
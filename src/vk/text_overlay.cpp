@@ -0,0 +1,397 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vulkan/vulkan.h>
+module vk;
+
+import text;
+
+namespace wf::vk
+{
+namespace
+{
+// distance of the first line from the top left corner, in pixels
+constexpr float text_margin = 8.f;
+// rgba8 as the unorm8x4 attribute reads it, red in the lowest byte
+constexpr uint32_t text_color   = 0xffffffff;
+constexpr uint32_t shadow_color = 0xc0000000;
+} // namespace
+
+text_overlay::text_overlay(VkDevice device,
+                           device_allocator& allocator,
+                           VkPipelineCache cache,
+                           VkRenderPass render_pass,
+                           const std::filesystem::path& font,
+                           uint32_t pixel_size)
+    : device_{device}, allocator_{allocator}, font_{font},
+      pixel_size_{pixel_size}
+{
+    create_atlas_();
+    create_descriptors_();
+    create_pipeline_(cache, render_pass);
+}
+
+text_overlay::~text_overlay()
+{
+    pipelines_.reset();
+    vkDestroyPipelineLayout(device_, layout_, nullptr);
+    vkDestroyDescriptorPool(device_, pool_, nullptr);
+    vkDestroyDescriptorSetLayout(device_, set_layout_, nullptr);
+    vkDestroySampler(device_, sampler_, nullptr);
+    vkDestroyImageView(device_, atlas_view_, nullptr);
+    vkDestroyImage(device_, atlas_, nullptr);
+    allocator_.free(atlas_allocation_);
+}
+
+void text_overlay::create_atlas_()
+{
+    auto size = font_.atlas_size();
+
+    VkImageCreateInfo image_info{};
+    image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType     = VK_IMAGE_TYPE_2D;
+    image_info.format        = VK_FORMAT_R8_UNORM;
+    image_info.extent        = {size, size, 1};
+    image_info.mipLevels     = 1;
+    image_info.arrayLayers   = 1;
+    image_info.samples       = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                       VK_IMAGE_USAGE_SAMPLED_BIT;
+    image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(device_,
+                      std::addressof(image_info),
+                      nullptr,
+                      std::addressof(atlas_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create glyph atlas!"};
+    }
+
+    // buddy ranges are aligned to their own power of two size, so no buffer
+    // shares a granularity page with the image
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(
+        device_, atlas_, std::addressof(requirements));
+    atlas_allocation_ =
+        allocator_.allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    vkBindImageMemory(
+        device_, atlas_, atlas_allocation_.memory, atlas_allocation_.offset);
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image    = atlas_;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format   = VK_FORMAT_R8_UNORM;
+    view_info.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.baseMipLevel   = 0;
+    view_info.subresourceRange.levelCount     = 1;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount     = 1;
+    if (vkCreateImageView(device_,
+                          std::addressof(view_info),
+                          nullptr,
+                          std::addressof(atlas_view_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create glyph atlas view!"};
+    }
+
+    VkSamplerCreateInfo sampler_info{};
+    sampler_info.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter    = VK_FILTER_LINEAR;
+    sampler_info.minFilter    = VK_FILTER_LINEAR;
+    sampler_info.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.maxLod       = 0.f;
+    if (vkCreateSampler(device_,
+                        std::addressof(sampler_info),
+                        nullptr,
+                        std::addressof(sampler_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create glyph sampler!"};
+    }
+}
+
+void text_overlay::create_descriptors_()
+{
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding         = 0;
+    binding.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = 1;
+    layout_info.pBindings    = std::addressof(binding);
+    if (vkCreateDescriptorSetLayout(device_,
+                                    std::addressof(layout_info),
+                                    nullptr,
+                                    std::addressof(set_layout_)) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create text set layout!"};
+    }
+
+    VkDescriptorPoolSize pool_size{};
+    pool_size.type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pool_size.descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes    = std::addressof(pool_size);
+    pool_info.maxSets       = 1;
+    if (vkCreateDescriptorPool(device_,
+                               std::addressof(pool_info),
+                               nullptr,
+                               std::addressof(pool_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create text descriptor pool!"};
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool     = pool_;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts        = std::addressof(set_layout_);
+    if (vkAllocateDescriptorSets(
+            device_, std::addressof(alloc_info), std::addressof(set_)) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to allocate text descriptor set!"};
+    }
+
+    // one set for every frame, the atlas only changes between draws
+    VkDescriptorImageInfo image_info{};
+    image_info.sampler     = sampler_;
+    image_info.imageView   = atlas_view_;
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write{};
+    write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet          = set_;
+    write.dstBinding      = 0;
+    write.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = 1;
+    write.pImageInfo      = std::addressof(image_info);
+    vkUpdateDescriptorSets(device_, 1, std::addressof(write), 0, nullptr);
+}
+
+void text_overlay::create_pipeline_(VkPipelineCache cache,
+                                    VkRenderPass render_pass)
+{
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push_constant_range.offset     = 0;
+    push_constant_range.size       = sizeof(text_constants);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts    = std::addressof(set_layout_);
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges =
+        std::addressof(push_constant_range);
+    if (vkCreatePipelineLayout(device_,
+                               std::addressof(pipeline_layout_info),
+                               nullptr,
+                               std::addressof(layout_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create text pipeline layout!"};
+    }
+
+    pipelines_.emplace(device_, cache, layout_, render_pass);
+    pipeline_description description{
+        .vertex_shader   = "../shaders/text.vert.spv",
+        .fragment_shader = "../shaders/text.frag.spv",
+        .vertex          = text_format::layout(),
+        .topology        = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+        .cull_mode       = VK_CULL_MODE_NONE,
+        .blend           = blend_mode::alpha,
+    };
+    pipeline_ = pipelines_->request(description);
+    pipelines_->compile(1);
+}
+
+void text_overlay::set_text(std::string_view text)
+{
+    if (text != text_)
+    {
+        text_         = text;
+        text_changed_ = true;
+    }
+}
+
+void text_overlay::prepare(frame_ring& ring)
+{
+    if (text_changed_)
+    {
+        // a shadow one pixel down and right keeps the text readable over
+        // the bright parts of the ocean
+        instances_.clear();
+        text::layout(font_,
+                     text_,
+                     {text_margin + 1.f, text_margin + 1.f},
+                     pixel_size_,
+                     shadow_color,
+                     instances_);
+        text::layout(font_,
+                     text_,
+                     {text_margin, text_margin},
+                     pixel_size_,
+                     text_color,
+                     instances_);
+        instances_.resize(std::min<size_t>(instances_.size(), max_glyphs));
+        text_changed_ = false;
+    }
+    if (not instances_.empty())
+    {
+        instance_offset_ = ring.push(std::span{instances_}).offset;
+    }
+
+    // the first copy covers the whole atlas, defining what was undefined
+    auto size = font_.atlas_size();
+    auto rows = font_.take_dirty_rows();
+    if (not atlas_written_)
+    {
+        rows = text::row_range{0, size};
+    }
+    pending_copy_.reset();
+    if (rows)
+    {
+        auto bytes = font_.atlas().subspan(size_t{rows->first} * size,
+                                           size_t{rows->count} * size);
+        auto staging = ring.allocate(bytes.size());
+        std::memcpy(staging.data.data(), bytes.data(), bytes.size());
+        pending_copy_ = atlas_copy{staging.offset, *rows};
+    }
+}
+
+void text_overlay::record_upload(VkCommandBuffer command_buffer,
+                                 VkBuffer ring_buffer)
+{
+    if (not pending_copy_)
+    {
+        return;
+    }
+
+    auto barrier = [&](VkImageLayout old_layout,
+                       VkImageLayout new_layout,
+                       VkPipelineStageFlags src_stage,
+                       VkAccessFlags src_access,
+                       VkPipelineStageFlags dst_stage,
+                       VkAccessFlags dst_access) {
+        VkImageMemoryBarrier image_barrier{};
+        image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        image_barrier.srcAccessMask       = src_access;
+        image_barrier.dstAccessMask       = dst_access;
+        image_barrier.oldLayout           = old_layout;
+        image_barrier.newLayout           = new_layout;
+        image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.image               = atlas_;
+        image_barrier.subresourceRange    = {
+            VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(command_buffer,
+                             src_stage,
+                             dst_stage,
+                             0,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr,
+                             1,
+                             std::addressof(image_barrier));
+    };
+
+    // frames still in flight may sample the atlas, the queue orders them
+    // ahead of this copy
+    barrier(atlas_written_ ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                           : VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    auto size = font_.atlas_size();
+    VkBufferImageCopy region{};
+    region.bufferOffset      = pending_copy_->offset;
+    region.bufferRowLength   = size;
+    region.bufferImageHeight = pending_copy_->rows.count;
+    region.imageSubresource  = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageOffset       = {0, to<int32_t>(pending_copy_->rows.first), 0};
+    region.imageExtent       = {size, pending_copy_->rows.count, 1};
+    vkCmdCopyBufferToImage(command_buffer,
+                           ring_buffer,
+                           atlas_,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1,
+                           std::addressof(region));
+
+    barrier(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT);
+    atlas_written_ = true;
+    pending_copy_.reset();
+}
+
+void text_overlay::record_draw(VkCommandBuffer command_buffer,
+                               VkBuffer ring_buffer,
+                               VkExtent2D extent) const
+{
+    if (instances_.empty() or not atlas_written_)
+    {
+        return;
+    }
+    vkCmdBindPipeline(command_buffer,
+                      VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      pipelines_->get(pipeline_));
+    vkCmdBindDescriptorSets(command_buffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            layout_,
+                            0,
+                            1,
+                            std::addressof(set_),
+                            0,
+                            nullptr);
+    text_constants constants{
+        .scale = {2.f / static_cast<float>(extent.width),
+                  2.f / static_cast<float>(extent.height)}};
+    vkCmdPushConstants(command_buffer,
+                       layout_,
+                       VK_SHADER_STAGE_VERTEX_BIT,
+                       0,
+                       sizeof(constants),
+                       std::addressof(constants));
+    vkCmdBindVertexBuffers(command_buffer,
+                           0,
+                           1,
+                           std::addressof(ring_buffer),
+                           std::addressof(instance_offset_));
+    vkCmdDraw(command_buffer, 4, to<uint32_t>(instances_.size()), 0, 0);
+}
+
+VkDeviceSize text_overlay::frame_bytes() const
+{
+    auto size = VkDeviceSize{font_.atlas_size()};
+    return size * size + sizeof(text::glyph_instance) * max_glyphs;
+}
+
+uint32_t text_overlay::glyph_count() const
+{
+    return to<uint32_t>(instances_.size());
+}
+} // namespace wf::vk
@@ -0,0 +1,103 @@
+module;
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+export module vk:text_overlay;
+
+import text;
+import utils;
+import :allocator;
+import :frame_ring;
+import :pipeline_library;
+import :vertex_format;
+
+namespace wf::vk
+{
+// one quad per text::glyph_instance, the corners come from the vertex index
+using text_format = vertex_format<vertex_stream<VK_VERTEX_INPUT_RATE_INSTANCE,
+                                                encoding::float32x4,
+                                                encoding::float32x4,
+                                                encoding::unorm8x4>>;
+static_assert(text_format::stream<0>::stride == sizeof(text::glyph_instance));
+
+// push constants of shaders/text.vert, pixels to normalized device units
+struct text_constants
+{
+    float scale[2];
+};
+
+// screen space text drawn over the frame in a single instanced call, glyphs
+// are sampled from one atlas image which is patched from the frame ring
+// whenever layout rasterized new ones. the text is only laid out again when
+// it changes, otherwise a frame costs one copy of the cached instances
+class text_overlay : non_copyable
+{
+  private:
+    struct atlas_copy
+    {
+        VkDeviceSize offset;
+        text::row_range rows;
+    };
+
+    VkDevice device_;
+    device_allocator& allocator_;
+    text::font font_;
+    uint32_t pixel_size_;
+
+    VkImage atlas_ = VK_NULL_HANDLE;
+    allocation atlas_allocation_;
+    VkImageView atlas_view_ = VK_NULL_HANDLE;
+    VkSampler sampler_      = VK_NULL_HANDLE;
+    // still undefined until the first copy lands in it
+    bool atlas_written_ = false;
+
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkDescriptorPool pool_            = VK_NULL_HANDLE;
+    VkDescriptorSet set_              = VK_NULL_HANDLE;
+    VkPipelineLayout layout_          = VK_NULL_HANDLE;
+    std::optional<pipeline_library> pipelines_;
+    pipeline_id pipeline_ = 0;
+
+    std::string text_;
+    bool text_changed_ = false;
+    std::vector<text::glyph_instance> instances_;
+    VkDeviceSize instance_offset_ = 0;
+    std::optional<atlas_copy> pending_copy_;
+
+    void create_atlas_();
+    void create_descriptors_();
+    void create_pipeline_(VkPipelineCache cache, VkRenderPass render_pass);
+
+  public:
+    // quads a frame draws at most, further glyphs are dropped
+    static constexpr uint32_t max_glyphs = 4096;
+
+    text_overlay(VkDevice device,
+                 device_allocator& allocator,
+                 VkPipelineCache cache,
+                 VkRenderPass render_pass,
+                 const std::filesystem::path& font,
+                 uint32_t pixel_size);
+    ~text_overlay();
+
+    // lines break on '\n', laid out from the top left corner
+    void set_text(std::string_view text);
+
+    // writes the frame's instances and any new atlas rows into the ring
+    void prepare(frame_ring& ring);
+    // records outside a render pass, ahead of the draw
+    void record_upload(VkCommandBuffer command_buffer, VkBuffer ring_buffer);
+    void record_draw(VkCommandBuffer command_buffer,
+                     VkBuffer ring_buffer,
+                     VkExtent2D extent) const;
+
+    // ring space prepare may take in a frame
+    VkDeviceSize frame_bytes() const;
+    uint32_t glyph_count() const;
+};
+} // namespace wf::vk
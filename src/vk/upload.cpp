@@ -0,0 +1,266 @@
+module;
+#include <algorithm>
+#include <cstring>
+#include <ranges>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+module vk;
+
+namespace wf::vk
+{
+VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uploader::uploader(VkDevice device,
+                   device_allocator& allocator,
+                   VkQueue queue,
+                   uint32_t queue_family,
+                   VkDeviceSize capacity)
+    : device_{device}, allocator_{allocator}, queue_{queue},
+      capacity_{align_up(capacity, staging_alignment)}
+{
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                      VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+    if (vkCreateCommandPool(device_,
+                            std::addressof(pool_info),
+                            nullptr,
+                            std::addressof(command_pool_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+
+    VkSemaphoreTypeCreateInfo timeline_info{};
+    timeline_info.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timeline_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timeline_info.initialValue  = 0;
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = std::addressof(timeline_info);
+    if (vkCreateSemaphore(device_,
+                          std::addressof(semaphore_info),
+                          nullptr,
+                          std::addressof(timeline_semaphore_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create upload timeline semaphore!");
+    }
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size        = capacity_;
+    buffer_info.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(device_,
+                       std::addressof(buffer_info),
+                       nullptr,
+                       std::addressof(staging_buffer_)) != VK_SUCCESS)
+    {
+        throw std::runtime_error{"failed to create staging buffer!"};
+    }
+
+    VkMemoryRequirements mem_requirements;
+    vkGetBufferMemoryRequirements(
+        device_, staging_buffer_, std::addressof(mem_requirements));
+    staging_allocation_ =
+        allocator_.allocate(mem_requirements,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkBindBufferMemory(device_,
+                       staging_buffer_,
+                       staging_allocation_.memory,
+                       staging_allocation_.offset);
+}
+
+uploader::~uploader()
+{
+    if (submitted_value_ > 0)
+    {
+        VkSemaphoreWaitInfo wait_info{};
+        wait_info.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores    = std::addressof(timeline_semaphore_);
+        wait_info.pValues        = std::addressof(submitted_value_);
+        vkWaitSemaphores(device_, std::addressof(wait_info), UINT64_MAX);
+    }
+    vkDestroyBuffer(device_, staging_buffer_, nullptr);
+    allocator_.free(staging_allocation_);
+    vkDestroySemaphore(device_, timeline_semaphore_, nullptr);
+    vkDestroyCommandPool(device_, command_pool_, nullptr);
+}
+
+void uploader::collect_()
+{
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(
+        device_, timeline_semaphore_, std::addressof(completed));
+    while (not in_flight_.empty() and
+           in_flight_.front().timeline_value <= completed)
+    {
+        tail_ = in_flight_.front().ring_end;
+        free_command_buffers_.push_back(in_flight_.front().command_buffer);
+        in_flight_.pop_front();
+    }
+    if (in_flight_.empty() and pending_.empty())
+    {
+        tail_ = head_;
+    }
+}
+
+void uploader::wait_for_space_(VkDeviceSize size)
+{
+    collect_();
+    while (capacity_ - (head_ - tail_) < size)
+    {
+        if (in_flight_.empty())
+        {
+            flush();
+        }
+        auto value = in_flight_.front().timeline_value;
+
+        VkSemaphoreWaitInfo wait_info{};
+        wait_info.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores    = std::addressof(timeline_semaphore_);
+        wait_info.pValues        = std::addressof(value);
+        vkWaitSemaphores(device_, std::addressof(wait_info), UINT64_MAX);
+        collect_();
+    }
+}
+
+VkCommandBuffer uploader::acquire_command_buffer_()
+{
+    if (not free_command_buffers_.empty())
+    {
+        auto command_buffer = free_command_buffers_.back();
+        free_command_buffers_.pop_back();
+        vkResetCommandBuffer(command_buffer, 0);
+        return command_buffer;
+    }
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandPool = command_pool_;
+    alloc_info.commandBufferCount = 1;
+
+    VkCommandBuffer command_buffer;
+    if (vkAllocateCommandBuffers(device_,
+                                 std::addressof(alloc_info),
+                                 std::addressof(command_buffer)) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+    return command_buffer;
+}
+
+void uploader::enqueue(std::span<const std::byte> data,
+                       VkBuffer destination,
+                       VkDeviceSize destination_offset)
+{
+    // bigger uploads are split so a single chunk always fits in the ring
+    auto max_chunk = capacity_ / 2;
+    while (not data.empty())
+    {
+        auto chunk   = std::min<VkDeviceSize>(data.size(), max_chunk);
+        auto aligned = align_up(chunk, staging_alignment);
+
+        auto position = head_ % capacity_;
+        auto padding  = position + aligned > capacity_ ? capacity_ - position
+                                                       : VkDeviceSize{0};
+        wait_for_space_(padding + aligned);
+        head_ += padding;
+        auto offset = head_ % capacity_;
+        head_ += aligned;
+
+        std::memcpy(staging_allocation_.mapped + offset, data.data(), chunk);
+        pending_.push_back({
+            .destination = destination,
+            .region      = {offset, destination_offset, chunk},
+        });
+
+        destination_offset += chunk;
+        data = data.subspan(chunk);
+    }
+}
+
+uint64_t uploader::flush()
+{
+    if (pending_.empty())
+    {
+        return submitted_value_;
+    }
+
+    auto command_buffer = acquire_command_buffer_();
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(command_buffer, std::addressof(begin_info));
+
+    std::ranges::stable_sort(pending_, {}, &pending_copy::destination);
+    std::vector<VkBufferCopy> regions;
+    for (auto it = std::begin(pending_); it != std::end(pending_);)
+    {
+        auto destination = it->destination;
+        regions.clear();
+        for (; it != std::end(pending_) and it->destination == destination;
+             ++it)
+        {
+            regions.push_back(it->region);
+        }
+        vkCmdCopyBuffer(command_buffer,
+                        staging_buffer_,
+                        destination,
+                        to<uint32_t>(regions.size()),
+                        regions.data());
+    }
+    vkEndCommandBuffer(command_buffer);
+
+    auto signal_value = submitted_value_ + 1;
+    VkTimelineSemaphoreSubmitInfo timeline_info{};
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.signalSemaphoreValueCount = 1;
+    timeline_info.pSignalSemaphoreValues    = std::addressof(signal_value);
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext                = std::addressof(timeline_info);
+    submit_info.commandBufferCount   = 1;
+    submit_info.pCommandBuffers      = std::addressof(command_buffer);
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores    = std::addressof(timeline_semaphore_);
+
+    if (vkQueueSubmit(queue_, 1, std::addressof(submit_info), VK_NULL_HANDLE) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit upload command buffer!");
+    }
+
+    submitted_value_ = signal_value;
+    in_flight_.push_back({command_buffer, submitted_value_, head_});
+    pending_.clear();
+    return submitted_value_;
+}
+
+VkSemaphore uploader::semaphore() const
+{
+    return timeline_semaphore_;
+}
+
+uint64_t uploader::submitted_value() const
+{
+    return submitted_value_;
+}
+
+bool uploader::is_complete(uint64_t value) const
+{
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(
+        device_, timeline_semaphore_, std::addressof(completed));
+    return completed >= value;
+}
+} // namespace wf::vk
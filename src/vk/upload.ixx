@@ -0,0 +1,80 @@
+module;
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+export module vk:upload;
+
+import utils;
+import :allocator;
+
+namespace wf::vk
+{
+constexpr VkDeviceSize default_staging_capacity = VkDeviceSize{32} << 20;
+constexpr VkDeviceSize staging_alignment        = 16;
+
+struct pending_copy
+{
+    VkBuffer destination;
+    VkBufferCopy region;
+};
+
+struct upload_batch
+{
+    VkCommandBuffer command_buffer;
+    uint64_t timeline_value;
+    VkDeviceSize ring_end;
+};
+
+// streams data to device local buffers through a persistently mapped staging
+// ring, copies are recorded into a single submission per flush and their
+// completion is tracked with a timeline semaphore instead of queue idles
+class uploader : non_copyable
+{
+  private:
+    VkDevice device_;
+    device_allocator& allocator_;
+    VkQueue queue_;
+    VkCommandPool command_pool_     = VK_NULL_HANDLE;
+    VkSemaphore timeline_semaphore_ = VK_NULL_HANDLE;
+    VkBuffer staging_buffer_        = VK_NULL_HANDLE;
+    allocation staging_allocation_;
+    VkDeviceSize capacity_;
+
+    // monotonic byte counters, ring positions are taken modulo capacity
+    VkDeviceSize head_ = 0;
+    VkDeviceSize tail_ = 0;
+
+    uint64_t submitted_value_ = 0;
+    std::vector<pending_copy> pending_;
+    std::deque<upload_batch> in_flight_;
+    std::vector<VkCommandBuffer> free_command_buffers_;
+
+    void collect_();
+    void wait_for_space_(VkDeviceSize size);
+    VkCommandBuffer acquire_command_buffer_();
+
+  public:
+    uploader(VkDevice device,
+             device_allocator& allocator,
+             VkQueue queue,
+             uint32_t queue_family,
+             VkDeviceSize capacity = default_staging_capacity);
+    ~uploader();
+
+    void enqueue(std::span<const std::byte> data,
+                 VkBuffer destination,
+                 VkDeviceSize destination_offset = 0);
+
+    // submits every pending copy at once and returns the timeline value which
+    // will be signaled on completion
+    uint64_t flush();
+
+    VkSemaphore semaphore() const;
+    uint64_t submitted_value() const;
+    bool is_complete(uint64_t value) const;
+};
+} // namespace wf::vk
@@ -0,0 +1,181 @@
+module;
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+export module vk:vertex_format;
+
+import :pipeline_library;
+
+namespace wf::vk
+{
+// how one attribute sits in its vertex buffer, the vertex stage only ever
+// sees the decoded value. the formats are all mandatory for vertex input
+export enum class encoding
+{
+    float32x2,
+    float32x3,
+    float32x4,
+    uint32,
+    // integer lattice coordinates
+    uint8x2,
+    // texture coordinates in [0, 1]
+    unorm8x2,
+    // colors
+    unorm8x4,
+    // unit vector, see quantize::pack_octahedral
+    octahedral16,
+    // position relative to a quantize::position_range, w unused
+    snorm16x4
+};
+
+struct encoding_info
+{
+    VkFormat format;
+    uint32_t size;
+    uint32_t component_size;
+    // bytes of the float attribute the encoding stands in for
+    uint32_t decoded_size;
+};
+
+constexpr encoding_info describe(encoding e)
+{
+    switch (e)
+    {
+    case encoding::float32x2:
+        return {VK_FORMAT_R32G32_SFLOAT, 8, 4, 8};
+    case encoding::float32x3:
+        return {VK_FORMAT_R32G32B32_SFLOAT, 12, 4, 12};
+    case encoding::float32x4:
+        return {VK_FORMAT_R32G32B32A32_SFLOAT, 16, 4, 16};
+    case encoding::uint32:
+        return {VK_FORMAT_R32_UINT, 4, 4, 4};
+    case encoding::uint8x2:
+        return {VK_FORMAT_R8G8_UINT, 2, 1, 8};
+    case encoding::unorm8x2:
+        return {VK_FORMAT_R8G8_UNORM, 2, 1, 8};
+    case encoding::unorm8x4:
+        return {VK_FORMAT_R8G8B8A8_UNORM, 4, 1, 16};
+    case encoding::octahedral16:
+        return {VK_FORMAT_R16G16_SNORM, 4, 2, 12};
+    case encoding::snorm16x4:
+        return {VK_FORMAT_R16G16B16A16_SNORM, 8, 2, 12};
+    }
+    return {VK_FORMAT_UNDEFINED, 0, 1, 0};
+}
+
+// attributes follow each other without padding, which only works while
+// every one starts on a multiple of its component size
+constexpr bool packable(std::initializer_list<encoding> attributes)
+{
+    uint32_t offset = 0;
+    for (auto e : attributes)
+    {
+        if (offset % describe(e).component_size != 0)
+        {
+            return false;
+        }
+        offset += describe(e).size;
+    }
+    return true;
+}
+
+// one vertex buffer binding, its attributes packed back to back in order
+export template <VkVertexInputRate Rate, encoding... Attributes>
+struct vertex_stream
+{
+    static_assert(packable({Attributes...}),
+                  "attribute offsets must align to their components");
+
+    static constexpr VkVertexInputRate rate = Rate;
+    static constexpr std::array<encoding, sizeof...(Attributes)> attributes = {
+        Attributes...};
+    static constexpr uint32_t stride = (0 + ... + describe(Attributes).size);
+    static constexpr uint32_t decoded_stride =
+        (0 + ... + describe(Attributes).decoded_size);
+};
+
+// the whole vertex input of a pipeline, streams take bindings in order and
+// attributes take locations in order across all of them
+export template <typename... Streams>
+struct vertex_format
+{
+    template <size_t I>
+    using stream = std::tuple_element_t<I, std::tuple<Streams...>>;
+
+    static constexpr uint32_t attribute_count =
+        (0 + ... + static_cast<uint32_t>(Streams::attributes.size()));
+
+    static constexpr std::array<VkVertexInputBindingDescription,
+                                sizeof...(Streams)>
+    get_binding_descriptions()
+    {
+        uint32_t binding = 0;
+        return {VkVertexInputBindingDescription{
+            binding++, Streams::stride, Streams::rate}...};
+    }
+
+    static constexpr std::array<VkVertexInputAttributeDescription,
+                                attribute_count>
+    get_attribute_descriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, attribute_count>
+            descriptions{};
+        uint32_t binding  = 0;
+        uint32_t location = 0;
+        auto add          = [&](auto stream) {
+            uint32_t offset = 0;
+            for (auto e : decltype(stream)::attributes)
+            {
+                descriptions[location] = {
+                    location, binding, describe(e).format, offset};
+                offset += describe(e).size;
+                ++location;
+            }
+            ++binding;
+        };
+        (add(Streams{}), ...);
+        return descriptions;
+    }
+
+    static vertex_layout layout()
+    {
+        constexpr auto bindings   = get_binding_descriptions();
+        constexpr auto attributes = get_attribute_descriptions();
+        return {{std::begin(bindings), std::end(bindings)},
+                {std::begin(attributes), std::end(attributes)}};
+    }
+};
+
+// memory and fetch traffic of one stream against the same attributes kept
+// as floats. vertex rate streams fetch once per index, an upper bound the
+// post transform cache only lowers, instance rate ones once per instance
+export struct stream_report
+{
+    std::string_view name;
+    uint32_t stride;
+    uint32_t decoded_stride;
+    uint64_t resident_bytes;
+    uint64_t fetched_bytes;
+    uint64_t decoded_resident_bytes;
+    uint64_t decoded_fetched_bytes;
+};
+
+export template <typename Stream>
+constexpr stream_report report(std::string_view name,
+                               uint64_t elements,
+                               uint64_t fetches)
+{
+    return {.name                   = name,
+            .stride                 = Stream::stride,
+            .decoded_stride         = Stream::decoded_stride,
+            .resident_bytes         = elements * Stream::stride,
+            .fetched_bytes          = fetches * Stream::stride,
+            .decoded_resident_bytes = elements * Stream::decoded_stride,
+            .decoded_fetched_bytes  = fetches * Stream::decoded_stride};
+}
+} // namespace wf::vk